@@ -0,0 +1,64 @@
+/**
+ * @file autooff.c
+ * @date 2026-10-18
+ * @brief Implements autooff.h
+ */
+
+#include<xc.h>
+#include<stdio.h>
+#include"autooff.h"
+#include"eeprom.h"
+
+/**
+ * @brief Available timeouts in minutes (0 = never)
+ */
+static const uint16_t TIMEOUTS[AUTOOFF_NUM_SETTINGS] = {0, 15, 30, 60, 120, 240};
+
+/**
+ * @brief The selected setting (index into TIMEOUTS)
+ */
+static uint8_t setting = AUTOOFF_DEFAULT;
+
+/**
+ * @brief Time since the last input (in ms)
+ */
+static uint32_t sinceInput;
+
+void autoOffInit(void)
+{
+	// Erased EEPROM reads 0xff
+	setting = eepromRead(AUTOOFF_ADDRESS);
+	if(setting >= AUTOOFF_NUM_SETTINGS)
+		setting = AUTOOFF_DEFAULT;
+	sinceInput = 0;
+}
+
+void autoOffReset(void)
+{
+	sinceInput = 0;
+}
+
+bool autoOffUpdate(uint16_t dt)
+{
+	if(TIMEOUTS[setting] == 0)
+		return false;
+	sinceInput += dt;
+	return sinceInput >= TIMEOUTS[setting] * 60000ul;
+}
+
+uint8_t autoOffNextSetting(void)
+{
+	setting = (setting + 1) % AUTOOFF_NUM_SETTINGS;
+	eepromWrite(AUTOOFF_ADDRESS, setting);
+	sinceInput = 0;
+	if(TIMEOUTS[setting] == 0)
+		printf("Auto-off disabled\n");
+	else
+		printf("Auto-off after %u minutes\n", TIMEOUTS[setting]);
+	return setting;
+}
+
+uint16_t autoOffTimeout(void)
+{
+	return TIMEOUTS[setting];
+}
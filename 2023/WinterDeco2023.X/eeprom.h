@@ -0,0 +1,44 @@
+/**
+ * @file eeprom.h
+ * @date 2026-10-18
+ * @brief Driver for the data EEPROM (256 bytes)
+ */
+
+#ifndef EEPROM_H
+#define	EEPROM_H
+
+#include<stdint.h>
+
+/**
+ * @brief Reads a byte from the EEPROM
+ * @param address The address within the EEPROM.
+ * @return Returns the byte.
+ */
+uint8_t eepromRead(uint8_t address);
+
+/**
+ * @brief Writes a byte to the EEPROM
+ * @details Waits until the write has finished (a few ms). Bytes that already
+ * have the value are not written again to save write cycles. 
+ * @param address The address within the EEPROM.
+ * @param data The byte to be written.
+ */
+void eepromWrite(uint8_t address, uint8_t data);
+
+/**
+ * @brief Reads a block of bytes from the EEPROM
+ * @param address The address of the first byte within the EEPROM.
+ * @param data Buffer for the bytes.
+ * @param length Number of bytes.
+ */
+void eepromReadBlock(uint8_t address, void* data, uint8_t length);
+
+/**
+ * @brief Writes a block of bytes to the EEPROM
+ * @param address The address of the first byte within the EEPROM.
+ * @param data The bytes to be written.
+ * @param length Number of bytes.
+ */
+void eepromWriteBlock(uint8_t address, const void* data, uint8_t length);
+
+#endif // EEPROM_H
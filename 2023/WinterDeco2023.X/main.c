@@ -60,24 +60,28 @@
 #include"battery.h"
 #include"led.h"
 #include"touch.h"
+#include"autooff.h"
+#include"timebase.h"
 #include"programs.h"
 
 /**
- * @brief Tick flag for system clock
- * @details Set by the Timer 2 interrupt every 10ms, cleared by main.
+ * @brief Use the ADC threshold interrupt to detect touches during sleep
+ * @details If 1, the ADC watches the sensor on its own while the device sleeps
+ * and only the confirmation after a touch uses the watchdog timer. If 0, the
+ * watchdog timer wakes the device every second to measure. 
  */
-volatile bool tick = false;
+#define SLEEP_ADC_WAKE 1
 
 /**
- * @brief Timer 2 interrupt service routine
+ * @brief Number of consecutive untouched checks during sleep after which the
+ * sleep interval is doubled
  */
-void __interrupt(irq(TMR2), low_priority) timer2Isr(void)
-{
-	// Set tick flag
-	tick = true;
-	// Reset interrupt flag
-	PIR3bits.TMR2IF = 0;
-}
+#define SLEEP_CHECKS_PER_STEP 60
+
+/**
+ * @brief Maximum number of times the sleep interval is doubled (1s * 2^3 = 8s)
+ */
+#define SLEEP_STEPS_MAX 3
 
 /**
  * @brief Sleeps until the sensor is touched for at least 2s
@@ -86,11 +90,23 @@ void __interrupt(irq(TMR2), low_priority) timer2Isr(void)
  * the status of the touch sensor is checked. If it is active on two
  * consecutive checks, we stop sleeping and wait until the sensor is released
  * before returning. 
+ * 
+ * The longer the sensor stays untouched, the longer the sleep intervals get:
+ * After SLEEP_CHECKS_PER_STEP checks the interval is doubled, up to
+ * SLEEP_STEPS_MAX times. Once the sensor is touched, the next check follows
+ * after 1s, so a touch is still confirmed by two consecutive checks. 
+ * 
+ * With SLEEP_ADC_WAKE, the device sleeps until the ADC detects a touch instead
+ * of polling while the sensor is not touched. The touch still has to be
+ * confirmed by a measurement after 1s. The backoff then applies to the
+ * interval between the ADC's measurements: It is doubled each time the sensor
+ * stays untouched for 64s * 2^n (about as long as SLEEP_CHECKS_PER_STEP checks
+ * without the ADC), up to SLEEP_STEPS_MAX times. 
  */
 void sleepUntilTouch()
 {
 	// Turn off system clock
-	T2CONbits.ON = 0;
+	timebaseStop();
 
 	// Signal going-to-sleep status by lighting the top LED on each side until
 	// the sensor is released
@@ -108,11 +124,39 @@ void sleepUntilTouch()
 
 	// Go to sleep until touch event occurs
 	uint8_t touch = 0;
+	// Number of times the sleep interval has been doubled and number of checks
+	// since then
+	uint8_t sleepSteps = 0, sleepChecks = 0;
 	while(1)
 	{
 		// Select sleep mode
 		CPUDOZEbits.IDLEN = 0; // Sleep instead of just idle
-		// Start Watchdog Timer
+#if SLEEP_ADC_WAKE
+		if((touch & 0b1) == 0)
+		{
+			// Sensor is not touched: Let the ADC watch it and sleep until it
+			// detects a touch (the threshold interrupt flag wakes the device,
+			// interrupts stay disabled so no ISR is called)
+			di();
+			touchWakeEnable(sleepSteps);
+			// Let the Watchdog Timer wake the device if the sensor stays
+			// untouched, to lengthen the measurement interval
+			WDTCON0bits.PS = 0b10000 + sleepSteps; // 1:2097152 (64s) * 2^n
+			WDTCON0bits.SEN = sleepSteps < SLEEP_STEPS_MAX;
+			SLEEP();
+			WDTCON0bits.SEN = 0;
+			bool touched = touchWakeDisable();
+			ei();
+			if(touched)
+				touch = 0b1;
+			else if(sleepSteps < SLEEP_STEPS_MAX)
+				sleepSteps++;
+			continue;
+		}
+#endif
+		// Start Watchdog Timer (1s interval to confirm a touch, otherwise
+		// longer the longer the sensor has not been touched)
+		WDTCON0bits.PS = 0b01010 + ((touch & 0b1) ? 0 : sleepSteps); // 1:32768 (1s) * 2^n
 		WDTCON0bits.SEN = 1;
 		// Zzzz...
 		// Entering sleep clears the WDT. 
@@ -124,10 +168,20 @@ void sleepUntilTouch()
 		WDTCON0bits.SEN = 0; // This also resets the counter for the next time
 		
 		// Check if sensor is touched
-		touch = (uint8_t)(touch << 1) | (isTouched() ? 1 : 0);
+		touch = (uint8_t)(touch << 1) | (touchMeasure() ? 1 : 0);
 		if((touch & 0b11) == 0b11)
 			// Sensor has been touched for at least 2s in a row
 			break;
+		
+		// Lengthen sleep interval if the sensor has not been touched for a
+		// while
+		if(touch & 0b1)
+			sleepChecks = 0;
+		else if(sleepSteps < SLEEP_STEPS_MAX && ++sleepChecks >= SLEEP_CHECKS_PER_STEP)
+		{
+			sleepSteps++;
+			sleepChecks = 0;
+		}
 	}
 
 	// Waking up: Signal wake-up status by lighting the top LED on each side
@@ -140,7 +194,80 @@ void sleepUntilTouch()
 	printf("I'm up!\n");
 
 	// Turn on system clock
-	T2CONbits.ON = 1;
+	timebaseStart();
+}
+
+/**
+ * @brief Checks if the user requests a new touch calibration
+ * @details This is done by holding the sensor for 5s during power-up.
+ * In that case, this waits until the sensor has been released. 
+ * @return Returns true if a calibration is requested, false otherwise. 
+ */
+bool calibrationRequested(void)
+{
+	for(uint8_t i = 0; i < 50; i++)
+	{
+		if(!touchMeasure())
+			return false;
+		__delay_ms(100);
+	}
+	printf("Release sensor for calibration...");
+	while(touchMeasure())
+		__delay_ms(100);
+	// Give the hand time to move away
+	__delay_ms(1000);
+	printf("OK\n");
+	return true;
+}
+
+/**
+ * @brief Checks if the user requests a different auto-off timeout
+ * @details This is done by keeping the sensor touched for another 3s after a
+ * long press, while the sleep indicator is shown. In that case, this waits
+ * until the sensor has been released. 
+ * @return Returns true if a change is requested, false otherwise. 
+ */
+bool autoOffChangeRequested(void)
+{
+	ledSetAll(0x00);
+	ledSet(0, 0xff);
+	ledSet(9, 0xff);
+	for(uint8_t i = 0; i < 30; i++)
+	{
+		if(!touchMeasure())
+			return false;
+		__delay_ms(100);
+	}
+	while(touchMeasure())
+		__delay_ms(100);
+	return true;
+}
+
+/**
+ * @brief Shows an auto-off setting for 1s
+ * @details One LED is lit per setting, all LEDs if the device is never turned
+ * off automatically. 
+ * @param setting The setting (see autoOffNextSetting()).
+ */
+void showAutoOff(uint8_t setting)
+{
+	ledSetAll(setting == 0 ? 0xff : 0x00);
+	for(uint8_t led = 0; led < setting; led++)
+		ledSet(led, 0xff);
+	__delay_ms(1000);
+	ledSetAll(0x00);
+}
+
+/**
+ * @brief Fades out all LEDs (takes about 1s)
+ */
+void fadeOut(void)
+{
+	for(uint8_t i = 0; i < COLOUR_DEPTH; i++)
+	{
+		ledDim();
+		__delay_ms(150);
+	}
 }
 
 /**
@@ -152,7 +279,7 @@ void main(void)
 	LATAbits.LATA2 = TRISAbits.TRISA2 = 0;
 	LATAbits.LATA4 = TRISAbits.TRISA4 = 0;
 	// Disable unused peripheral modules
-	// Used peripherals: Timer 0, Timer 1, UART 1, ADC, Fixed Voltage Reference
+	// Used peripherals: Timer 0, Timer 2, Timer 4, UART 1, ADC, Fixed Voltage Reference
 	PMD0bits.CRCMD = 1;
 	PMD0bits.SCANMD = 1;
 	PMD1bits.CM1MD = 1;
@@ -199,24 +326,33 @@ void main(void)
 
 	// Initialise Touch Sensors
 	touchInit();
+	// Calibrate on first boot (no valid calibration stored) or on request
+	if(!touchLoadCalibration() || calibrationRequested())
+	{
+		printf("Calibrating touch sensors, don't touch!\n");
+		touchCalibrate();
+	}
+	
+	// Load auto-off timeout
+	autoOffInit();
 
 	// Initialise LEDs
 	ledInit();
 	ledOn();
 	
-	// Initialise Timer 2 (System clock)
-	T2CLKCONbits.CS = 0b0001;	// Clock source: F_OSC/4
-	T2CONbits.CKPS = 0b111;		// Prescaler 1:128
-	T2CONbits.OUTPS = 0b1001;	// Postscaler 1:10
-	T2PR = 125;					// Compare value (16MHz/128/10/125 = 100Hz)
-	PIE3bits.TMR2IE = 1;		// Enable interrupt on compare match
-	T2CONbits.ON = 1;			// Enable Timer 2
+	// Initialise system clock
+	timebaseInit();
 	
 	// Enable interrupts
 	ei();
 	
-	// System clock counter (counts in units of 10ms)
-	uint16_t clk = 0;
+	// System time of the last tick and of the last program update (in ms)
+	uint32_t lastTick = 0, lastUpdate = 0;
+	// Time since the touch sensor was last checked (in ms)
+	uint16_t touchElapsed = 0;
+	// Time after the last program update at which the program needs to be
+	// updated again (in ms, or PROGRAM_STATIC)
+	uint16_t nextUpdate = 0;
 	// Program that is currently running
 	uint8_t currentProgram = 0;
 	
@@ -226,38 +362,56 @@ void main(void)
 		// Sleep
 		sleepUntilTouch();
 		// (Re-)Initialise LED program after sleep
-		PROGRAMS[currentProgram].initFunction(clk);
+		PROGRAMS[currentProgram].initFunction();
+		lastTick = lastUpdate = timebaseNow();
+		nextUpdate = 0;
+		autoOffReset();
 		
 		// While running, perform the following tasks:
 		// - Monitor touch sensor for short and long presses
-		// - Monitor system clock tick flag (100Hz)
-		// - After every tick, call program()
+		// - Turn off after a while without touches
+		// - Monitor system clock tick flag (100Hz, or 10Hz while the program
+		//   is static)
+		// - After every tick, call program() if it is due
 		uint8_t isPressed = 0;
 		uint8_t pressDuration = 0;
 		while(1)
 		{
-			// Wait for system clock tick
-			while(!tick);
-			tick = false;
-			clk++;
+			// Wait for system clock tick and calculate the time that has
+			// passed since the last tick (more than one tick if we fell
+			// behind)
+			timebaseWaitTick();
+			uint32_t now = timebaseNow();
+			uint16_t dt = (uint16_t)(now - lastTick);
+			lastTick = now;
 
 			// Check touch sensor every 100ms
-			if(clk % 10 == 0)
+			if(timebaseElapsed(&touchElapsed, dt, 100))
 			{
 				// Get result from last measurement and start a new one
 				uint8_t touchActive = isTouched();
 				// Check for short/long presses
 				if(isPressed && pressDuration < 255)
 					pressDuration++;
+				if(touchActive)
+					autoOffReset();
 				if(touchActive && !isPressed)
 					// Sensor was just pressed
 					isPressed = 1;
 				else if(isPressed && pressDuration >= 20)
 				{
-					// Long press (>=2s): Exit inner loop and go to sleep
+					// Long press (>=2s): Exit inner loop and go to sleep,
+					// unless the sensor is held for another 3s (hidden: change
+					// the auto-off timeout)
 					isPressed = 0;
 					pressDuration = 0;
-					break;
+					if(!autoOffChangeRequested())
+						break;
+					showAutoOff(autoOffNextSetting());
+					PROGRAMS[currentProgram].initFunction();
+					lastTick = lastUpdate = timebaseNow();
+					nextUpdate = 0;
+					continue;
 				}
 				else if(!touchActive && isPressed)
 				{
@@ -267,12 +421,34 @@ void main(void)
 					// Switch to next program
 					currentProgram = (currentProgram + 1) % NUMBER_OF_PROGRAMS;
 					printf("Changing to program %d: %s\n", currentProgram + 1, PROGRAMS[currentProgram].name);
-					PROGRAMS[currentProgram].initFunction(clk);
+					PROGRAMS[currentProgram].initFunction();
+					lastUpdate = now;
+					nextUpdate = 0;
 				}
 			}
 
-			// Let program update LEDs
-			PROGRAMS[currentProgram].updateFunction(clk);
+			// Fade out and go to sleep if nobody has touched the sensor for a
+			// while
+			if(autoOffUpdate(dt))
+			{
+				printf("No touch for %u minutes\n", autoOffTimeout());
+				fadeOut();
+				break;
+			}
+
+			// Let program update LEDs if it is due
+			uint32_t sinceUpdate32 = now - lastUpdate;
+			uint16_t sinceUpdate = sinceUpdate32 > 0xffff ? 0xffff : (uint16_t)sinceUpdate32;
+			if(nextUpdate != PROGRAM_STATIC && sinceUpdate >= nextUpdate)
+			{
+				nextUpdate = PROGRAMS[currentProgram].updateFunction(sinceUpdate);
+				lastUpdate = now;
+				sinceUpdate = 0;
+			}
+			
+			// Slow the system clock down while the program doesn't need
+			// updating before the next slow tick
+			timebaseSetSlow(nextUpdate == PROGRAM_STATIC || nextUpdate - sinceUpdate >= TIMEBASE_TICK_SLOW);
 		}
 	}
 }
@@ -6,6 +6,7 @@
 
 #include<xc.h>
 #include"led.h"
+#include"timebase.h"
 #include"programs.h"
 
 /**
@@ -19,14 +20,15 @@ uint8_t random(uint8_t max)
 }
 
 /**
- * @brief Dummy function that does nothing
+ * @brief Dummy functions that do nothing
  */
-void null(uint16_t clk) {}
+void nullInit(void) {}
+uint16_t nullUpdate(uint16_t dt) { return PROGRAM_STATIC; }
 
 /**
  * @brief Program function for "All on"
  */
-void programAllOn(uint16_t clk)
+void programAllOn(void)
 {
 	for(uint8_t led = 0; led < 30; led++)
 		ledSet(led, 0xff);
@@ -35,25 +37,29 @@ void programAllOn(uint16_t clk)
 /**
  * @brief Program function for "Fast blink"
  */
-void programFastBlink(uint16_t clk)
+uint16_t programFastBlink(uint16_t dt)
 {
 	// 80ms is fast enough
-	if(clk & 0b111) return;
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 80)) return 0;
 	// Have at most 6 LEDs on at any time
 	ledSetAll(0);
 	for(uint8_t i = 0; i < 6; i++)
 		ledSet(random(30), 0xff);
+	return 0;
 }
 
 /**
  * @brief Program function for "Snowfall"
  */
-void programSnowfall(uint16_t clk)
+uint16_t programSnowfall(uint16_t dt)
 {
 	// Slow down to 160ms
-	if((clk & 0b1111) == 0)
+	static uint16_t elapsed = 0;
+	static uint8_t frame = 0;
+	if(timebaseElapsed(&elapsed, dt, 160))
 	{
-		switch((clk >> 4) & 0b111)
+		switch(frame++ & 0b111)
 		{
 		case 0:
 			ledSetAll(0);
@@ -101,16 +107,19 @@ void programSnowfall(uint16_t clk)
 			break;
 		}
 	}
+	return 0;
 }
 
 /**
  * @brief Program function for "Flickering"
  */
-void programFlickering(uint16_t clk)
+uint16_t programFlickering(uint16_t dt)
 {
-	if(clk & 0b11)
-		return;
-	if(clk & 0xc)
+	static uint16_t elapsed = 0;
+	static uint8_t frame = 0;
+	if(!timebaseElapsed(&elapsed, dt, 40))
+		return 0;
+	if(frame++ & 0b11)
 		ledSetAll(0xff);
 	else
 	{
@@ -119,18 +128,23 @@ void programFlickering(uint16_t clk)
 		ledSet(random(30), 0);
 		ledSet(random(30), 0);
 	}
+	return 0;
 }
 
 /**
  * @brief Program function for "Snake"
  */
-void programSnake(uint16_t clk)
+uint16_t programSnake(uint16_t dt)
 {
 	// Slow down to 40ms
-	if(!(clk & 0b11))
+	static uint16_t elapsed = 0;
+	static uint8_t frame = 0;
+	if(timebaseElapsed(&elapsed, dt, 40))
 	{
 		ledSetAll(0);
-		switch((clk >> 2) % 15)
+		if(++frame == 15)
+			frame = 0;
+		switch(frame)
 		{
 		case  0:
 			ledSet(8, 255); ledSet(23, 255); ledSet(3, 255);
@@ -209,26 +223,32 @@ void programSnake(uint16_t clk)
 			break;
 		}
 	}
+	return 0;
 }
 
 /**
  * @brief Program function for "Slow blink"
  */
-void programSlowBlink(uint16_t clk)
+uint16_t programSlowBlink(uint16_t dt)
 {
+	// The brightness wraps around every 2.56s
+	static uint16_t time = 0;
+	time = (time + dt) % 2560;
+	uint8_t phase = (uint8_t)(3 * time / 10);
 	for(uint8_t led = 0; led < 30; led++)
-		ledSet(led, 255 - (uint8_t)(3 * clk + 8 * led));
+		ledSet(led, 255 - (uint8_t)(phase + 8 * led));
+	return 0;
 }
 
 /**
  * @brief Array containing all implemented programs
  */
 const Program PROGRAMS[] = {
-	{"Slow blink", null, programSlowBlink},
-	{"All on", programAllOn, null},
-	{"Fast blink", null, programFastBlink},
-	{"Snowfall", null, programSnowfall},
-	{"Flickering", null, programFlickering},
-	{"Snake", null, programSnake}
+	{"Slow blink", nullInit, programSlowBlink},
+	{"All on", programAllOn, nullUpdate},
+	{"Fast blink", nullInit, programFastBlink},
+	{"Snowfall", nullInit, programSnowfall},
+	{"Flickering", nullInit, programFlickering},
+	{"Snake", nullInit, programSnake}
 };
 const uint8_t NUMBER_OF_PROGRAMS = (sizeof(PROGRAMS) / sizeof(Program));
\ No newline at end of file
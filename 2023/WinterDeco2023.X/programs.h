@@ -7,12 +7,23 @@
 #ifndef PROGRAMS_H
 #define	PROGRAMS_H
 
-typedef void (*ProgramFunction)(uint16_t);
+/// Initialisation function called at the start of a program
+typedef void (*ProgramInitFunction)(void);
+/// Update function called at every system clock tick (10ms)
+/// The parameter is the time since the last call in milliseconds. 
+/// Returns the time in milliseconds until the function needs to be called
+/// again (0 for the next tick) or PROGRAM_STATIC if it never needs to be called
+/// again (until the program is restarted). 
+typedef uint16_t (*ProgramUpdateFunction)(uint16_t);
+
+/// Return value of update functions that don't need to be called again
+#define PROGRAM_STATIC 0xffff
 
 typedef struct
 {
     char name[32];
-    ProgramFunction initFunction, updateFunction;
+    ProgramInitFunction initFunction;
+    ProgramUpdateFunction updateFunction;
 } Program;
 
 extern const Program PROGRAMS[];
@@ -5,12 +5,53 @@
  */
 
 #include<xc.h>
+#include<stdint.h>
 #include"touch.h"
+#include"touchfilter.h"
+#include"eeprom.h"
 
 /**
- * @brief Touch sensor threshold
+ * @brief Number of consecutive measurements required to change the state of
+ * the sensor in isTouched()
  */
-static const int16_t THRESHOLD = -1000;
+#define TOUCH_DEBOUNCE 2
+
+/**
+ * @brief EEPROM address of the calibration data
+ */
+#define CALIBRATION_ADDRESS 0x00
+
+/**
+ * @brief Number of measurements for the calibration
+ */
+#define CALIBRATION_SAMPLES 64
+
+/**
+ * @brief Press threshold as multiple of the noise (peak-to-peak) of the
+ * untouched sensor
+ */
+#define CALIBRATION_NOISE_FACTOR 4
+
+/**
+ * @brief Limits for the calibrated press threshold
+ */
+#define CALIBRATION_PRESS_MIN 100
+#define CALIBRATION_PRESS_MAX 2000
+
+/**
+ * @brief Calibration data as stored in the EEPROM
+ */
+typedef struct
+{
+	int16_t baseline;			// Untouched level of the sensor
+	int16_t press;				// Press threshold of the sensor
+	uint8_t checksum;			// See calibrationChecksum()
+} Calibration;
+
+/**
+ * @brief Baseline tracking and debouncing for the sensor
+ */
+static TouchFilter filter;
 
 void touchInit(void)
 {
@@ -25,9 +66,15 @@ void touchInit(void)
 	LATBbits.LATB7 = 0;
 	RB5PPS = 0x27; // ADGRDA
 	RB7PPS = 0x28; // ADGRDB
+	
+	// Baseline is set by the first measurement
+	touchFilterReset(&filter);
 }
 
-bool isTouched(void)
+/**
+ * @brief Powers up and configures the ADC for CVD measurements
+ */
+static void adcOn(void)
 {
 	// Start up ADC
 	PMD2bits.ADCMD = 0;
@@ -41,13 +88,32 @@ bool isTouched(void)
 	ADCON1bits.GPOL = 0;		// Guard ring starts low in first stage
 	ADCON2bits.PSIS = 0;
 	ADCON3bits.CALC = 0b000;	// CVD result in ADERR
+	ADCON3bits.TMD = 0b000;		// No threshold interrupt
 	ADCLKbits.CS = 31;			// ADC Clock freq. = F_OSC/(2*(31+1)) = 1MHz
 	ADPCHbits.PCH = 0b00000101;	// Input pin
 	ADREFbits.NREF = 0b0;		// Negative Reference: AVSS
 	ADREFbits.PREF = 0b00;		// Positive Reference: VDD
-	ADPRE = 127;				// Precharging time: 127 clock cycles
-	ADACQ = 127;				// Acquisition time: 127 clock cycles
+	ADPRE = 31;					// Precharging time: 31 clock cycles
+	ADACQ = 31;					// Acquisition time: 31 clock cycles
 	ADCAP = 0;					// No additional Sample&Hold capacity
+}
+
+/**
+ * @brief Powers down the ADC
+ */
+static void adcOff(void)
+{
+	ADCON0bits.ON = 0;
+	PMD2bits.ADCMD = 1;
+}
+
+/**
+ * @brief Performs a CVD measurement of the sensor
+ * @return Returns the result (ADERR). 
+ */
+static int16_t measure(void)
+{
+	adcOn();
 
 	// First conversion: Start measurement and wait for it to finish
 	ADCON0bits.GO_nDONE = 1;
@@ -58,11 +124,114 @@ bool isTouched(void)
 
 	// Obtain result
 	int16_t result = (int16_t)ADERR;
-	bool touched = result >= THRESHOLD;
 
-	// Disable ADC
-	ADCON0bits.ON = 0;
-	PMD2bits.ADCMD = 1;
+	adcOff();
+	
+	return result;
+}
+
+bool isTouched(void)
+{
+	return touchFilterUpdate(&filter, measure(), TOUCH_DEBOUNCE);
+}
+
+bool touchMeasure(void)
+{
+	return touchFilterUpdate(&filter, measure(), 1);
+}
+
+void touchWakeEnable(uint8_t steps)
+{
+	// Update the baseline with a fresh measurement
+	touchMeasure();
+	
+	// Configure the ADC to run on its own during sleep and to raise the
+	// threshold interrupt when the sensor is touched
+	adcOn();
+	ADCON0bits.CS = 1;			// Dedicated ADC RC oscillator (keeps running during sleep)
+	ADCON3bits.TMD = 0b110;		// Threshold interrupt if ADERR > ADUTH
+	ADUTH = touchFilterBaseline(&filter) + filter.press;
+	ADACT = 0x06;				// Auto-conversion trigger: TMR4
+	ADTIF = 0;
+	ADTIE = 1;					// Enable threshold interrupt (for wake-up)
+	
+	// Set up Timer 4 to trigger a conversion every 128ms * 2^steps (one
+	// measurement every 256ms * 2^steps)
+	PMD1bits.TMR4MD = 0;
+	T4CLKCONbits.CS = 0b0100;	// Clock source: LFINTOSC (keeps running during sleep)
+	T4HLTbits.MODE = 0b00000;	// Free running
+	T4CONbits.CKPS = 0b111;		// Prescaler 1:128
+	T4CONbits.OUTPS = 0b0000;	// Postscaler 1:1
+	T4PR = (uint8_t)((32 << steps) - 1);// Period 32 * 2^steps (31kHz/128/32 = 7.6Hz / 2^steps)
+	T4CONbits.ON = 1;
+}
+
+bool touchWakeDisable(void)
+{
+	// Check whether the ADC has woken the device
+	bool touched = ADTIF;
+
+	// Stop Timer 4
+	T4CONbits.ON = 0;
+	PMD1bits.TMR4MD = 1;
+	
+	// Stop ADC
+	ADACT = 0x00;
+	ADTIE = 0;
+	ADTIF = 0;
+	adcOff();
 	
 	return touched;
 }
+
+/**
+ * @brief Calculates the checksum of calibration data
+ * @param calibration The calibration data.
+ * @return Returns the checksum.
+ */
+static uint8_t calibrationChecksum(const Calibration* calibration)
+{
+	const uint8_t* bytes = (const uint8_t*)calibration;
+	uint8_t sum = 0x5a;
+	for(uint8_t i = 0; i < sizeof(Calibration) - 1; i++)
+		sum += bytes[i];
+	return sum;
+}
+
+bool touchLoadCalibration(void)
+{
+	Calibration calibration;
+	eepromReadBlock(CALIBRATION_ADDRESS, &calibration, sizeof(Calibration));
+	if(calibration.checksum != calibrationChecksum(&calibration))
+		return false;
+	
+	touchFilterCalibrate(&filter, calibration.baseline, calibration.press);
+	return true;
+}
+
+void touchCalibrate(void)
+{
+	// Collect statistics of the untouched sensor
+	int32_t sum = 0;
+	int16_t min = INT16_MAX, max = INT16_MIN;
+	for(uint8_t i = 0; i < CALIBRATION_SAMPLES; i++)
+	{
+		int16_t result = measure();
+		sum += result;
+		if(result < min) min = result;
+		if(result > max) max = result;
+	}
+	
+	// Threshold well above the noise
+	int16_t press = (max - min) * CALIBRATION_NOISE_FACTOR;
+	if(press < CALIBRATION_PRESS_MIN) press = CALIBRATION_PRESS_MIN;
+	if(press > CALIBRATION_PRESS_MAX) press = CALIBRATION_PRESS_MAX;
+	
+	// Store and apply calibration
+	Calibration calibration;
+	calibration.baseline = (int16_t)(sum / CALIBRATION_SAMPLES);
+	calibration.press = press;
+	calibration.checksum = calibrationChecksum(&calibration);
+	eepromWriteBlock(CALIBRATION_ADDRESS, &calibration, sizeof(Calibration));
+	touchLoadCalibration();
+}
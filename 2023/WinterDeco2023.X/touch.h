@@ -3,6 +3,8 @@
  * @date 2024-10-06
  * @brief Driver for CVD-based touch sensors using the ADC
  * Uses Pin RA5 for the sensor, RB5 for Guard A, and RB7 for Guard B. 
+ * The results are compared against a slowly adapting baseline (see
+ * touchfilter.h). 
  */
 
 #ifndef TOUCH_H
@@ -16,11 +18,58 @@
  */
 void touchInit(void);
 
+/**
+ * @brief Loads the calibration of the sensor from the EEPROM
+ * @details The calibration sets the untouched level and the press threshold
+ * of the sensor. 
+ * @return Returns true if a valid calibration has been loaded, false if
+ * there is none (the default thresholds are used then). 
+ */
+bool touchLoadCalibration(void);
+
+/**
+ * @brief Calibrates the sensor and stores the calibration in the EEPROM
+ * @details Measures the sensor repeatedly and derives the press threshold
+ * from the noise. The sensor must not be touched meanwhile. Takes less than
+ * 100ms. 
+ */
+void touchCalibrate(void);
+
 /**
  * @brief Determine if the sensor is currently touched or not
- * @param sensor The sensor to be checked.
+ * @details Performs a measurement. The state only changes after two
+ * consecutive measurements agree, so this is meant to be called periodically. 
  * @return Returns true if the sensor is touched, otherwise false.
  */
 bool isTouched(void);
 
+/**
+ * @brief Measure if the sensor is currently touched or not
+ * @details Like isTouched(), but the result is not debounced. Used while
+ * sleeping, where measurements are far apart. 
+ * @return Returns true if the sensor is touched, otherwise false.
+ */
+bool touchMeasure(void);
+
+/**
+ * @brief Lets the ADC watch the sensor on its own
+ * @details Timer 4 (on LFINTOSC) triggers measurements, which the ADC performs
+ * with its own oscillator. If a measurement exceeds the baseline by
+ * its press threshold, the ADC threshold interrupt flag is set, which wakes the
+ * device from sleep. Meant to be used with interrupts disabled globally. 
+ * Uses Timer 4 and the ADC until touchWakeDisable() is called. 
+ * @param steps Number of times the interval between measurements (256ms) is
+ * doubled, at most 3.
+ */
+void touchWakeEnable(uint8_t steps);
+
+/**
+ * @brief Stops watching the sensor
+ * @details Clears the ADC threshold interrupt flag and powers down the ADC and
+ * Timer 4. 
+ * @return Returns true if the ADC has detected a touch (so it woke the
+ * device), otherwise false.
+ */
+bool touchWakeDisable(void);
+
 #endif // TOUCH_H
@@ -0,0 +1,65 @@
+/**
+ * @file touchfilter.c
+ * @date 2026-10-18
+ * @brief Implementation of touchfilter.h
+ */
+
+#include"touchfilter.h"
+
+void touchFilterReset(TouchFilter* filter)
+{
+	filter->baseline = 0;
+	filter->press = TOUCH_FILTER_PRESS;
+	filter->release = TOUCH_FILTER_RELEASE;
+	filter->count = 0;
+	filter->touched = false;
+	filter->initialised = false;
+}
+
+void touchFilterCalibrate(TouchFilter* filter, int16_t baseline, int16_t press)
+{
+	filter->baseline = (int32_t)baseline << TOUCH_FILTER_SHIFT;
+	filter->press = press;
+	filter->release = press / 2;
+	filter->count = 0;
+	filter->touched = false;
+	filter->initialised = true;
+}
+
+bool touchFilterUpdate(TouchFilter* filter, int16_t sample, uint8_t debounce)
+{
+	// The first measurement sets the baseline
+	if(!filter->initialised)
+	{
+		filter->baseline = (int32_t)sample << TOUCH_FILTER_SHIFT;
+		filter->initialised = true;
+	}
+	
+	// Compare with baseline (with hysteresis)
+	int16_t delta = sample - touchFilterBaseline(filter);
+	bool active = delta >= (filter->touched ? filter->release : filter->press);
+	
+	// Debounce: Change state only after enough consecutive measurements
+	if(active != filter->touched)
+	{
+		filter->count++;
+		if(filter->count >= debounce)
+		{
+			filter->touched = active;
+			filter->count = 0;
+		}
+	}
+	else
+		filter->count = 0;
+	
+	// Track baseline only while the sensor is untouched
+	if(!filter->touched && !active)
+		filter->baseline += sample - touchFilterBaseline(filter);
+	
+	return filter->touched;
+}
+
+int16_t touchFilterBaseline(const TouchFilter* filter)
+{
+	return (int16_t)(filter->baseline >> TOUCH_FILTER_SHIFT);
+}
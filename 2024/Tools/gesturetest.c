@@ -0,0 +1,223 @@
+/**
+ * @file gesturetest.c
+ * @date 2026-10-18
+ * @brief Checks the program switches of touches and gestures (runs on Linux)
+ *
+ * gesture.c and menu.c are compiled in unchanged. Each test case is a script
+ * of touches, which is turned into input events and fed to menuInput() and
+ * menuTick() tick by tick like the main loop does. The program switches that
+ * result are compared with the expected ones, so e.g. the sensors touched
+ * during a swipe must not switch programs on their own. Releases that are
+ * handed out in the same tick only switch to the program of the last one.
+ *
+ * Build and run (in this directory):
+ *   gcc -std=c99 -O2 -I../WinterDeco2024.X -o gesturetest gesturetest.c \
+ *       ../WinterDeco2024.X/gesture.c ../WinterDeco2024.X/menu.c
+ *   ./gesturetest
+ */
+
+#include<stdio.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include"input.h"
+#include"gesture.h"
+#include"menu.h"
+
+//-----------------------------------------------------------------------------
+// Mocked modules
+
+/**
+ * @brief Number of programs as in programs.c
+ */
+const uint8_t NUM_PROGRAMS = 6;
+
+/**
+ * @brief State of the sensors as seen by the input library
+ */
+static bool pressed[NUM_SENSORS];
+
+bool inputPressed(Sensor sensor)
+{
+	return pressed[sensor];
+}
+
+//-----------------------------------------------------------------------------
+// Test cases
+
+/**
+ * @brief Time between ticks (in ms)
+ */
+#define TICK 10
+
+/**
+ * @brief Maximum number of touches of a test case
+ */
+#define MAX_TOUCHES 4
+
+/**
+ * @brief Maximum number of program switches of a test case
+ */
+#define MAX_SWITCHES 4
+
+/**
+ * @brief A touch of a sensor
+ */
+typedef struct
+{
+	Sensor sensor;
+	uint16_t down;		// Time of the press (in ms)
+	uint16_t up;		// Time of the release (in ms)
+} Touch;
+
+/**
+ * @brief A test case
+ */
+typedef struct
+{
+	const char* name;
+	uint8_t program;						// Program at the start
+	Touch touches[MAX_TOUCHES];
+	uint8_t numTouches;
+	MenuAction action;						// Action other than MENU_PROGRAM (or MENU_NONE)
+	int8_t switches[MAX_SWITCHES + 1];		// Programs switched to, ended by -1
+	uint16_t earliest;						// Time before which nothing may be switched (in ms)
+} TestCase;
+
+#define FL SENSOR_FOOT_LEFT
+#define FR SENSOR_FOOT_RIGHT
+#define AL SENSOR_ARM_LEFT
+#define AR SENSOR_ARM_RIGHT
+#define HAT SENSOR_HAT
+
+static const TestCase TESTS[] =
+{
+	{"tap right foot", 3, {{FR, 0, 100}}, 1, MENU_NONE, {0, -1}, 100 + GESTURE_DOUBLE_TAP_TIME},
+	{"tap each arm", 0, {{AL, 0, 100}, {AR, 1000, 1100}}, 2, MENU_NONE, {2, 3, -1}, 100 + GESTURE_DOUBLE_TAP_TIME},
+	{"long press left arm", 0, {{AL, 0, 2500}}, 1, MENU_NONE, {2, -1}, 0},
+	{"hold hat", 0, {{HAT, 0, 2500}}, 1, MENU_NONE, {MENU_PROGRAM_SIMON, -1}, 0},
+	{"swipe up right", 2, {{FR, 0, 150}, {AR, 250, 400}, {HAT, 500, 650}}, 3, MENU_NONE, {3, -1}, 500},
+	{"swipe up left", 5, {{FL, 0, 150}, {AL, 250, 400}, {HAT, 500, 650}}, 3, MENU_NONE, {0, -1}, 0},
+	{"swipe down right", 0, {{HAT, 0, 150}, {AR, 250, 400}, {FR, 500, 650}}, 3, MENU_NONE, {5, -1}, 0},
+	{"swipe down left", 3, {{HAT, 0, 150}, {AL, 250, 400}, {FL, 500, 650}}, 3, MENU_NONE, {2, -1}, 0},
+	{"overlapping touches (chords)", 1, {{FL, 0, 300}, {AL, 200, 500}, {HAT, 400, 550}}, 3, MENU_NONE, {-1}, 0},
+	{"double tap hat", 1, {{HAT, 0, 100}, {HAT, 250, 350}}, 2, MENU_NONE, {MENU_PROGRAM_SIMON, -1}, 250},
+	{"double tap arm", 1, {{AR, 0, 100}, {AR, 250, 350}}, 2, MENU_NONE, {-1}, 0},
+	{"slow taps on the hat", 1, {{HAT, 0, 100}, {HAT, 600, 700}}, 2, MENU_NONE, {4, -1}, 700 + GESTURE_DOUBLE_TAP_TIME},
+	{"foot then other arm", 0, {{FL, 0, 100}, {AR, 200, 300}}, 2, MENU_NONE, {3, -1}, 600},
+	{"aborted swipe", 0, {{FL, 0, 100}, {AL, 200, 300}}, 2, MENU_NONE, {2, -1}, 800},
+	{"too slow for a swipe", 0, {{FR, 0, 100}, {AR, 1000, 1100}, {HAT, 2000, 2100}}, 3, MENU_NONE, {0, 3, 4, -1}, 0},
+	{"both feet", 4, {{FL, 0, 500}, {FR, 100, 500}}, 2, MENU_SLEEP, {-1}, 0},
+	{"both arms", 4, {{AL, 0, 500}, {AR, 100, 500}}, 2, MENU_AUTOOFF, {-1}, 0}
+};
+
+/**
+ * @brief Adds an input event to the events of a tick
+ */
+static void addEvent(InputRecord* events, unsigned* numEvents, Sensor sensor, InputEvent event, uint32_t time)
+{
+	events[*numEvents].sensor = sensor;
+	events[*numEvents].event = event;
+	events[*numEvents].time = time;
+	(*numEvents)++;
+}
+
+/**
+ * @brief Runs a test case
+ * @param test The test case.
+ * @return Returns true if the test case has passed.
+ */
+static bool runTest(const TestCase* test)
+{
+	memset(pressed, 0, sizeof(pressed));
+	menuReset();
+	uint8_t program = test->program;
+	int switches[16];
+	unsigned numSwitches = 0;
+	MenuAction other = MENU_NONE;
+	bool early = false;
+
+	// Times are offset, so the events don't start at time 0
+	const uint32_t START = 100000;
+	uint16_t end = 0;
+	for(unsigned i = 0; i < test->numTouches; i++)
+		if(test->touches[i].up > end)
+			end = test->touches[i].up;
+
+	for(uint32_t t = TICK; t <= end + 1000u; t += TICK)
+	{
+		// Events since the last tick, in the order they occurred
+		InputRecord events[3 * MAX_TOUCHES];
+		unsigned numEvents = 0;
+		for(uint32_t ms = t - TICK; ms < t; ms++)
+		{
+			for(unsigned i = 0; i < test->numTouches; i++)
+			{
+				const Touch* touch = &test->touches[i];
+				bool isLong = touch->up - touch->down >= LONG_PRESS_DURATION;
+				if(ms == touch->down)
+					addEvent(events, &numEvents, touch->sensor, EVENT_PRESS, START + ms);
+				if(isLong && ms == (uint32_t)touch->down + LONG_PRESS_DURATION)
+					addEvent(events, &numEvents, touch->sensor, EVENT_HOLD_LONG, START + ms);
+				if(ms == touch->up)
+					addEvent(events, &numEvents, touch->sensor, isLong ? EVENT_RELEASE_LONG : EVENT_RELEASE_SHORT, START + ms);
+			}
+		}
+
+		// Like the main loop
+		for(unsigned i = 0; i < numEvents; i++)
+		{
+			InputRecord* input = &events[i];
+			pressed[input->sensor] = input->event == EVENT_PRESS || input->event == EVENT_HOLD_LONG;
+			MenuAction action = menuInput(input, &program);
+			if(action == MENU_PROGRAM && numSwitches < 16)
+				switches[numSwitches++] = program;
+			else if(action != MENU_NONE)
+				other = action;
+			if(action != MENU_NONE && t < test->earliest)
+				early = true;
+		}
+		if(menuTick(START + t, &program) == MENU_PROGRAM && numSwitches < 16)
+		{
+			switches[numSwitches++] = program;
+			if(t < test->earliest)
+				early = true;
+		}
+	}
+
+	bool passed = other == test->action && !early;
+	unsigned expected = 0;
+	while(test->switches[expected] >= 0)
+		expected++;
+	if(numSwitches != expected)
+		passed = false;
+	for(unsigned i = 0; passed && i < expected; i++)
+		if(switches[i] != test->switches[i])
+			passed = false;
+	if(!passed)
+	{
+		printf("  Switches:");
+		for(unsigned i = 0; i < numSwitches; i++)
+			printf(" %d", switches[i]);
+		printf(", action %d%s\n", other, early ? ", switched too early" : "");
+	}
+	return passed;
+}
+
+/**
+ * @brief Main function
+ */
+int main(void)
+{
+	int failed = 0;
+	int numTests = (int)(sizeof(TESTS) / sizeof(TESTS[0]));
+	for(int i = 0; i < numTests; i++)
+	{
+		bool passed = runTest(&TESTS[i]);
+		printf("%s: %s\n", passed ? "pass" : "FAIL", TESTS[i].name);
+		if(!passed)
+			failed++;
+	}
+	printf("%d of %d test cases failed\n", failed, numTests);
+	return failed != 0;
+}
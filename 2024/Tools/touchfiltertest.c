@@ -0,0 +1,248 @@
+/**
+ * @file touchfiltertest.c
+ * @date 2026-10-18
+ * @brief Replays ADERR traces through the touch filter (runs on Linux)
+ *
+ * touchfilter.c is compiled in unchanged. Without arguments, a set of
+ * synthetic traces (touches, spikes, noise and drift of the untouched level)
+ * is replayed and the samples at which presses and releases fire are compared
+ * with the expected ones. On every sample it is also checked that the baseline
+ * stays frozen while the sensor is touched. Some traces check the baseline at
+ * the end, so it must have followed the drift while untouched.
+ *
+ * With a file, a recorded trace (one ADERR value per line, everything after a
+ * # is ignored) is replayed and the presses and releases are listed.
+ *
+ * The 2023 firmware uses the same filter. The second build line below tests
+ * that copy.
+ *
+ * Build and run (in this directory):
+ *   gcc -std=c99 -O2 -I../WinterDeco2024.X -o touchfiltertest touchfiltertest.c \
+ *       ../WinterDeco2024.X/touchfilter.c
+ *   ./touchfiltertest
+ *   ./touchfiltertest [--debounce n] [--calibrate baseline press] trace.txt
+ *
+ *   gcc -std=c99 -O2 -I../../2023/WinterDeco2023.X -o touchfiltertest2023 \
+ *       touchfiltertest.c ../../2023/WinterDeco2023.X/touchfilter.c
+ *   ./touchfiltertest2023
+ */
+
+#include<stdio.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+#include"touchfilter.h"
+
+/**
+ * @brief Maximum number of segments of a trace
+ */
+#define MAX_SEGMENTS 12
+
+/**
+ * @brief Maximum number of expected presses and releases
+ */
+#define MAX_CHANGES 4
+
+/**
+ * @brief Untouched level of the synthetic traces at the start
+ */
+#define LEVEL 1000
+
+/**
+ * @brief A part of a synthetic trace
+ */
+typedef struct
+{
+	uint16_t length;	// Number of samples
+	int16_t touch;		// Offset of a touch above the untouched level
+	int8_t drift;		// Change of the untouched level per sample
+} Segment;
+
+/**
+ * @brief A synthetic trace with the expected results
+ */
+typedef struct
+{
+	const char* name;
+	uint8_t debounce;
+	int16_t press;					// Calibrated press threshold (0: not calibrated)
+	int16_t noise;					// Amplitude of the noise
+	Segment segments[MAX_SEGMENTS];
+	uint16_t changes[MAX_CHANGES];	// Samples that press, release, press... (0: none)
+	int16_t tolerance;				// Maximum error of the baseline at the end (0: not checked)
+} TestCase;
+
+static const TestCase TESTS[] =
+{
+	{"touch and release", 3, 600, 40, {{50, 0, 0}, {30, 900, 0}, {50, 0, 0}}, {52, 82}, 20},
+	{"default thresholds", 2, 0, 40, {{50, 0, 0}, {30, 900, 0}, {50, 0, 0}}, {51, 81}, 20},
+	{"no debounce", 1, 600, 40, {{10, 0, 0}, {1, 900, 0}, {10, 0, 0}}, {10, 11}, 0},
+	{"spikes and dips shorter than the debounce", 3, 600, 40,
+		{{20, 0, 0}, {1, 1000, 0}, {10, 0, 0}, {2, 1000, 0}, {20, 0, 0}, {30, 900, 0},
+		{2, 0, 0}, {10, 900, 0}, {1, 0, 0}, {10, 900, 0}, {30, 0, 0}}, {55, 108}, 0},
+	{"hysteresis", 3, 600, 40,
+		{{30, 0, 0}, {20, 450, 0}, {30, 0, 0}, {20, 900, 0}, {40, 400, 0}, {30, 200, 0}, {20, 0, 0}}, {82, 142}, 0},
+	{"noise", 3, 600, 150, {{100, 0, 0}, {50, 900, 0}, {100, 0, 0}}, {102, 152}, 0},
+	{"drift while untouched", 3, 600, 40,
+		{{100, 0, 0}, {600, 0, 1}, {50, 0, 0}, {30, 900, 0}, {50, 0, 0}, {600, 0, -1}, {300, 0, 0}}, {752, 782}, 20},
+	{"drift while touched", 3, 600, 40, {{50, 0, 0}, {200, 900, 1}, {300, 0, 0}}, {52, 252}, 20}
+};
+
+/**
+ * @brief Returns deterministic noise in [-amplitude, amplitude]
+ */
+static int16_t noise(int16_t amplitude)
+{
+	static uint32_t state = 12345;
+	state = state * 1103515245u + 12345u;
+	return (int16_t)((int32_t)((state >> 16) % (2u * amplitude + 1)) - amplitude);
+}
+
+/**
+ * @brief Runs a test case
+ * @param test The test case.
+ * @return Returns true if the test case has passed.
+ */
+static bool runTest(const TestCase* test)
+{
+	TouchFilter filter;
+	touchFilterReset(&filter);
+	if(test->press)
+		touchFilterCalibrate(&filter, LEVEL, test->press);
+
+	bool passed = true;
+	bool touched = false;
+	unsigned numChanges = 0;
+	unsigned index = 0;
+	int32_t level = LEVEL;
+	for(unsigned i = 0; i < MAX_SEGMENTS && test->segments[i].length; i++)
+	{
+		const Segment* segment = &test->segments[i];
+		for(unsigned j = 0; j < segment->length; j++, index++)
+		{
+			level += segment->drift;
+			int16_t sample = (int16_t)(level + segment->touch + noise(test->noise));
+			int16_t baseline = touchFilterBaseline(&filter);
+			bool now = touchFilterUpdate(&filter, sample, test->debounce);
+
+			if(now != touched)
+			{
+				bool expected = numChanges < MAX_CHANGES && test->changes[numChanges] == index;
+				if(!expected)
+				{
+					printf("  %s at sample %u\n", now ? "Press" : "Release", index);
+					passed = false;
+				}
+				numChanges++;
+				touched = now;
+			}
+			if(touched && touchFilterBaseline(&filter) != baseline)
+			{
+				printf("  Baseline moved from %d to %d while touched (sample %u)\n", baseline, touchFilterBaseline(&filter), index);
+				passed = false;
+			}
+		}
+	}
+
+	unsigned expected = 0;
+	while(expected < MAX_CHANGES && test->changes[expected])
+		expected++;
+	if(numChanges != expected)
+	{
+		printf("  %u presses and releases instead of %u\n", numChanges, expected);
+		passed = false;
+	}
+	int32_t error = touchFilterBaseline(&filter) - level;
+	if(test->tolerance && (error > test->tolerance || error < -test->tolerance))
+	{
+		printf("  Baseline %d, untouched level %ld\n", touchFilterBaseline(&filter), (long)level);
+		passed = false;
+	}
+	return passed;
+}
+
+/**
+ * @brief Replays a recorded trace
+ * @param path Path of the trace.
+ * @param debounce Number of consecutive samples to change the state.
+ * @param baseline Calibrated baseline.
+ * @param press Calibrated press threshold (0: not calibrated).
+ * @return Returns 0 on success.
+ */
+static int replay(const char* path, uint8_t debounce, int16_t baseline, int16_t press)
+{
+	FILE* file = fopen(path, "r");
+	if(!file)
+	{
+		perror(path);
+		return 1;
+	}
+	TouchFilter filter;
+	touchFilterReset(&filter);
+	if(press)
+		touchFilterCalibrate(&filter, baseline, press);
+
+	char line[64];
+	unsigned index = 0, changes = 0;
+	bool touched = false;
+	while(fgets(line, sizeof(line), file))
+	{
+		char* comment = strchr(line, '#');
+		if(comment)
+			*comment = '\0';
+		int sample;
+		if(sscanf(line, "%d", &sample) != 1)
+			continue;
+		int16_t before = touchFilterBaseline(&filter);
+		if(touchFilterUpdate(&filter, (int16_t)sample, debounce) != touched)
+		{
+			touched = !touched;
+			changes++;
+			printf("%6u %-8s sample %6d  baseline %6d\n", index, touched ? "press" : "release", sample, before);
+		}
+		index++;
+	}
+	fclose(file);
+	printf("%u samples, %u presses and releases, final baseline %d\n", index, changes, touchFilterBaseline(&filter));
+	return 0;
+}
+
+/**
+ * @brief Main function
+ */
+int main(int argc, char** argv)
+{
+	uint8_t debounce = 3;
+	int16_t baseline = 0, press = 0;
+	int i;
+	for(i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+	{
+		if(strcmp(argv[i], "--debounce") == 0 && i + 1 < argc)
+			debounce = (uint8_t)atoi(argv[++i]);
+		else if(strcmp(argv[i], "--calibrate") == 0 && i + 2 < argc)
+		{
+			baseline = (int16_t)atoi(argv[++i]);
+			press = (int16_t)atoi(argv[++i]);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--debounce n] [--calibrate baseline press] [trace.txt]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(i < argc)
+		return replay(argv[i], debounce, baseline, press);
+
+	int failed = 0;
+	int numTests = (int)(sizeof(TESTS) / sizeof(TESTS[0]));
+	for(int j = 0; j < numTests; j++)
+	{
+		bool passed = runTest(&TESTS[j]);
+		printf("%s: %s\n", passed ? "pass" : "FAIL", TESTS[j].name);
+		if(!passed)
+			failed++;
+	}
+	printf("%d of %d test cases failed\n", failed, numTests);
+	return failed != 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file autooff.h
+ * @date 2026-10-18
+ * @brief Inactivity timer that turns the device off
+ * 
+ * Once woken, the device would otherwise run until it is turned off by hand,
+ * which on a hung-up decoration can mean days. The timer is restarted by every
+ * input and expires after the selected timeout. The setting is stored in the
+ * EEPROM. 
+ */
+
+#ifndef AUTOOFF_H
+#define	AUTOOFF_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/**
+ * @brief EEPROM address of the setting
+ */
+#define AUTOOFF_ADDRESS 0x40
+
+/**
+ * @brief Number of available timeouts (see autoOffTimeout())
+ */
+#define AUTOOFF_NUM_SETTINGS 6
+
+/**
+ * @brief Setting used while none is stored in the EEPROM (1h)
+ */
+#define AUTOOFF_DEFAULT 3
+
+/**
+ * @brief Loads the setting from the EEPROM and restarts the timer
+ */
+void autoOffInit(void);
+
+/**
+ * @brief Restarts the timer
+ * @details Call for every input. 
+ */
+void autoOffReset(void);
+
+/**
+ * @brief Advances the timer
+ * @details Called from the main loop at every system clock tick. 
+ * @param dt Time since the last call (in ms). 
+ * @return Returns true once the timeout has expired (until the timer is
+ * restarted). 
+ */
+bool autoOffUpdate(uint16_t dt);
+
+/**
+ * @brief Selects the next timeout (wrapping around) and stores it in the
+ * EEPROM
+ * @details Also restarts the timer. 
+ * @return Returns the new setting (0..AUTOOFF_NUM_SETTINGS-1). 
+ */
+uint8_t autoOffNextSetting(void);
+
+/**
+ * @brief Returns the timeout
+ * @return The timeout in minutes, 0 if the device is never turned off
+ * automatically (setting 0). 
+ */
+uint16_t autoOffTimeout(void);
+
+#endif // AUTOOFF_H
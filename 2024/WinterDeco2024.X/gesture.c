@@ -0,0 +1,269 @@
+/**
+ * @file gesture.c
+ * @date 2026-10-18
+ * @brief Implementation of gesture.h
+ */
+
+#include<stdint.h>
+#include"gesture.h"
+
+/**
+ * @brief States of the swipe state machine
+ * @details Each state stands for the sensors pressed so far in the swipe. 
+ */
+typedef enum
+{
+	SWIPE_IDLE,
+	SWIPE_FOOT_LEFT,
+	SWIPE_FOOT_ARM_LEFT,
+	SWIPE_FOOT_RIGHT,
+	SWIPE_FOOT_ARM_RIGHT,
+	SWIPE_HAT,
+	SWIPE_HAT_ARM_LEFT,
+	SWIPE_HAT_ARM_RIGHT,
+	NUM_SWIPE_STATES
+} SwipeState;
+
+/**
+ * @brief Marks a transition that completes a swipe
+ * @details The other bits contain the GestureType, the state machine returns
+ * to SWIPE_IDLE. 
+ */
+#define SWIPE_DONE 0x80
+
+/**
+ * @brief Transition table of the swipe state machine
+ * @details Indexed by the current state and the pressed sensor. A press that
+ * does not continue a swipe may start a new one. 
+ */
+static const uint8_t SWIPE_TRANSITIONS[NUM_SWIPE_STATES][NUM_SENSORS] =
+{
+	// FOOT_LEFT, FOOT_RIGHT, ARM_LEFT, ARM_RIGHT, HAT
+	// SWIPE_IDLE
+	{SWIPE_FOOT_LEFT, SWIPE_FOOT_RIGHT, SWIPE_IDLE, SWIPE_IDLE, SWIPE_HAT},
+	// SWIPE_FOOT_LEFT
+	{SWIPE_FOOT_LEFT, SWIPE_FOOT_RIGHT, SWIPE_FOOT_ARM_LEFT, SWIPE_IDLE, SWIPE_HAT},
+	// SWIPE_FOOT_ARM_LEFT
+	{SWIPE_FOOT_LEFT, SWIPE_FOOT_RIGHT, SWIPE_IDLE, SWIPE_IDLE, SWIPE_DONE | GESTURE_SWIPE_UP_LEFT},
+	// SWIPE_FOOT_RIGHT
+	{SWIPE_FOOT_LEFT, SWIPE_FOOT_RIGHT, SWIPE_IDLE, SWIPE_FOOT_ARM_RIGHT, SWIPE_HAT},
+	// SWIPE_FOOT_ARM_RIGHT
+	{SWIPE_FOOT_LEFT, SWIPE_FOOT_RIGHT, SWIPE_IDLE, SWIPE_IDLE, SWIPE_DONE | GESTURE_SWIPE_UP_RIGHT},
+	// SWIPE_HAT
+	{SWIPE_FOOT_LEFT, SWIPE_FOOT_RIGHT, SWIPE_HAT_ARM_LEFT, SWIPE_HAT_ARM_RIGHT, SWIPE_HAT},
+	// SWIPE_HAT_ARM_LEFT
+	{SWIPE_DONE | GESTURE_SWIPE_DOWN_LEFT, SWIPE_FOOT_RIGHT, SWIPE_IDLE, SWIPE_IDLE, SWIPE_HAT},
+	// SWIPE_HAT_ARM_RIGHT
+	{SWIPE_FOOT_LEFT, SWIPE_DONE | GESTURE_SWIPE_DOWN_RIGHT, SWIPE_IDLE, SWIPE_IDLE, SWIPE_HAT}
+};
+
+/**
+ * @brief Sensors pressed so far in each state of the swipe state machine
+ */
+static const uint8_t SWIPE_SENSORS[NUM_SWIPE_STATES] =
+{
+	0,
+	1 << SENSOR_FOOT_LEFT,
+	1 << SENSOR_FOOT_LEFT | 1 << SENSOR_ARM_LEFT,
+	1 << SENSOR_FOOT_RIGHT,
+	1 << SENSOR_FOOT_RIGHT | 1 << SENSOR_ARM_RIGHT,
+	1 << SENSOR_HAT,
+	1 << SENSOR_HAT | 1 << SENSOR_ARM_LEFT,
+	1 << SENSOR_HAT | 1 << SENSOR_ARM_RIGHT
+};
+
+/**
+ * @brief Current state of the swipe state machine
+ */
+static uint8_t swipeState;
+
+/**
+ * @brief Time of the last press (in ms)
+ */
+static uint32_t pressTime;
+
+/**
+ * @brief Sensor of the last press (or NUM_SENSORS if none)
+ */
+static uint8_t pressSensor;
+
+/**
+ * @brief Time of the last short release (in ms)
+ */
+static uint32_t tapTime;
+
+/**
+ * @brief Sensor of the last short release (or NUM_SENSORS if none)
+ */
+static uint8_t tapSensor;
+
+/**
+ * @brief Sensors whose next release belongs to a gesture (Bit i set for
+ * Sensor i)
+ */
+static uint8_t suppressRelease;
+
+/**
+ * @brief Releases held back because they may still become part of a gesture
+ * (event EVENT_NONE if none)
+ */
+static InputRecord heldReleases[NUM_SENSORS];
+
+/**
+ * @brief Time until which each held release may still become part of a
+ * gesture (in ms)
+ */
+static uint32_t heldUntil[NUM_SENSORS];
+
+void gestureReset(void)
+{
+	swipeState = SWIPE_IDLE;
+	pressSensor = tapSensor = NUM_SENSORS;
+	suppressRelease = 0;
+	for(uint8_t i = 0; i < NUM_SENSORS; i++)
+		heldReleases[i].event = EVENT_NONE;
+}
+
+/**
+ * @brief Uses up the releases of sensors that are part of a gesture
+ * @details Held releases are dropped, the releases of sensors that are still
+ * pressed will be cleared. 
+ * @param sensors The sensors (Bit i set for Sensor i).
+ */
+static void useReleases(uint8_t sensors)
+{
+	for(uint8_t i = 0; i < NUM_SENSORS; i++)
+	{
+		if(!(sensors & (1 << i)))
+			continue;
+		heldReleases[i].event = EVENT_NONE;
+		if(inputPressed(i))
+			suppressRelease |= (uint8_t)(1 << i);
+	}
+}
+
+bool gestureUpdate(InputRecord* input, Gesture* gesture)
+{
+	uint8_t sensor = input->sensor;
+	uint8_t mask = (uint8_t)(1 << sensor);
+	
+	switch(input->event)
+	{
+	case EVENT_PRESS:
+		break;
+	case EVENT_RELEASE_SHORT:
+		// Could be the first tap of a double tap
+		tapSensor = sensor;
+		tapTime = input->time;
+		// fall through
+	case EVENT_RELEASE_LONG:
+		// Clear releases of sensors that completed a gesture
+		if(suppressRelease & mask)
+		{
+			suppressRelease &= (uint8_t)~mask;
+			tapSensor = NUM_SENSORS;
+			input->event = EVENT_NONE;
+			return false;
+		}
+		
+		// Hold the release back while the next press could still make it
+		// part of a double tap or a swipe
+		bool hold = false;
+		uint32_t until = 0;
+		if(input->event == EVENT_RELEASE_SHORT)
+		{
+			hold = true;
+			until = input->time + GESTURE_DOUBLE_TAP_TIME;
+		}
+		if((SWIPE_SENSORS[swipeState] & mask) && input->time - pressTime <= GESTURE_SWIPE_TIME)
+		{
+			if(!hold || (int32_t)(pressTime + GESTURE_SWIPE_TIME - until) > 0)
+				until = pressTime + GESTURE_SWIPE_TIME;
+			hold = true;
+		}
+		if(hold)
+		{
+			heldReleases[sensor] = *input;
+			heldUntil[sensor] = until;
+			input->event = EVENT_NONE;
+		}
+		return false;
+	default:
+		return false;
+	}
+	
+	gesture->type = GESTURE_NONE;
+	gesture->sensor = input->sensor;
+	gesture->other = input->sensor;
+	
+	if(sensor == tapSensor && input->time - tapTime <= GESTURE_DOUBLE_TAP_TIME)
+	{
+		// Second tap on the same sensor, the first tap is used up
+		gesture->type = GESTURE_DOUBLE_TAP;
+		tapSensor = NUM_SENSORS;
+		heldReleases[sensor].event = EVENT_NONE;
+	}
+	else if(pressSensor != NUM_SENSORS && pressSensor != sensor && inputPressed(pressSensor) && input->time - pressTime <= GESTURE_CHORD_TIME)
+	{
+		// Another sensor has been pressed just before and is still held
+		gesture->type = GESTURE_CHORD;
+		gesture->other = pressSensor;
+		suppressRelease |= (uint8_t)(1 << pressSensor);
+	}
+	
+	// Advance swipe state machine (starting over if the last press was too
+	// long ago)
+	if(input->time - pressTime > GESTURE_SWIPE_TIME)
+		swipeState = SWIPE_IDLE;
+	uint8_t next = SWIPE_TRANSITIONS[swipeState][sensor];
+	if(next & SWIPE_DONE)
+	{
+		if(gesture->type == GESTURE_NONE)
+		{
+			// The sensors pressed before belong to the swipe
+			gesture->type = next & ~SWIPE_DONE;
+			useReleases(SWIPE_SENSORS[swipeState]);
+		}
+		swipeState = SWIPE_IDLE;
+	}
+	else
+	{
+		// The releases of the sensors in the swipe so far are held until
+		// the next press is due
+		swipeState = next;
+		for(uint8_t i = 0; i < NUM_SENSORS; i++)
+			if((SWIPE_SENSORS[swipeState] & (1 << i)) && heldReleases[i].event != EVENT_NONE
+				&& (int32_t)(input->time + GESTURE_SWIPE_TIME - heldUntil[i]) > 0)
+				heldUntil[i] = input->time + GESTURE_SWIPE_TIME;
+	}
+	
+	// Remember press for chords and swipes
+	pressSensor = sensor;
+	pressTime = input->time;
+	
+	if(gesture->type == GESTURE_NONE)
+		return false;
+	
+	// Gesture recognised, this press and the following release are used up
+	input->event = EVENT_NONE;
+	suppressRelease |= mask;
+	return true;
+}
+
+bool gestureNextRelease(uint32_t now, InputRecord* release)
+{
+	// Pass on the oldest release that can't become part of a gesture any more
+	uint8_t oldest = NUM_SENSORS;
+	for(uint8_t i = 0; i < NUM_SENSORS; i++)
+	{
+		if(heldReleases[i].event == EVENT_NONE || (int32_t)(now - heldUntil[i]) <= 0)
+			continue;
+		if(oldest == NUM_SENSORS || (int32_t)(heldReleases[i].time - heldReleases[oldest].time) < 0)
+			oldest = i;
+	}
+	if(oldest == NUM_SENSORS)
+		return false;
+	*release = heldReleases[oldest];
+	heldReleases[oldest].event = EVENT_NONE;
+	return true;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file gesture.h
+ * @date 2026-10-18
+ * @brief Recognises gestures involving several touch sensors
+ * 
+ * This sits on top of the input library and is fed the input events one by
+ * one. It recognises
+ * - Swipes from a foot over the arm on the same side to the hat (up) and from
+ *   the hat over an arm to the foot on the same side (down),
+ * - Double taps on any sensor,
+ * - Chords, i.e. two sensors being pressed at (almost) the same time. 
+ * 
+ * Gestures are recognised at the press that completes them. The releases of
+ * all sensors of the gesture are then cleared, so they do not trigger
+ * anything else. As a release may become part of a gesture later (e.g. the
+ * first tap of a double tap or the foot of a swipe), releases are held back
+ * until the next press can no longer extend a gesture and then handed out by
+ * gestureNextRelease(). Short releases are thus delayed by at least
+ * GESTURE_DOUBLE_TAP_TIME. Swipes
+ * are tracked with a state machine whose transition table is kept in flash,
+ * so every event is processed in constant time. 
+ */
+
+#ifndef GESTURE_H
+#define	GESTURE_H
+
+#include<stdbool.h>
+#include"input.h"
+
+/**
+ * @brief Enumeration type for gestures
+ */
+typedef enum
+{
+	/// No gesture
+	GESTURE_NONE,
+	/// Left foot, left arm, hat
+	GESTURE_SWIPE_UP_LEFT,
+	/// Right foot, right arm, hat
+	GESTURE_SWIPE_UP_RIGHT,
+	/// Hat, left arm, left foot
+	GESTURE_SWIPE_DOWN_LEFT,
+	/// Hat, right arm, right foot
+	GESTURE_SWIPE_DOWN_RIGHT,
+	/// Two taps on the same sensor
+	GESTURE_DOUBLE_TAP,
+	/// Two sensors pressed at the same time
+	GESTURE_CHORD
+} GestureType;
+
+/**
+ * @brief A recognised gesture
+ */
+typedef struct
+{
+	/// What kind of gesture
+	GestureType type;
+	/// The sensor that completed the gesture
+	Sensor sensor;
+	/// The sensor that was pressed before (for chords)
+	Sensor other;
+} Gesture;
+
+/**
+ * @brief Maximum time between the presses of a swipe (in ms)
+ */
+#define GESTURE_SWIPE_TIME 600
+
+/**
+ * @brief Maximum time between the release of the first tap and the press of
+ * the second tap of a double tap (in ms)
+ */
+#define GESTURE_DOUBLE_TAP_TIME 300
+
+/**
+ * @brief Maximum time between the presses of a chord (in ms)
+ */
+#define GESTURE_CHORD_TIME 300
+
+/**
+ * @brief Reset the library
+ * @details Forgets any gestures in progress, e.g. after waking up from sleep. 
+ */
+void gestureReset(void);
+
+/**
+ * @brief Processes an input event
+ * @details Must be called for every input event in the order returned by
+ * inputNext(). Releases are cleared (set to EVENT_NONE) if they belong to a
+ * recognised gesture or might still become part of one, as is the press that
+ * completed a gesture. The latter are handed out later by
+ * gestureNextRelease(). 
+ * @param input The input event.
+ * @param gesture Upon return, this contains the recognised gesture (if any).
+ * @return Returns true if a gesture has been recognised, false otherwise. 
+ */
+bool gestureUpdate(InputRecord* input, Gesture* gesture);
+
+/**
+ * @brief Fetches a release that has been held back
+ * @details Call after each tick once all input events have been processed
+ * with gestureUpdate(). Releases that can no longer become part of a gesture
+ * are returned one by one (oldest first), with the time they occurred. A
+ * held release is replaced by a later release of the same sensor. 
+ * @param now The current system time (in ms).
+ * @param release Receives the release.
+ * @return Returns true if a release has been returned, false otherwise. 
+ */
+bool gestureNextRelease(uint32_t now, InputRecord* release);
+
+#endif // GESTURE_H
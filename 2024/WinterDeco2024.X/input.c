@@ -7,72 +7,151 @@
 #include<stdbool.h>
 #include<stdint.h>
 #include<xc.h>
+#include"timebase.h"
 #include"input.h"
 
 /**
- * @brief Current status of the touch sensors (pressed or not)
+ * @brief Current status of the touch sensors (Bit i set if Sensor i is
+ * pressed)
  */
-static bool isPressed[NUM_SENSORS];
+static volatile uint8_t isPressed;
 
 /**
- * @brief Press duration for sensors that are currently pressed
+ * @brief System time at which the sensors that are currently pressed were
+ * pressed
  */
-static uint8_t pressDuration[NUM_SENSORS];
+static volatile uint32_t pressTime[NUM_SENSORS];
+
+/**
+ * @brief Events reported by the touch library that have not been collected by
+ * inputNext() yet
+ */
+static volatile InputRecord queue[INPUT_QUEUE_SIZE];
+
+/**
+ * @brief Index of the oldest event in the queue (only written by inputNext())
+ */
+static volatile uint8_t queueHead;
+
+/**
+ * @brief Index after the newest event in the queue (only written by the ISR)
+ */
+static volatile uint8_t queueTail;
+
+/**
+ * @brief Sensors for which EVENT_HOLD_LONG has been reported during the
+ * current press (Bit i set for Sensor i)
+ * @details Set by inputNext(), cleared by the ISR when the sensor is released
+ * (even if the queue is full). 
+ */
+static volatile uint8_t isPressedLong;
 
 void inputReset()
 {
-	for(uint8_t i = 0; i < NUM_SENSORS; i++)
+	di();
+	isPressed = 0;
+	isPressedLong = 0;
+	queueHead = queueTail = 0;
+	ei();
+}
+
+/**
+ * @brief Adds an event to the queue
+ * @details Must only be called from the ISR. 
+ * @param sensor The sensor.
+ * @param event What happened.
+ * @param time System time of the event.
+ */
+static void inputPush(Sensor sensor, InputEvent event, uint32_t time)
+{
+	uint8_t tail = queueTail;
+	uint8_t next = (tail + 1) & (INPUT_QUEUE_SIZE - 1);
+	if(next == queueHead)
+		// Queue is full, drop event
+		return;
+	queue[tail].sensor = sensor;
+	queue[tail].event = event;
+	queue[tail].time = time;
+	queueTail = next;
+}
+
+void inputTouchChanged(Sensor sensor, bool touched)
+{
+	uint8_t mask = (uint8_t)(1 << sensor);
+	uint32_t now = timebaseNow();
+	if(touched && !(isPressed & mask))
+	{
+		// Sensor was just pressed
+		isPressed |= mask;
+		pressTime[sensor] = now;
+		inputPush(sensor, EVENT_PRESS, now);
+	}
+	else if(!touched && (isPressed & mask))
 	{
-		isPressed[i] = false;
-		pressDuration[i] = 0;
+		// Sensor was just released, check how long it was pressed for (the
+		// next press may be held long again)
+		isPressed &= (uint8_t)~mask;
+		isPressedLong &= (uint8_t)~mask;
+		inputPush(sensor, now - pressTime[sensor] >= LONG_PRESS_DURATION ? EVENT_RELEASE_LONG : EVENT_RELEASE_SHORT, now);
 	}
 }
 
-void inputUpdate(InputEvent events[NUM_SENSORS])
+bool inputNext(InputRecord* record)
 {
+	// Take the oldest event from the queue
+	if(queueHead != queueTail)
+	{
+		uint8_t head = queueHead;
+		record->sensor = queue[head].sensor;
+		record->event = queue[head].event;
+		record->time = queue[head].time;
+		queueHead = (head + 1) & (INPUT_QUEUE_SIZE - 1);
+		return true;
+	}
+	
+	// Report sensors that have been held for a long time
 	for(uint8_t i = 0; i < NUM_SENSORS; i++)
 	{
-		// Initialise event
-		events[i] = EVENT_NONE;
-		
-		// Increment press duration
-		if(isPressed[i] && pressDuration[i] < 255)
-			pressDuration[i]++;
-		
-		// Get current state of the sensor
-		bool touched = isTouched(i);
-		
-		// Detect events
-		if(touched && !isPressed[i])
+		uint8_t mask = (uint8_t)(1 << i);
+		// Mark the press as held long in the same critical section, so a
+		// release in between cannot leave the bit set
+		di();
+		uint32_t now = timebaseNow();
+		bool held = (isPressed & ~isPressedLong & mask) && now - pressTime[i] >= LONG_PRESS_DURATION;
+		if(held)
+			isPressedLong |= mask;
+		uint32_t since = pressTime[i];
+		ei();
+		if(held)
 		{
-			// Sensor was just pressed
-			isPressed[i] = true;
-			pressDuration[i] = 0;
-			events[i] = EVENT_PRESS;
-		}
-		else if(touched && isPressed[i] && pressDuration[i] >= LONG_PRESS_DURATION)
-		{
-			events[i] = EVENT_HOLD_LONG;
-		}
-		else if(!touched && isPressed[i])
-		{
-			// Sensor was just released
-			isPressed[i] = false;
-			// Check how long it was pressed for
-			events[i] = pressDuration[i] >= LONG_PRESS_DURATION ? EVENT_RELEASE_LONG : EVENT_RELEASE_SHORT;
+			record->sensor = i;
+			record->event = EVENT_HOLD_LONG;
+			record->time = since + LONG_PRESS_DURATION;
+			return true;
 		}
 	}
+	return false;
+}
+
+bool inputIs(const InputRecord* record, Sensor sensor, InputEvent event)
+{
+	return record && record->sensor == sensor && record->event == event;
 }
 
 bool inputPressed(Sensor sensor)
 {
-	return isPressed[sensor];
+	return (isPressed >> sensor) & 1;
+}
+
+bool inputPressedLong(Sensor sensor)
+{
+	di();
+	uint8_t pressedLong = isPressed & isPressedLong;
+	ei();
+	return pressedLong >> sensor & 1;
 }
 
 bool inputPressedAny()
 {
-	for(uint8_t i = 0; i < NUM_SENSORS; i++)
-		if(isPressed[i])
-			return true;
-	return false;
+	return isPressed != 0;
 }
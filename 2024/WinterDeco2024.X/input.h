@@ -6,12 +6,19 @@
  * This sits on top of the low level touch library. Each time a sensor is
  * pressed or released, an input event is generated. In the case of a sensor
  * release, the duration of the press is also reported. 
+ * 
+ * The touch library reports every change of a sensor from its background scan
+ * interrupt. The events are stored with their timestamp in a queue, so none
+ * are lost if several occur between two calls to inputNext(). The queue is
+ * lock-free: The interrupt is the only producer, the main loop the only
+ * consumer. 
  */
 
 #ifndef INPUT_H
 #define	INPUT_H
 
 #include<stdbool.h>
+#include<stdint.h>
 #include"touch.h"
 
 /**
@@ -32,11 +39,28 @@ typedef enum
 } InputEvent;
 
 /**
- * @brief Defines what constitutes a "long" time
- * @details This is in units of 100ms (or whatever the period between calls to
- * inputUpdate()).
+ * @brief Touch sensor event with the time at which it occurred
+ */
+typedef struct
+{
+	/// The sensor
+	Sensor sensor;
+	/// What happened
+	InputEvent event;
+	/// System time of the event (in ms)
+	uint32_t time;
+} InputRecord;
+
+/**
+ * @brief Defines what constitutes a "long" time (in ms)
  */
-#define LONG_PRESS_DURATION 20
+#define LONG_PRESS_DURATION 2000
+
+/**
+ * @brief Number of events that can be queued (must be a power of 2)
+ * @details If the queue is full, new events are dropped. 
+ */
+#define INPUT_QUEUE_SIZE 8
 
 /**
  * @brief Reset the library
@@ -46,14 +70,32 @@ typedef enum
 void inputReset(void);
 
 /**
- * @brief Queries all touch sensors and calculates input events
- * @details This function is called from the main loop at regular intervals,
- * typically 100ms. Note that inputs shorter than this period might not be
- * detected.
- * @param events Upon return, this array contains the latest input event for
- * each sensor.
+ * @brief Reports a change of a touch sensor
+ * @details Called by the touch library from the background scan interrupt. 
+ * @param sensor The sensor that changed.
+ * @param touched The new state of the sensor.
  */
-void inputUpdate(InputEvent events[NUM_SENSORS]);
+void inputTouchChanged(Sensor sensor, bool touched);
+
+/**
+ * @brief Takes the next input event from the queue
+ * @details Events are returned in the order in which they occurred. Once the
+ * queue is empty, an EVENT_HOLD_LONG is returned (once per press) for each
+ * sensor that has been held for LONG_PRESS_DURATION. 
+ * @param record Upon return, this contains the event (if any). 
+ * @return Returns true if there was an event, false otherwise. 
+ */
+bool inputNext(InputRecord* record);
+
+/**
+ * @brief Check for a specific input event
+ * @param record The input event to be checked (may be null).
+ * @param sensor The sensor in question.
+ * @param event The event in question.
+ * @return True if record is not null and matches sensor and event, false
+ * otherwise. 
+ */
+bool inputIs(const InputRecord* record, Sensor sensor, InputEvent event);
 
 /**
  * @brief Get the state of a sensor
@@ -64,6 +106,16 @@ void inputUpdate(InputEvent events[NUM_SENSORS]);
  */
 bool inputPressed(Sensor sensor);
 
+/**
+ * @brief Check if a sensor is being held for a long time
+ * @details True once the EVENT_HOLD_LONG of the sensor has been returned by
+ * inputNext() and until the sensor is released. 
+ * @param sensor The sensor in question.
+ * @return True if the sensor is currently held for a long time, false
+ * otherwise. 
+ */
+bool inputPressedLong(Sensor sensor);
+
 /**
  * @brief Check if any sensor is currently pressed
  * @details Note that this function does not initiate a measurement, it uses the
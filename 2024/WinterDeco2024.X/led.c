@@ -136,6 +136,22 @@ void ledSetAll(uint8_t value)
 		ledSet(led, value);
 }
 
+void ledDim(void)
+{
+	di();
+	for(uint8_t row = 0; row < 6; row++)
+	{
+		// Move each plane down by one, i.e. halve all values
+		for(uint8_t plane = 0; plane < COLOUR_DEPTH - 1; plane++)
+			buffer[plane][row].lat = buffer[plane + 1][row].lat;
+		// Clear the highest plane (column bits LATC[3:6], inverted for
+		// backward rows)
+		uint8_t lat = buffer[COLOUR_DEPTH - 1][row].lat & ~0x78u;
+		buffer[COLOUR_DEPTH - 1][row].lat = row < 3 ? lat : lat | 0x78u;
+	}
+	ei();
+}
+
 /**
  * @brief Interrupt handler for Timer 0
  */
@@ -129,4 +129,11 @@ void ledSet(uint8_t led, uint8_t value);
  */
 void ledSetAll(uint8_t value);
 
+/**
+ * @brief Halves the brightness of all LEDs
+ * @details The framebuffer is shifted down by one plane, so after COLOUR_DEPTH
+ * calls all LEDs are off. Used for fading out. 
+ */
+void ledDim(void);
+
 #endif // LED_H
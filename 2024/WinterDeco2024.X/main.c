@@ -59,24 +59,29 @@
 #include"battery.h"
 #include"touch.h"
 #include"input.h"
+#include"menu.h"
+#include"autooff.h"
+#include"timebase.h"
 #include"programs.h"
 
 /**
- * @brief Tick flag for system clock
- * @details Set by the Timer 2 interrupt every 10ms, cleared by main.
+ * @brief Use the ADC threshold interrupt to detect touches during sleep
+ * @details If 1, the ADC watches the sensor on its own while the device sleeps
+ * and only the confirmation after a touch uses the watchdog timer. If 0, the
+ * watchdog timer wakes the device every second to measure. 
  */
-volatile bool tick = false;
+#define SLEEP_ADC_WAKE 1
 
 /**
- * @brief Timer 2 interrupt service routine
+ * @brief Number of consecutive untouched checks during sleep after which the
+ * sleep interval is doubled
  */
-void __interrupt(irq(TMR2), low_priority) timer2Isr(void)
-{
-	// Set tick flag
-	tick = true;
-	// Reset interrupt flag
-	PIR3bits.TMR2IF = 0;
-}
+#define SLEEP_CHECKS_PER_STEP 60
+
+/**
+ * @brief Maximum number of times the sleep interval is doubled (1s * 2^3 = 8s)
+ */
+#define SLEEP_STEPS_MAX 3
 
 /**
  * @brief Sleeps until the right foot sensor is touched for at least 2s
@@ -85,11 +90,23 @@ void __interrupt(irq(TMR2), low_priority) timer2Isr(void)
  * the status of the touch sensor is checked. If it is active on two
  * consecutive checks, we stop sleeping and wait until the sensor is released
  * before returning. 
+ * 
+ * The longer the sensor stays untouched, the longer the sleep intervals get:
+ * After SLEEP_CHECKS_PER_STEP checks the interval is doubled, up to
+ * SLEEP_STEPS_MAX times. Once the sensor is touched, the next check follows
+ * after 1s, so a touch is still confirmed by two consecutive checks. 
+ * 
+ * With SLEEP_ADC_WAKE, the device sleeps until the ADC detects a touch instead
+ * of polling while the sensor is not touched. The touch still has to be
+ * confirmed by a measurement after 1s. The backoff then applies to the
+ * interval between the ADC's measurements: It is doubled each time the sensor
+ * stays untouched for 64s * 2^n (about as long as SLEEP_CHECKS_PER_STEP checks
+ * without the ADC), up to SLEEP_STEPS_MAX times. 
  */
 void sleepUntilTouch(void)
 {
 	// Turn off system clock
-	T2CONbits.ON = 0;
+	timebaseStop();
 
 	// Signal going-to-sleep status by lighting only the eyes until the sensor
 	// is released
@@ -102,16 +119,45 @@ void sleepUntilTouch(void)
 	printf("Zzz\n");
 	uartFlush();
 	
-	// Turn off LED driver
+	// Turn off LED driver and background touch scan
 	ledOff();
+	touchStop();
 
 	// Go to sleep until touch event occurs
 	uint8_t touch = 0;
+	// Number of times the sleep interval has been doubled and number of checks
+	// since then
+	uint8_t sleepSteps = 0, sleepChecks = 0;
 	while(1)
 	{
 		// Select sleep mode
 		CPUDOZEbits.IDLEN = 0; // Sleep instead of just idle
-		// Start Watchdog Timer
+#if SLEEP_ADC_WAKE
+		if((touch & 0b1) == 0)
+		{
+			// Sensor is not touched: Let the ADC watch it and sleep until it
+			// detects a touch (the threshold interrupt flag wakes the device,
+			// interrupts stay disabled so no ISR is called)
+			di();
+			touchWakeEnable(SENSOR_FOOT_RIGHT, sleepSteps);
+			// Let the Watchdog Timer wake the device if the sensor stays
+			// untouched, to lengthen the measurement interval
+			WDTCON0bits.PS = 0b10000 + sleepSteps; // 1:2097152 (64s) * 2^n
+			WDTCON0bits.SEN = sleepSteps < SLEEP_STEPS_MAX;
+			SLEEP();
+			WDTCON0bits.SEN = 0;
+			bool touched = touchWakeDisable();
+			ei();
+			if(touched)
+				touch = 0b1;
+			else if(sleepSteps < SLEEP_STEPS_MAX)
+				sleepSteps++;
+			continue;
+		}
+#endif
+		// Start Watchdog Timer (1s interval to confirm a touch, otherwise
+		// longer the longer the sensor has not been touched)
+		WDTCON0bits.PS = 0b01010 + ((touch & 0b1) ? 0 : sleepSteps); // 1:32768 (1s) * 2^n
 		WDTCON0bits.SEN = 1;
 		// Zzzz...
 		// Entering sleep clears the WDT. 
@@ -123,23 +169,97 @@ void sleepUntilTouch(void)
 		WDTCON0bits.SEN = 0; // This also resets the counter for the next time
 		
 		// Check if sensor is touched
-		touch = (uint8_t)(touch << 1) | (isTouched(SENSOR_FOOT_RIGHT) ? 1 : 0);
+		touch = (uint8_t)(touch << 1) | (touchMeasure(SENSOR_FOOT_RIGHT) ? 1 : 0);
 		if((touch & 0b11) == 0b11)
 			// Sensor has been touched for at least 2s in a row
 			break;
+		
+		// Lengthen sleep interval if the sensor has not been touched for a
+		// while
+		if(touch & 0b1)
+			sleepChecks = 0;
+		else if(sleepSteps < SLEEP_STEPS_MAX && ++sleepChecks >= SLEEP_CHECKS_PER_STEP)
+		{
+			sleepSteps++;
+			sleepChecks = 0;
+		}
 	}
 
 	// Waking up: Signal wake-up status by lighting the eyes until the sensor is
 	// released
 	ledOn();
 	printf("Waking up...");
-	while(isTouched(SENSOR_FOOT_RIGHT))
+	while(touchMeasure(SENSOR_FOOT_RIGHT))
 		__delay_ms(50);
 	ledSetAll(0x00);
 	printf("I'm up!\n");
 
+	// Resume background touch scan
+	touchStart();
+
 	// Turn on system clock
-	T2CONbits.ON = 1;
+	timebaseStart();
+}
+
+/**
+ * @brief Checks if the user requests a new touch calibration
+ * @details This is done by holding the right foot sensor for 5s during power-up.
+ * In that case, this waits until the sensor has been released. 
+ * @return Returns true if a calibration is requested, false otherwise. 
+ */
+bool calibrationRequested(void)
+{
+	for(uint8_t i = 0; i < 50; i++)
+	{
+		if(!touchMeasure(SENSOR_FOOT_RIGHT))
+			return false;
+		__delay_ms(100);
+	}
+	printf("Release sensor for calibration...");
+	while(touchMeasure(SENSOR_FOOT_RIGHT))
+		__delay_ms(100);
+	// Give the hand time to move away
+	__delay_ms(1000);
+	printf("OK\n");
+	return true;
+}
+
+/**
+ * @brief Shows an auto-off setting for 1s
+ * @details The buttons show the setting (one button per step), all LEDs are
+ * lit if the device is never turned off automatically. 
+ * @param setting The setting (see autoOffNextSetting()).
+ */
+void showAutoOff(uint8_t setting)
+{
+	static const uint8_t BUTTONS[5] = {LED_BUTTON_1, LED_BUTTON_2, LED_BUTTON_3, LED_BUTTON_4, LED_BUTTON_5};
+	ledSetAll(setting == 0 ? 0xff : 0x00);
+	for(uint8_t i = 0; i < setting && i < 5; i++)
+		ledSet(BUTTONS[i], 0xff);
+	__delay_ms(1000);
+	ledSetAll(0x00);
+}
+
+/**
+ * @brief Starts a program
+ * @param program The program.
+ */
+void startProgram(uint8_t program)
+{
+	printf("Switching to program \"%s\"\n", PROGRAMS[program].name);
+	PROGRAMS[program].initFunction();
+}
+
+/**
+ * @brief Fades out all LEDs (takes about 1s)
+ */
+void fadeOut(void)
+{
+	for(uint8_t i = 0; i < COLOUR_DEPTH; i++)
+	{
+		ledDim();
+		__delay_ms(150);
+	}
 }
 
 /**
@@ -148,7 +268,7 @@ void sleepUntilTouch(void)
 void main(void)
 {
 	// Disable unused peripheral modules
-	// Used peripherals: Timer 0, Timer 1, UART 1, ADC, Fixed Voltage Reference
+	// Used peripherals: Timer 0, Timer 2, Timer 4, UART 1, ADC, Fixed Voltage Reference
 	PMD0bits.CRCMD = 1;
 	PMD0bits.SCANMD = 1;
 	PMD1bits.CM1MD = 1;
@@ -156,7 +276,6 @@ void main(void)
 	PMD1bits.SMT1MD = 1;
 	PMD1bits.TMR1MD = 1;
 	PMD1bits.TMR3MD = 1;
-	PMD1bits.TMR4MD = 1;
 	PMD2bits.CCP1MD = 1;
 	PMD2bits.CWG1MD = 1;
 	PMD2bits.DSM1MD = 1;
@@ -195,24 +314,31 @@ void main(void)
 	
 	// Initialise Touch Sensors
 	touchInit();
+	// Calibrate on first boot (no valid calibration stored) or on request
+	if(!touchLoadCalibration() || calibrationRequested())
+	{
+		printf("Calibrating touch sensors, don't touch!\n");
+		touchCalibrate();
+	}
+	
+	// Load auto-off timeout
+	autoOffInit();
 	
 	// Initialise LEDs
 	ledInit();
 	ledOn();
 	
-	// Initialise Timer 2 (System clock)
-	T2CLKCONbits.CS = 0b0001;	// Clock source: F_OSC/4
-	T2CONbits.CKPS = 0b111;		// Prescaler 1:128
-	T2CONbits.OUTPS = 0b1001;	// Postscaler 1:10
-	T2PR = 125;					// Compare value (16MHz/128/10/125 = 100Hz)
-	PIE3bits.TMR2IE = 1;		// Enable interrupt on compare match
-	T2CONbits.ON = 1;			// Enable Timer 2
+	// Initialise system clock
+	timebaseInit();
 	
 	// Enable interrupts
 	ei();
 
-	// System clock counter (counts in units of 10ms)
-	uint16_t clk = 0;
+	// System time of the last tick and of the last program update (in ms)
+	uint32_t lastTick = 0, lastUpdate = 0;
+	// Time after the last program update at which the program needs to be
+	// updated again (in ms, or PROGRAM_STATIC)
+	uint16_t nextUpdate = 0;
 	// Program that is currently running
 	uint8_t currentProgram = 0;
 
@@ -226,69 +352,107 @@ void main(void)
 		currentProgram = 0;
 		PROGRAMS[currentProgram].initFunction();
 		inputReset();
+		menuReset();
+		autoOffReset();
+		lastTick = lastUpdate = timebaseNow();
+		nextUpdate = 0;
 		
 		// While running, perform the following tasks:
-		// - Monitor touch sensors for short and long presses
-		// - Monitor system clock tick flag (100Hz)
-		// - After every tick, call program()
+		// - Collect touch sensor events for short and long presses
+		// - Turn off after a while without touches
+		// - Monitor system clock tick flag (100Hz, or 10Hz while the program
+		//   is static)
+		// - After every tick, call program() for every input event and if it
+		//   is due
 		while(1)
 		{
-			// Wait for system clock tick
-			while(!tick);
-			tick = false;
-			clk++;
+			// Wait for system clock tick and calculate the time that has
+			// passed since the last tick (more than one tick if we fell
+			// behind)
+			timebaseWaitTick();
+			uint32_t now = timebaseNow();
+			uint16_t dt = (uint16_t)(now - lastTick);
+			lastTick = now;
 
-			// Check touch sensors every 100ms
-			InputEvent events[NUM_SENSORS];
-			for(uint8_t i = 0; i < NUM_SENSORS; i++) events[i] = EVENT_NONE;
-			if(clk % 10 == 0)
-				inputUpdate(events);
-			
-			// If a long press of SENSOR_FOOT_RIGHT is detected, exit inner loop
-			// and go to sleep
-			if(events[SENSOR_FOOT_RIGHT] == EVENT_HOLD_LONG)
-				break;
-			
-			// Let current program do its work
-			PROGRAMS[currentProgram].updateFunction(clk, events);
+			// Time since the last program update (saturated)
+			uint32_t sinceUpdate32 = now - lastUpdate;
+			uint16_t sinceUpdate = sinceUpdate32 > 0xffff ? 0xffff : (uint16_t)sinceUpdate32;
 
-			// Process events that were not cleared by the program
-			if(events[SENSOR_FOOT_RIGHT] == EVENT_RELEASE_SHORT || events[SENSOR_FOOT_RIGHT] == EVENT_RELEASE_LONG)
-			{
-				currentProgram = 0;
-				printf("Switching to program \"%s\"\n", PROGRAMS[currentProgram].name);
-				PROGRAMS[currentProgram].initFunction();
-			}
-			else if(events[SENSOR_FOOT_LEFT] == EVENT_RELEASE_SHORT || events[SENSOR_FOOT_LEFT] == EVENT_RELEASE_LONG)
+			// Pass each touch sensor event to the current program
+			InputRecord input;
+			bool anyEvent = false, sleep = false;
+			while(inputNext(&input))
 			{
-				currentProgram = 1;
-				printf("Switching to program \"%s\"\n", PROGRAMS[currentProgram].name);
-				PROGRAMS[currentProgram].initFunction();
-			}
-			else if(events[SENSOR_ARM_LEFT] == EVENT_RELEASE_SHORT || events[SENSOR_ARM_LEFT] == EVENT_RELEASE_LONG)
-			{
-				currentProgram = 2;
-				printf("Switching to program \"%s\"\n", PROGRAMS[currentProgram].name);
-				PROGRAMS[currentProgram].initFunction();
+				anyEvent = true;
+				autoOffReset();
+				
+				// If a long press of SENSOR_FOOT_RIGHT is detected, exit inner
+				// loop and go to sleep
+				if(inputIs(&input, SENSOR_FOOT_RIGHT, EVENT_HOLD_LONG))
+				{
+					sleep = true;
+					break;
+				}
+				
+				nextUpdate = PROGRAMS[currentProgram].updateFunction(sinceUpdate, &input);
+				lastUpdate = now;
+				sinceUpdate = 0;
+
+				// Switch programs (or go to sleep...) with the events that were
+				// not cleared by the program
+				MenuAction action = menuInput(&input, &currentProgram);
+				if(action == MENU_SLEEP)
+				{
+					sleep = true;
+					break;
+				}
+				else if(action == MENU_AUTOOFF)
+				{
+					// Forget the arms so their release doesn't switch programs
+					showAutoOff(autoOffNextSetting());
+					PROGRAMS[currentProgram].initFunction();
+					inputReset();
+					menuReset();
+					continue;
+				}
+				else if(action == MENU_PROGRAM)
+					startProgram(currentProgram);
 			}
-			else if(events[SENSOR_ARM_RIGHT] == EVENT_RELEASE_SHORT || events[SENSOR_ARM_RIGHT] == EVENT_RELEASE_LONG)
+			if(sleep)
+				break;
+			
+			// Releases that turned out not to be part of a gesture
+			if(menuTick(now, &currentProgram) == MENU_PROGRAM)
 			{
-				currentProgram = 3;
-				printf("Switching to program \"%s\"\n", PROGRAMS[currentProgram].name);
-				PROGRAMS[currentProgram].initFunction();
+				anyEvent = true;
+				startProgram(currentProgram);
 			}
-			else if(events[SENSOR_HAT] == EVENT_RELEASE_SHORT)
+			
+			// Fade out and go to sleep if nobody has touched a sensor for a
+			// while
+			if(autoOffUpdate(dt))
 			{
-				currentProgram = 4;
-				printf("Switching to program \"%s\"\n", PROGRAMS[currentProgram].name);
-				PROGRAMS[currentProgram].initFunction();
+				printf("No touch for %u minutes\n", autoOffTimeout());
+				fadeOut();
+				break;
 			}
-			else if(events[SENSOR_HAT] == EVENT_HOLD_LONG && currentProgram != 5)
+			
+			// Let current program do its work if it is due
+			if(nextUpdate != PROGRAM_STATIC && sinceUpdate >= nextUpdate)
 			{
-				currentProgram = 5;
-				printf("Switching to program \"%s\"\n", PROGRAMS[currentProgram].name);
-				PROGRAMS[currentProgram].initFunction();
+				nextUpdate = PROGRAMS[currentProgram].updateFunction(sinceUpdate, NULL);
+				lastUpdate = now;
+				sinceUpdate = 0;
 			}
+			
+			// Update again on the next tick after any input, in case a new
+			// program has been started
+			if(anyEvent)
+				nextUpdate = 0;
+			
+			// Slow the system clock down while the program doesn't need
+			// updating before the next slow tick
+			timebaseSetSlow(nextUpdate == PROGRAM_STATIC || nextUpdate - sinceUpdate >= TIMEBASE_TICK_SLOW);
 		}
 	}
 }
@@ -0,0 +1,112 @@
+/**
+ * @file menu.c
+ * @date 2026-10-18
+ * @brief Implementation of menu.h
+ */
+
+#include<stdbool.h>
+#include<stdint.h>
+#include"menu.h"
+#include"gesture.h"
+#include"programs.h"
+
+/**
+ * @brief Program selected by a short press on each sensor
+ */
+static const uint8_t SENSOR_PROGRAMS[NUM_SENSORS] =
+{
+	1,	// SENSOR_FOOT_LEFT
+	0,	// SENSOR_FOOT_RIGHT
+	2,	// SENSOR_ARM_LEFT
+	3,	// SENSOR_ARM_RIGHT
+	4	// SENSOR_HAT
+};
+
+/**
+ * @brief Switches programs on releases and holds
+ * @param input The input event.
+ * @param program The current program, receives the new one.
+ * @return Returns MENU_PROGRAM if the program has been changed, otherwise
+ * MENU_NONE. 
+ */
+static MenuAction selectProgram(const InputRecord* input, uint8_t* program)
+{
+	switch(input->event)
+	{
+	case EVENT_RELEASE_SHORT:
+		*program = SENSOR_PROGRAMS[input->sensor];
+		return MENU_PROGRAM;
+	case EVENT_RELEASE_LONG:
+		// The hat has been held for Simon Says
+		if(input->sensor == SENSOR_HAT)
+			return MENU_NONE;
+		*program = SENSOR_PROGRAMS[input->sensor];
+		return MENU_PROGRAM;
+	case EVENT_HOLD_LONG:
+		if(input->sensor != SENSOR_HAT || *program == MENU_PROGRAM_SIMON)
+			return MENU_NONE;
+		*program = MENU_PROGRAM_SIMON;
+		return MENU_PROGRAM;
+	default:
+		return MENU_NONE;
+	}
+}
+
+void menuReset(void)
+{
+	gestureReset();
+}
+
+MenuAction menuInput(InputRecord* input, uint8_t* program)
+{
+	// Look for gestures among the events that were not cleared by the program
+	Gesture gesture;
+	if(gestureUpdate(input, &gesture))
+	{
+		bool feet = (gesture.sensor == SENSOR_FOOT_LEFT || gesture.sensor == SENSOR_FOOT_RIGHT)
+			&& (gesture.other == SENSOR_FOOT_LEFT || gesture.other == SENSOR_FOOT_RIGHT);
+		bool arms = (gesture.sensor == SENSOR_ARM_LEFT || gesture.sensor == SENSOR_ARM_RIGHT)
+			&& (gesture.other == SENSOR_ARM_LEFT || gesture.other == SENSOR_ARM_RIGHT);
+		switch(gesture.type)
+		{
+		case GESTURE_SWIPE_UP_LEFT:
+		case GESTURE_SWIPE_UP_RIGHT:
+			// Next program
+			*program = (uint8_t)((*program + 1) % NUM_PROGRAMS);
+			return MENU_PROGRAM;
+		case GESTURE_SWIPE_DOWN_LEFT:
+		case GESTURE_SWIPE_DOWN_RIGHT:
+			// Previous program
+			*program = (uint8_t)((*program + NUM_PROGRAMS - 1) % NUM_PROGRAMS);
+			return MENU_PROGRAM;
+		case GESTURE_DOUBLE_TAP:
+			if(gesture.sensor != SENSOR_HAT)
+				break;
+			*program = MENU_PROGRAM_SIMON;
+			return MENU_PROGRAM;
+		case GESTURE_CHORD:
+			// Both feet: Go to sleep, both arms (hidden): Change the auto-off
+			// timeout
+			if(feet)
+				return MENU_SLEEP;
+			if(arms)
+				return MENU_AUTOOFF;
+			break;
+		default:
+			break;
+		}
+	}
+	
+	// Process events that were not cleared by the program or the gestures
+	return selectProgram(input, program);
+}
+
+MenuAction menuTick(uint32_t now, uint8_t* program)
+{
+	MenuAction action = MENU_NONE;
+	InputRecord release;
+	while(gestureNextRelease(now, &release))
+		if(selectProgram(&release, program) == MENU_PROGRAM)
+			action = MENU_PROGRAM;
+	return action;
+}
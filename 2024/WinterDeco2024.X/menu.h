@@ -0,0 +1,74 @@
+/**
+ * @file menu.h
+ * @date 2026-10-18
+ * @brief Maps touch sensor input to program switches and other actions
+ * 
+ * A short press on each of the five sensors switches to a program of its own,
+ * holding the hat starts Simon Says. On top of that, swipes up and down step
+ * through the programs, a double tap on the hat starts Simon Says, both feet
+ * send the device to sleep and both arms change the auto-off timeout. 
+ * 
+ * The gestures are recognised by the gesture library. A release that may
+ * still become part of a gesture only selects its program once the gesture
+ * library hands it out (see gestureNextRelease()), so the sensors touched
+ * during a swipe or the first tap of a double tap don't switch programs. 
+ * 
+ * This module does not access any hardware, so it can also be compiled for
+ * the host. 
+ */
+
+#ifndef MENU_H
+#define	MENU_H
+
+#include<stdint.h>
+#include"input.h"
+
+/**
+ * @brief Program started by holding the hat or double tapping it
+ */
+#define MENU_PROGRAM_SIMON 5
+
+/**
+ * @brief Actions requested by the input
+ */
+typedef enum
+{
+	/// Nothing to do
+	MENU_NONE,
+	/// Switch to the program returned
+	MENU_PROGRAM,
+	/// Go to sleep
+	MENU_SLEEP,
+	/// Change the auto-off timeout
+	MENU_AUTOOFF
+} MenuAction;
+
+/**
+ * @brief Forgets any input in progress
+ * @details E.g. after waking up from sleep. 
+ */
+void menuReset(void);
+
+/**
+ * @brief Processes an input event
+ * @details Must be called for every input event (after the program has had
+ * it) in the order returned by inputNext(). 
+ * @param input The input event. Cleared if it belongs to a gesture.
+ * @param program The current program, receives the new one with
+ * MENU_PROGRAM. 
+ * @return Returns the action requested. 
+ */
+MenuAction menuInput(InputRecord* input, uint8_t* program);
+
+/**
+ * @brief Processes the releases held back by the gesture library
+ * @details Call after each tick once all input events have been processed. 
+ * @param now The current system time (in ms).
+ * @param program The current program, receives the new one with
+ * MENU_PROGRAM. 
+ * @return Returns MENU_PROGRAM if the program has been changed, otherwise
+ * MENU_NONE. 
+ */
+MenuAction menuTick(uint32_t now, uint8_t* program);
+
+#endif // MENU_H
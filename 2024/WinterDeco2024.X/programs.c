@@ -7,11 +7,12 @@
 #include<xc.h>
 #include<stdio.h>
 #include"led.h"
+#include"timebase.h"
 #include"programs.h"
 
 // Dummy functions that do nothing
 void nullInit() {}
-void nullUpdate(uint16_t clk, InputEvent events[NUM_SENSORS]) {}
+uint16_t nullUpdate(uint16_t dt, InputRecord* input) { return PROGRAM_STATIC; }
 
 // VERY simple (and terrible) PRNG
 uint8_t random(uint8_t max)
@@ -38,20 +39,29 @@ void smileAndBlinkInit()
 	ledSet(LED_BUTTON_5, 0x33);
 }
 
-void smileAndBlinkUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
+uint16_t smileAndBlinkUpdate(uint16_t dt, InputRecord* input)
 {
-	// For the first 100ms (10 clocks) of each 5s (500 clocks) interval, turn
-	// off the eyes (blink)
-	if(clk % 500  == 0)
+	// Position within the 5s blink interval (in ms)
+	static uint16_t time = 0;
+	time = (time + dt) % 5000;
+
+	// For the first 100ms of each 5s interval, turn off the eyes (blink)
+	static bool eyesClosed = false;
+	if(time < 100 && !eyesClosed)
 	{
 		ledSet(LED_EYE_LEFT, 0x00);
 		ledSet(LED_EYE_RIGHT, 0x00);
+		eyesClosed = true;
 	}
-	else if(clk % 500  == 10)
+	else if(time >= 100 && eyesClosed)
 	{
 		ledSet(LED_EYE_LEFT, 0xff);
 		ledSet(LED_EYE_RIGHT, 0xff);
+		eyesClosed = false;
 	}
+	
+	// Nothing changes until the eyes open or close again
+	return eyesClosed ? 100 - time : 5000 - time;
 }
 
 //-----------------------------------------------------------------------------
@@ -78,11 +88,12 @@ void snowInit()
 	ledSet(LED_BUTTON_5, 0x33);
 }
 
-void snowUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
+uint16_t snowUpdate(uint16_t dt, InputRecord* input)
 {
 	// Act only every 100ms
-	if(clk % 10 != 0)
-		return;
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 100))
+		return 0;
 
 	// Position of the snowflakes on the left and right
 	// -1: non-existent, 0: above hat, 1: hat, ..., 5: foot, 6: below foot
@@ -128,12 +139,13 @@ void snowUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
 	ledSet(LED_HAND_RIGHT, snowRight == 3 ? 0xff : (snowRight == 2 || snowRight == 4 ? 0x22 : 0x00));
 	ledSet(LED_KNEE_RIGHT, snowRight == 4 ? 0xff : (snowRight == 3 || snowRight == 5 ? 0x22 : 0x00));
 	ledSet(LED_FOOT_RIGHT, snowRight == 5 ? 0xff : (snowRight == 4 || snowRight == 6 ? 0x22 : 0x00));
+	return 0;
 }
 
 //-----------------------------------------------------------------------------
 // Program: Dance
 
-#define DANCE_DELAY 20
+#define DANCE_DELAY 200 // ms
 
 void danceInit()
 {
@@ -147,32 +159,36 @@ void danceInit()
 	ledSet(LED_LOWER_LIP_RIGHT, 0xff);
 }
 
-void danceUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
+uint16_t danceUpdate(uint16_t dt, InputRecord* input)
 {
-	if(clk % DANCE_DELAY != 0)
-		return;
-	clk /= DANCE_DELAY;
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, DANCE_DELAY))
+		return 0;
+	// Number of dance steps so far
+	static uint8_t step = 0;
+	step++;
 
 	// Alternate buttons
-	ledSet(LED_BUTTON_1, clk % 2 == 0 ? 0x33 : 0x00);
-	ledSet(LED_BUTTON_2, clk % 2 == 0 ? 0x00 : 0x33);
-	ledSet(LED_BUTTON_3, clk % 2 == 0 ? 0x33 : 0x00);
-	ledSet(LED_BUTTON_4, clk % 2 == 0 ? 0x00 : 0x33);
-	ledSet(LED_BUTTON_5, clk % 2 == 0 ? 0x33 : 0x00);
+	ledSet(LED_BUTTON_1, step % 2 == 0 ? 0x33 : 0x00);
+	ledSet(LED_BUTTON_2, step % 2 == 0 ? 0x00 : 0x33);
+	ledSet(LED_BUTTON_3, step % 2 == 0 ? 0x33 : 0x00);
+	ledSet(LED_BUTTON_4, step % 2 == 0 ? 0x00 : 0x33);
+	ledSet(LED_BUTTON_5, step % 2 == 0 ? 0x33 : 0x00);
 
 	// Left side
-	ledSet(LED_HAT_LEFT, clk % 4 == 0 ? 0xff : 0x00);
-	ledSet(LED_SHOULDER_LEFT, clk % 4 == 0 ? 0xff : 0x00);
-	ledSet(LED_HAND_LEFT, clk % 4 == 0 ? 0xff : 0x00);
-	ledSet(LED_KNEE_LEFT, clk % 4 == 0 ? 0xff : 0x00);
-	ledSet(LED_FOOT_LEFT, clk % 4 == 0 ? 0xff : 0x00);
+	ledSet(LED_HAT_LEFT, step % 4 == 0 ? 0xff : 0x00);
+	ledSet(LED_SHOULDER_LEFT, step % 4 == 0 ? 0xff : 0x00);
+	ledSet(LED_HAND_LEFT, step % 4 == 0 ? 0xff : 0x00);
+	ledSet(LED_KNEE_LEFT, step % 4 == 0 ? 0xff : 0x00);
+	ledSet(LED_FOOT_LEFT, step % 4 == 0 ? 0xff : 0x00);
 
 	// Right side
-	ledSet(LED_HAT_RIGHT, clk % 4 == 2 ? 0xff : 0x00);
-	ledSet(LED_SHOULDER_RIGHT, clk % 4 == 2 ? 0xff : 0x00);
-	ledSet(LED_HAND_RIGHT, clk % 4 == 2 ? 0xff : 0x00);
-	ledSet(LED_KNEE_RIGHT, clk % 4 == 2 ? 0xff : 0x00);
-	ledSet(LED_FOOT_RIGHT, clk % 4 == 2 ? 0xff : 0x00);
+	ledSet(LED_HAT_RIGHT, step % 4 == 2 ? 0xff : 0x00);
+	ledSet(LED_SHOULDER_RIGHT, step % 4 == 2 ? 0xff : 0x00);
+	ledSet(LED_HAND_RIGHT, step % 4 == 2 ? 0xff : 0x00);
+	ledSet(LED_KNEE_RIGHT, step % 4 == 2 ? 0xff : 0x00);
+	ledSet(LED_FOOT_RIGHT, step % 4 == 2 ? 0xff : 0x00);
+	return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -195,10 +211,11 @@ void furyInit()
 	ledSet(LED_BUTTON_5, 0x33);
 }
 
-void furyUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
+uint16_t furyUpdate(uint16_t dt, InputRecord* input)
 {
-	if(clk % 4 != 0)
-		return;
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 40))
+		return 0;
 	
 	static uint8_t lightning = 0;
 	
@@ -220,6 +237,7 @@ void furyUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
 	}
 	else if(random(100) == 0)
 		lightning = 2 * random(4);
+	return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -252,12 +270,16 @@ void moodyInit()
 	ledSet(LED_FOOT_RIGHT, 0x04);
 }
 
-void moodyUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
+uint16_t moodyUpdate(uint16_t dt, InputRecord* input)
 {
-	if(clk % 1000 != 0)
-		return;
+	// Change mood every 10s
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 10000))
+		return 10000 - elapsed;
+	static uint8_t moodChanges = 0;
+	moodChanges++;
 	
-	switch((clk / 1000 + random(97)) % 4)
+	switch((moodChanges + random(97)) % 4)
 	{
 	case 0:
 		// Happy
@@ -300,6 +322,7 @@ void moodyUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
 		printf("Shush! :-X\n");
 		break;
 	}
+	return 10000 - elapsed;
 }
 
 //-----------------------------------------------------------------------------
@@ -318,10 +341,10 @@ void moodyUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
 #define SIMON_INCREMENT 1
 // Total sequence length (used in last stage)
 #define SIMON_TOTAL_LENGTH (SIMON_START_LENGTH + 4 * SIMON_INCREMENT)
-// Delay between sequence elements during playback
-#define SIMON_PLAYBACK_PAUSE_LENGTH 50
-// Duration of each sequence element during playback
-#define SIMON_PLAYBACK_SHOW_LENGTH 100
+// Delay between sequence elements during playback (in ms)
+#define SIMON_PLAYBACK_PAUSE_LENGTH 500
+// Duration of each sequence element during playback (in ms)
+#define SIMON_PLAYBACK_SHOW_LENGTH 1000
 
 // Complete sequence for a game (elements are 1..5)
 static uint8_t simonSequence[SIMON_TOTAL_LENGTH];
@@ -343,8 +366,8 @@ static enum
 	// The player has lost the game
 	SIMON_LOST
 } simonState;
-// Delay counter (counts down; delaying ends when 0 is reached)
-static uint8_t simonDelay;
+// Delay counter in ms (counts down; delaying ends when 0 is reached)
+static uint16_t simonDelay;
 // Stage of the game, zero-based (i.e. the first
 // SIMON_START_LENGTH + simonStage * SIMON_INCREMENT elements of the sequence
 // are in play)
@@ -398,13 +421,17 @@ void simonInit()
 	ledSet(LED_LOWER_LIP_RIGHT, 0xff);
 }
 
-void simonUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
+uint16_t simonUpdate(uint16_t dt, InputRecord* input)
 {
+	// Position within the 640ms blink cycle after winning (in ms)
+	static uint16_t winCycle = 0;
+	winCycle = (winCycle + dt) % 640;
+
 	// If delay is running, do nothing
 	if(simonDelay > 0)
 	{
-		simonDelay--;
-		return;
+		simonDelay = simonDelay > dt ? simonDelay - dt : 0;
+		return simonDelay;
 	}
 	
 	switch(simonState)
@@ -445,17 +472,20 @@ void simonUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
 		break;
 	case SIMON_WAITING_FOR_INPUT:
 		// Look for player input
-		for(uint8_t i = 0; i < 5; i++)
+		if(input)
 		{
-			if(events[i] == EVENT_PRESS)
+			uint8_t i = input->sensor;
+			if(input->event == EVENT_PRESS)
 			{
+				// Clear event (so sequences are not taken for gestures)
+				input->event = EVENT_NONE;
 				// Sensor was pressed, light up the corresponding LEDs
 				simonShow(i + 1);
 			}
-			else if(events[i] == EVENT_RELEASE_SHORT)
+			else if(input->event == EVENT_RELEASE_SHORT)
 			{
 				// Clear event
-				events[i] = EVENT_NONE;
+				input->event = EVENT_NONE;
 				// LEDs off
 				simonShow(0);
 				// Check if this was correct
@@ -500,7 +530,7 @@ void simonUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
 		}
 		break;
 	case SIMON_WON:
-		if(clk % 64 < 32)
+		if(winCycle < 320)
 		{
 			ledSet(LED_HAT_LEFT, 0xff);
 			ledSet(LED_HAT_RIGHT, 0x00);
@@ -516,8 +546,10 @@ void simonUpdate(uint16_t clk, InputEvent events[NUM_SENSORS])
 	case SIMON_LOST:
 		// Don't clear any events, this allows the main loop to enter other
 		// programs whenever the user selects one. 
-		break;
+		// Nothing else happens until then. 
+		return PROGRAM_STATIC;
 	}
+	return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -534,4 +566,4 @@ const Program PROGRAMS[] = {
 	{"Simon Says", simonInit, simonUpdate}
 };
 
-const uint8_t NUMBER_OF_PROGRAMS = (sizeof(PROGRAMS) / sizeof(Program));
\ No newline at end of file
+const uint8_t NUM_PROGRAMS = (sizeof(PROGRAMS) / sizeof(Program));
\ No newline at end of file
@@ -7,8 +7,15 @@
 #ifndef PROGRAMS_H
 #define	PROGRAMS_H
 
+#include<stdint.h>
 #include"input.h"
 
+/**
+ * @brief Return value of update functions that don't need to be called again
+ * until an input event occurs
+ */
+#define PROGRAM_STATIC 0xffff
+
 /**
  * @brief Data structure for programs
  */
@@ -19,13 +26,18 @@ typedef struct
 	/// Initialisation function called at the start of a program
 	/// If no initialisation is needed, this can be null.
 	void (*initFunction)(void);
-	/// Update function called at 10ms intervals
+	/// Update function called at system clock ticks (10ms) and for every
+	/// input event
 	/// If no updating is needed, this can be null. 
-	/// First parameter is the system clock. 
-	/// Second parameter are the input events. A program may process and clear
-	/// them (by assigning EVENT_NONE) or ignore them in which case the main
-	/// function might process them. 
-    void (*updateFunction)(uint16_t, InputEvent[NUM_SENSORS]);
+	/// First parameter is the time since the last call in milliseconds. 
+	/// Second parameter is the input event or null (for calls that are due
+	/// to the returned time). A program may process and clear it (by
+	/// assigning EVENT_NONE) or ignore it in which case the main function
+	/// might process it. 
+	/// Returns the time in milliseconds until the function needs to be called
+	/// again (0 for the next tick) or PROGRAM_STATIC. Whenever an input event
+	/// occurs, it is called regardless. 
+    uint16_t (*updateFunction)(uint16_t, InputRecord*);
 } Program;
 
 
@@ -0,0 +1,83 @@
+/**
+ * @file timebase.h
+ * @date 2026-10-18
+ * @brief Monotonic system time
+ * 
+ * Timer 2 generates a tick every 10ms. The ticks are accumulated into a 32-bit
+ * millisecond counter which only wraps after ~49 days. Time does not advance
+ * while the timebase is stopped (e.g. during sleep). 
+ * 
+ * When nothing needs to happen at the full tick rate, the timebase can be
+ * slowed down to one tick every 100ms. Timer 2 is then clocked from LFINTOSC,
+ * which is less accurate but lets the core idle for much longer. 
+ */
+
+#ifndef TIMEBASE_H
+#define	TIMEBASE_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/**
+ * @brief Period of the system clock tick in milliseconds
+ */
+#define TIMEBASE_TICK 10
+
+/**
+ * @brief Period of the slowed down system clock tick in milliseconds
+ */
+#define TIMEBASE_TICK_SLOW 100
+
+/**
+ * @brief Initialises and starts the timebase
+ * @details Interrupts must be enabled globally separately. 
+ */
+void timebaseInit(void);
+
+/**
+ * @brief Starts (or resumes) the timebase
+ */
+void timebaseStart(void);
+
+/**
+ * @brief Stops the timebase
+ * @details The millisecond counter keeps its value and continues from there
+ * when timebaseStart() is called. 
+ */
+void timebaseStop(void);
+
+/**
+ * @brief Switches between the normal and the slow tick rate
+ * @param slow True for one tick every TIMEBASE_TICK_SLOW, false for one tick
+ * every TIMEBASE_TICK. 
+ */
+void timebaseSetSlow(bool slow);
+
+/**
+ * @brief Gets the current system time
+ * @details The value is read atomically, so it is safe to call this while the
+ * timer interrupt is active. 
+ * @return Milliseconds the timebase has been running for. 
+ */
+uint32_t timebaseNow(void);
+
+/**
+ * @brief Waits for the next system clock tick
+ * @details Returns immediately if a tick has occurred since the last call.
+ * Otherwise the core idles until the tick interrupt occurs. 
+ */
+void timebaseWaitTick(void);
+
+/**
+ * @brief Checks whether a periodic action is due
+ * @details Accumulates elapsed time until a full period has passed. If the
+ * caller has fallen behind by more than one period, the missed periods are
+ * dropped rather than reported in a burst. 
+ * @param elapsed Accumulator for the time since the action was last due. 
+ * @param dt Time elapsed since the last call in milliseconds. 
+ * @param period Period of the action in milliseconds. 
+ * @return True if the action is due, false otherwise. 
+ */
+bool timebaseElapsed(uint16_t* elapsed, uint16_t dt, uint16_t period);
+
+#endif // TIMEBASE_H
@@ -5,12 +5,49 @@
  */
 
 #include<xc.h>
+#include<stdint.h>
 #include"touch.h"
+#include"touchfilter.h"
+#include"input.h"
+#include"eeprom.h"
 
 /**
- * @brief Touch sensor threshold
+ * @brief Number of consecutive measurements required to change the state of a
+ * sensor during the background scan (20ms each)
  */
-static const int16_t THRESHOLD = -1000;
+#define TOUCH_DEBOUNCE 3
+
+/**
+ * @brief EEPROM address of the calibration data
+ */
+#define CALIBRATION_ADDRESS 0x00
+
+/**
+ * @brief Number of measurements per sensor for the calibration
+ */
+#define CALIBRATION_SAMPLES 64
+
+/**
+ * @brief Press threshold as multiple of the noise (peak-to-peak) of the
+ * untouched sensor
+ */
+#define CALIBRATION_NOISE_FACTOR 4
+
+/**
+ * @brief Limits for the calibrated press threshold
+ */
+#define CALIBRATION_PRESS_MIN 100
+#define CALIBRATION_PRESS_MAX 2000
+
+/**
+ * @brief Calibration data as stored in the EEPROM
+ */
+typedef struct
+{
+	int16_t baseline[NUM_SENSORS];	// Untouched level of each sensor
+	int16_t press[NUM_SENSORS];		// Press threshold of each sensor
+	uint8_t checksum;				// See calibrationChecksum()
+} Calibration;
 
 /**
  * @brief Channel selections for the ADPCH register
@@ -30,6 +67,22 @@ static const uint8_t sensors[] =
 	0b00001110
 };
 
+/**
+ * @brief Baseline tracking and debouncing for each sensor
+ */
+static TouchFilter filters[NUM_SENSORS];
+
+/**
+ * @brief Debounced state of the sensors (one bit per sensor)
+ * @details Written by the ADC interrupt. 
+ */
+static volatile uint8_t touchedSensors;
+
+/**
+ * @brief Sensor that is currently being measured by the background scan
+ */
+static volatile uint8_t currentSensor;
+
 const char* SENSOR_NAMES[NUM_SENSORS] =
 {
 	"Left Foot",
@@ -60,9 +113,17 @@ void touchInit(void)
 	LATBbits.LATB7 = 0;
 	RC7PPS = 0x27; // ADGRDA
 	RB7PPS = 0x28; // ADGRDB
+	
+	// Baselines are set by the first measurements
+	for(uint8_t i = 0; i < NUM_SENSORS; i++)
+		touchFilterReset(&filters[i]);
+	touchedSensors = 0;
 }
 
-bool isTouched(Sensor sensor)
+/**
+ * @brief Powers up and configures the ADC for CVD measurements
+ */
+static void adcOn(void)
 {
 	// Start up ADC
 	PMD2bits.ADCMD = 0;
@@ -76,13 +137,66 @@ bool isTouched(Sensor sensor)
 	ADCON1bits.GPOL = 0;			// Guard ring starts low in first stage
 	ADCON2bits.PSIS = 0;
 	ADCON3bits.CALC = 0b000;		// CVD result in ADERR
+	ADCON3bits.TMD = 0b111;			// Threshold interrupt after every measurement
 	ADCLKbits.CS = 31;				// ADC Clock freq. = F_OSC/(2*(31+1)) = 1MHz
-	ADPCHbits.PCH = sensors[sensor];// Input pin
 	ADREFbits.NREF = 0b0;			// Negative Reference: AVSS
 	ADREFbits.PREF = 0b00;			// Positive Reference: VDD
-	ADPRE = 127;					// Precharging time: 127 clock cycles
-	ADACQ = 127;					// Acquisition time: 127 clock cycles
+	ADPRE = 31;						// Precharging time: 31 clock cycles
+	ADACQ = 31;						// Acquisition time: 31 clock cycles
 	ADCAP = 0;						// No additional Sample&Hold capacity
+}
+
+/**
+ * @brief Powers down the ADC
+ */
+static void adcOff(void)
+{
+	ADCON0bits.ON = 0;
+	PMD2bits.ADCMD = 1;
+}
+
+void touchStart(void)
+{
+	// Configure the ADC once for all measurements
+	adcOn();
+	currentSensor = 0;
+	ADPCHbits.PCH = sensors[currentSensor];
+	ADTIF = 0;
+	ADTIE = 1;						// Interrupt after every measurement
+	
+	// Set up Timer 4 to start a conversion every 2ms
+	PMD1bits.TMR4MD = 0;
+	T4CLKCONbits.CS = 0b0001;		// Clock source: F_OSC/4
+	T4HLTbits.MODE = 0b00000;		// Free running
+	T4CONbits.CKPS = 0b111;			// Prescaler 1:128
+	T4CONbits.OUTPS = 0b0000;		// Postscaler 1:1
+	T4PR = 250;						// Compare value (16MHz/128/250 = 500Hz)
+	TMR4IF = 0;
+	TMR4IE = 1;						// Enable interrupt on compare match
+	T4CONbits.ON = 1;
+}
+
+void touchStop(void)
+{
+	// Stop Timer 4
+	T4CONbits.ON = 0;
+	TMR4IE = 0;
+	PMD1bits.TMR4MD = 1;
+	
+	// Stop ADC
+	ADTIE = 0;
+	adcOff();
+}
+
+bool isTouched(Sensor sensor)
+{
+	return (touchedSensors & (1 << sensor)) != 0;
+}
+
+bool touchMeasure(Sensor sensor)
+{
+	adcOn();
+	ADPCHbits.PCH = sensors[sensor];// Input pin
 
 	// First conversion: Start measurement and wait for it to finish
 	ADCON0bits.GO_nDONE = 1;
@@ -91,13 +205,160 @@ bool isTouched(Sensor sensor)
 	ADCON0bits.GO_nDONE = 1;
 	while(ADCON0bits.GO_nDONE);
 
-	// Obtain result
-	int16_t result = (int16_t)ADERR;
-	bool touched = result >= THRESHOLD;
+	// Obtain result (not debounced, the caller decides how many consecutive
+	// measurements are required)
+	bool touched = touchFilterUpdate(&filters[sensor], (int16_t)ADERR, 1);
+	if(touched)
+		touchedSensors |= (uint8_t)(1 << sensor);
+	else
+		touchedSensors &= (uint8_t)~(1 << sensor);
 
-	// Disable ADC
-	ADCON0bits.ON = 0;
-	PMD2bits.ADCMD = 1;
+	adcOff();
 	
 	return touched;
 }
+
+void touchWakeEnable(Sensor sensor, uint8_t steps)
+{
+	// Update the baseline with a fresh measurement
+	touchMeasure(sensor);
+	
+	// Configure the ADC to run on its own during sleep and to raise the
+	// threshold interrupt when the sensor is touched
+	adcOn();
+	ADCON0bits.CS = 1;				// Dedicated ADC RC oscillator (keeps running during sleep)
+	ADCON3bits.TMD = 0b110;			// Threshold interrupt if ADERR > ADUTH
+	ADPCHbits.PCH = sensors[sensor];// Input pin
+	ADUTH = touchFilterBaseline(&filters[sensor]) + filters[sensor].press;
+	ADACT = 0x06;					// Auto-conversion trigger: TMR4
+	ADTIF = 0;
+	ADTIE = 1;						// Enable threshold interrupt (for wake-up)
+	
+	// Set up Timer 4 to trigger a conversion every 128ms * 2^steps (one
+	// measurement every 256ms * 2^steps)
+	PMD1bits.TMR4MD = 0;
+	T4CLKCONbits.CS = 0b0100;		// Clock source: LFINTOSC (keeps running during sleep)
+	T4HLTbits.MODE = 0b00000;		// Free running
+	T4CONbits.CKPS = 0b111;			// Prescaler 1:128
+	T4CONbits.OUTPS = 0b0000;		// Postscaler 1:1
+	T4PR = (uint8_t)((32 << steps) - 1);// Period 32 * 2^steps (31kHz/128/32 = 7.6Hz / 2^steps)
+	T4CONbits.ON = 1;
+}
+
+bool touchWakeDisable(void)
+{
+	// Check whether the ADC has woken the device
+	bool touched = ADTIF;
+
+	// Stop Timer 4
+	T4CONbits.ON = 0;
+	PMD1bits.TMR4MD = 1;
+	
+	// Stop ADC
+	ADACT = 0x00;
+	ADTIE = 0;
+	ADTIF = 0;
+	adcOff();
+	
+	return touched;
+}
+
+/**
+ * @brief Calculates the checksum of calibration data
+ * @param calibration The calibration data.
+ * @return Returns the checksum.
+ */
+static uint8_t calibrationChecksum(const Calibration* calibration)
+{
+	const uint8_t* bytes = (const uint8_t*)calibration;
+	uint8_t sum = 0x5a;
+	for(uint8_t i = 0; i < sizeof(Calibration) - 1; i++)
+		sum += bytes[i];
+	return sum;
+}
+
+bool touchLoadCalibration(void)
+{
+	Calibration calibration;
+	eepromReadBlock(CALIBRATION_ADDRESS, &calibration, sizeof(Calibration));
+	if(calibration.checksum != calibrationChecksum(&calibration))
+		return false;
+	
+	for(uint8_t i = 0; i < NUM_SENSORS; i++)
+		touchFilterCalibrate(&filters[i], calibration.baseline[i], calibration.press[i]);
+	touchedSensors = 0;
+	return true;
+}
+
+void touchCalibrate(void)
+{
+	Calibration calibration;
+	adcOn();
+	for(uint8_t i = 0; i < NUM_SENSORS; i++)
+	{
+		ADPCHbits.PCH = sensors[i];
+		
+		// Collect statistics of the untouched sensor
+		int32_t sum = 0;
+		int16_t min = INT16_MAX, max = INT16_MIN;
+		for(uint8_t j = 0; j < CALIBRATION_SAMPLES; j++)
+		{
+			ADCON0bits.GO_nDONE = 1;
+			while(ADCON0bits.GO_nDONE);
+			ADCON0bits.GO_nDONE = 1;
+			while(ADCON0bits.GO_nDONE);
+			int16_t result = (int16_t)ADERR;
+			sum += result;
+			if(result < min) min = result;
+			if(result > max) max = result;
+		}
+		
+		// Threshold well above the noise
+		int16_t press = (max - min) * CALIBRATION_NOISE_FACTOR;
+		if(press < CALIBRATION_PRESS_MIN) press = CALIBRATION_PRESS_MIN;
+		if(press > CALIBRATION_PRESS_MAX) press = CALIBRATION_PRESS_MAX;
+		calibration.baseline[i] = (int16_t)(sum / CALIBRATION_SAMPLES);
+		calibration.press[i] = press;
+	}
+	adcOff();
+	
+	// Store and apply calibration
+	calibration.checksum = calibrationChecksum(&calibration);
+	eepromWriteBlock(CALIBRATION_ADDRESS, &calibration, sizeof(Calibration));
+	touchLoadCalibration();
+}
+
+/**
+ * @brief Interrupt handler for Timer 4
+ * @details Starts the next conversion. Two conversions make up one measurement
+ * (double sampling). 
+ */
+void __interrupt(irq(TMR4), low_priority) timer4Isr(void)
+{
+	if(!ADCON0bits.GO_nDONE)
+		ADCON0bits.GO_nDONE = 1;
+	TMR4IF = 0;
+}
+
+/**
+ * @brief Interrupt handler for the ADC threshold interrupt
+ * @details Occurs after the second conversion of each measurement. Filters
+ * and publishes the result (reporting changes to the input library) and moves
+ * on to the next sensor. 
+ */
+void __interrupt(irq(ADT), low_priority) adcThresholdIsr(void)
+{
+	uint8_t mask = (uint8_t)(1 << currentSensor);
+	bool touched = touchFilterUpdate(&filters[currentSensor], (int16_t)ADERR, TOUCH_DEBOUNCE);
+	if(touched != ((touchedSensors & mask) != 0))
+	{
+		// Report change to the input library
+		touchedSensors ^= mask;
+		inputTouchChanged(currentSensor, touched);
+	}
+	currentSensor++;
+	if(currentSensor == NUM_SENSORS)
+		currentSensor = 0;
+	ADPCHbits.PCH = sensors[currentSensor];
+	ADTIF = 0;
+}
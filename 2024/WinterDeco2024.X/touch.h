@@ -4,6 +4,12 @@
  * @brief Driver for CVD-based touch sensors using the ADC
  * Uses Pins RA4 (left arm), RA5 (left foot), RB6 (hat), RB5 (right arm),
  * RB4 (right foot) for the sensors, RC7 for Guard A, and RB7 for Guard B. 
+ * 
+ * While running, the sensors are scanned in the background: Timer 4 starts a
+ * conversion every 2ms and the ADC interrupt processes the result of each
+ * (double-sampled) measurement before moving on to the next sensor. Each
+ * sensor is thus measured every 20ms. The results are compared against a
+ * slowly adapting baseline and debounced (see touchfilter.h). 
  */
 
 #ifndef TOUCH_H
@@ -63,11 +69,74 @@ extern const char* SENSOR_NAMES[NUM_SENSORS];
  */
 void touchInit(void);
 
+/**
+ * @brief Loads the calibration of the sensors from the EEPROM
+ * @details The calibration sets the untouched level and the press threshold
+ * of each sensor. 
+ * @return Returns true if a valid calibration has been loaded, false if
+ * there is none (the default thresholds are used then). 
+ */
+bool touchLoadCalibration(void);
+
+/**
+ * @brief Calibrates the sensors and stores the calibration in the EEPROM
+ * @details Measures each sensor repeatedly and derives the press threshold
+ * from the noise. The sensors must not be touched meanwhile. Takes less than
+ * 100ms. The background scan must be stopped. 
+ */
+void touchCalibrate(void);
+
+/**
+ * @brief Starts scanning the sensors in the background
+ * @details Interrupts must be enabled globally separately. 
+ */
+void touchStart(void);
+
+/**
+ * @brief Stops scanning the sensors and powers down the ADC
+ */
+void touchStop(void);
+
 /**
  * @brief Determine if the sensor is currently touched or not
+ * @details Uses the latest debounced result of the background scan, i.e.
+ * this does not wait for the ADC. 
  * @param sensor The sensor to be checked.
  * @return Returns true if the sensor is touched, otherwise false.
  */
 bool isTouched(Sensor sensor);
 
+/**
+ * @brief Measure if the sensor is currently touched or not
+ * @details Performs a measurement and waits for it to finish. This must only
+ * be used while the background scan is stopped (e.g. during sleep). The
+ * result is not debounced. 
+ * @param sensor The sensor to be checked.
+ * @return Returns true if the sensor is touched, otherwise false.
+ */
+bool touchMeasure(Sensor sensor);
+
+/**
+ * @brief Lets the ADC watch a sensor on its own
+ * @details Timer 4 (on LFINTOSC) triggers measurements, which the ADC performs
+ * with its own oscillator. If a measurement exceeds the baseline by
+ * its press threshold, the ADC threshold interrupt flag is set, which wakes the
+ * device from sleep. The background scan must be stopped and interrupts must
+ * be disabled globally (otherwise the scan's ISR would handle the flag). 
+ * Uses Timer 4 and the ADC until touchWakeDisable() is called. 
+ * @param sensor The sensor to be watched.
+ * @param steps Number of times the interval between measurements (256ms) is
+ * doubled, at most 3.
+ */
+void touchWakeEnable(Sensor sensor, uint8_t steps);
+
+/**
+ * @brief Stops watching the sensor
+ * @details Clears the ADC threshold interrupt flag and powers down the ADC and
+ * Timer 4. 
+ * @return Returns true if the ADC has detected a touch (so it woke the
+ * device), otherwise false.
+ */
+bool touchWakeDisable(void);
+
 #endif // TOUCH_H
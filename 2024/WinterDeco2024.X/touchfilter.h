@@ -0,0 +1,94 @@
+/**
+ * @file touchfilter.h
+ * @date 2026-10-18
+ * @brief Signal processing for CVD touch sensor measurements
+ * 
+ * Each sensor has its own filter. The filter tracks the untouched level of
+ * the sensor (baseline) with a slow IIR low-pass filter, so that drift caused
+ * by humidity, temperature or battery voltage does not lead to false or
+ * missed touches. A touch is detected when the measurement exceeds the
+ * baseline by a certain amount (with hysteresis) for a number of consecutive
+ * measurements (debouncing). The baseline is frozen while the sensor is
+ * touched. 
+ * 
+ * This module does not access any hardware, so it can also be compiled for
+ * the host. 
+ */
+
+#ifndef TOUCHFILTER_H
+#define	TOUCHFILTER_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/**
+ * @brief Default amount by which a measurement must exceed the baseline to
+ * count as a touch
+ * @details Used until the filter is calibrated. 
+ */
+#define TOUCH_FILTER_PRESS 600
+
+/**
+ * @brief Default amount by which a measurement must exceed the baseline to
+ * keep counting as a touch once the sensor is touched
+ * @details Used until the filter is calibrated. 
+ */
+#define TOUCH_FILTER_RELEASE 300
+
+/**
+ * @brief Time constant of the baseline filter (as power of 2, in
+ * measurements)
+ * @details Each untouched measurement moves the baseline by 1/64 of its
+ * distance to the measurement. 
+ */
+#define TOUCH_FILTER_SHIFT 6
+
+/**
+ * @brief State of the filter for one sensor
+ */
+typedef struct
+{
+	int32_t baseline;		// Baseline, scaled by 2^TOUCH_FILTER_SHIFT
+	int16_t press;			// Threshold above baseline for touches
+	int16_t release;		// Threshold above baseline for releases
+	uint8_t count;			// Number of consecutive measurements contradicting the current state
+	bool touched;			// Current (debounced) state
+	bool initialised;		// Baseline has been set from the first measurement
+} TouchFilter;
+
+/**
+ * @brief Resets the filter
+ * @details The baseline is set from the next measurement, the default
+ * thresholds are used. 
+ * @param filter The filter to be reset.
+ */
+void touchFilterReset(TouchFilter* filter);
+
+/**
+ * @brief Sets the baseline and thresholds from a calibration
+ * @details The release threshold is half of the press threshold. 
+ * @param filter The filter to be calibrated.
+ * @param baseline The untouched level of the sensor (in ADERR units).
+ * @param press Amount by which a measurement must exceed the baseline to
+ * count as a touch.
+ */
+void touchFilterCalibrate(TouchFilter* filter, int16_t baseline, int16_t press);
+
+/**
+ * @brief Processes a new measurement
+ * @param filter The filter of the sensor that was measured.
+ * @param sample The measurement (ADERR of the CVD measurement).
+ * @param debounce Number of consecutive measurements that are required to
+ * change the state. Pass 1 to change it immediately. 
+ * @return Returns true if the sensor is touched, otherwise false.
+ */
+bool touchFilterUpdate(TouchFilter* filter, int16_t sample, uint8_t debounce);
+
+/**
+ * @brief Returns the current baseline
+ * @param filter The filter of the sensor.
+ * @return Returns the baseline (in ADERR units).
+ */
+int16_t touchFilterBaseline(const TouchFilter* filter);
+
+#endif // TOUCHFILTER_H
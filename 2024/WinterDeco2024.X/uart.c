@@ -5,9 +5,27 @@
  */
 
 #include<xc.h>
+#include<stdint.h>
 #include<stdio.h>
 #include"uart.h"
 
+/**
+ * @brief Transmit buffer
+ * @details Ring buffer written by uartSend() and read by the transmit
+ * interrupt. Each index is written by only one side. 
+ */
+static volatile char txBuffer[UART_TX_BUFFER_SIZE];
+
+/**
+ * @brief Index where uartSend() writes the next byte
+ */
+static volatile uint8_t txHead = 0;
+
+/**
+ * @brief Index of the next byte to be transmitted
+ */
+static volatile uint8_t txTail = 0;
+
 void uartInit(void)
 {
 	// Set up baud rate generator:
@@ -24,16 +42,60 @@ void uartInit(void)
 	TRISAbits.TRISA2 = 0;		// Direction: Output
 }
 
+/**
+ * @brief Moves the next byte from the transmit buffer to the UART
+ * @details Must only be called when the UART can accept a byte (U1TXIF).
+ * Disables the transmit interrupt once the buffer is empty. 
+ */
+static void transmitNext(void)
+{
+	uint8_t tail = txTail;
+	if(tail == txHead)
+	{
+		PIE4bits.U1TXIE = 0;
+		return;
+	}
+	U1TXB = txBuffer[tail];
+	txTail = (tail + 1) & (UART_TX_BUFFER_SIZE - 1);
+}
+
+/**
+ * @brief Transmits from the buffer by polling if interrupts are disabled
+ * @details Called while waiting for the buffer, so waiting with interrupts
+ * disabled doesn't deadlock. 
+ */
+static void transmitPolled(void)
+{
+	if(!INTCON0bits.GIE && PIR4bits.U1TXIF)
+		transmitNext();
+}
+
 void uartSend(char c)
 {
-	// Wait for transmit buffer to become empty
-	while(PIR4bits.U1TXIF == 0);
-	// Copy c to transmit buffer
-	U1TXB = c;
+	uint8_t head = txHead;
+	uint8_t next = (head + 1) & (UART_TX_BUFFER_SIZE - 1);
+	while(next == txTail)
+	{
+		// Buffer is full
+#if UART_TX_BLOCK
+		transmitPolled();
+#else
+		return;
+#endif
+	}
+	txBuffer[head] = c;
+	txHead = next;
+	
+	// (Re-)enable the transmit interrupt, it is disabled once the buffer is
+	// empty
+	PIE4bits.U1TXIE = 1;
 }
 
 void uartFlush(void)
 {
+	// Wait until the buffer is empty
+	while(txHead != txTail)
+		transmitPolled();
 	// Wait until everything from the transmit buffer and the transmit shift
 	// register has been sent
 	while(U1ERRIRbits.TXMTIF == 0);
@@ -50,3 +112,13 @@ void putch(char c)
 {
 	uartSend(c);
 }
+
+/**
+ * @brief Interrupt handler for the UART transmitter
+ * @details Called while the UART can accept a byte and the transmit interrupt
+ * is enabled. 
+ */
+void __interrupt(irq(U1TX), low_priority) uartTxIsr(void)
+{
+	transmitNext();
+}
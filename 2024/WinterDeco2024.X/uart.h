@@ -5,11 +5,28 @@
  * 
  * Only implements 8-bit data mode @250kBaud
  * Has printf() functionality
+ * 
+ * Output is buffered and transmitted by the UART transmit interrupt, so
+ * printf() returns right away instead of waiting about 40us per byte. While
+ * interrupts are disabled, the buffer is emptied by polling instead. 
  */
 
 #ifndef UART_H
 #define	UART_H
 
+/**
+ * @brief Size of the transmit buffer in bytes
+ * @details Must be a power of 2 (at most 128). 
+ */
+#define UART_TX_BUFFER_SIZE 64
+
+/**
+ * @brief Behaviour when the transmit buffer is full
+ * @details If 1, uartSend() waits until there is room in the buffer. If 0,
+ * the byte is dropped, so output can never stall the caller. 
+ */
+#define UART_TX_BLOCK 1
+
 /**
  * @brief Initialises the driver
  */
@@ -18,15 +35,15 @@ void uartInit(void);
 /**
  * @brief Transmit a byte over UART
  * 
- * While this function is non-blocking, it will still busy wait until the
- * transmit buffer is free. After writing the byte to the transmit buffer, it
- * will however not wait for it to be transmitted. 
+ * The byte is put into the transmit buffer and sent in the background. If the
+ * buffer is full, this waits or drops the byte (see UART_TX_BLOCK). 
  * @param c The byte to be transmitted
  */
 void uartSend(char c);
 
 /**
  * @brief Wait until everything has been transmitted
+ * @details Call before going to sleep. 
  */
 void uartFlush(void);
 
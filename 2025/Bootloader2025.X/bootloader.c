@@ -0,0 +1,200 @@
+/**
+ * @file bootloader.c
+ * @date 2026-10-18
+ * @brief UART bootloader (see bootloader.h)
+ * 
+ * Must fit into the boot block: Nothing here uses interrupts, the UART and the
+ * NVM controller are polled. 
+ */
+
+/**
+ * @brief PIC18F14Q41 Configuration Bit Settings
+ * @details Must be the same as in the application (see main.c), the
+ * bootloader can't change them. 
+ */
+// CONFIG1
+#pragma config FEXTOSC = OFF    // External Oscillator Selection (Oscillator not enabled)
+#pragma config RSTOSC = HFINTOSC_64MHZ// Reset Oscillator Selection (HFINTOSC with HFFRQ = 64 MHz and CDIV = 1:1)
+// CONFIG2
+#pragma config CLKOUTEN = OFF   // Clock out Enable bit (CLKOUT function is disabled)
+#pragma config PR1WAY = ON      // PRLOCKED One-Way Set Enable bit (PRLOCKED bit can be cleared and set only once)
+#pragma config CSWEN = ON       // Clock Switch Enable bit (Writing to NOSC and NDIV is allowed)
+#pragma config FCMEN = ON       // Fail-Safe Clock Monitor Enable bit (Fail-Safe Clock Monitor enabled)
+#pragma config FCMENP = ON      // Fail-Safe Clock Monitor - Primary XTAL Enable bit (Fail-Safe Clock Monitor enabled; timer will flag FSCMP bit and OSFIF interrupt on EXTOSC failure.)
+#pragma config FCMENS = ON      // Fail-Safe Clock Monitor - Secondary XTAL Enable bit (Fail-Safe Clock Monitor enabled; timer will flag FSCMP bit and OSFIF interrupt on SOSC failure.)
+// CONFIG3
+#pragma config MCLRE = EXTMCLR  // MCLR Enable bit (If LVP = 0, MCLR pin is MCLR; If LVP = 1, RE3 pin function is MCLR )
+#pragma config PWRTS = PWRT_OFF // Power-up timer selection bits (PWRT is disabled)
+#pragma config MVECEN = ON      // Multi-vector enable bit (Multi-vector enabled, Vector table used for interrupts)
+#pragma config IVT1WAY = ON     // IVTLOCK bit One-way set enable bit (IVTLOCKED bit can be cleared and set only once)
+#pragma config LPBOREN = OFF    // Low Power BOR Enable bit (Low-Power BOR disabled)
+#pragma config BOREN = SBORDIS  // Brown-out Reset Enable bits (Brown-out Reset enabled , SBOREN bit is ignored)
+// CONFIG4
+#pragma config BORV = VBOR_1P9  // Brown-out Reset Voltage Selection bits (Brown-out Reset Voltage (VBOR) set to 1.9V)
+#pragma config ZCD = OFF        // ZCD Disable bit (ZCD module is disabled. ZCD can be enabled by setting the ZCDSEN bit of ZCDCON)
+#pragma config PPS1WAY = ON     // PPSLOCK bit One-Way Set Enable bit (PPSLOCKED bit can be cleared and set only once; PPS registers remain locked after one clear/set cycle)
+#pragma config STVREN = ON      // Stack Full/Underflow Reset Enable bit (Stack full/underflow will cause Reset)
+#pragma config LVP = ON         // Low Voltage Programming Enable bit (Low voltage programming enabled. MCLR/VPP pin function is MCLR. MCLRE configuration bit is ignored)
+#pragma config XINST = OFF      // Extended Instruction Set Enable bit (Extended Instruction Set and Indexed Addressing Mode disabled)
+// CONFIG5
+#pragma config WDTCPS = WDTCPS_31// WDT Period selection bits (Divider ratio 1:65536; software control of WDTPS)
+#pragma config WDTE = SWDTEN    // WDT operating mode (WDT enabled/disabled by SWDTEN bit)
+// CONFIG6
+#pragma config WDTCWS = WDTCWS_7// WDT Window Select bits (window always open (100%); software control; keyed access not required)
+#pragma config WDTCCS = SC      // WDT input clock selector (Software Control)
+// CONFIG7
+#pragma config BBSIZE = BBSIZE_512// Boot Block Size selection bits (Boot Block size is 512 words)
+#pragma config BBEN = OFF       // Boot Block enable bit (Boot block disabled)
+#pragma config SAFEN = OFF      // Storage Area Flash enable bit (SAF disabled)
+#pragma config DEBUG = OFF      // Background Debugger (Background Debugger disabled)
+// CONFIG8
+#pragma config WRTB = OFF       // Boot Block Write Protection bit (Boot Block not Write protected)
+#pragma config WRTC = OFF       // Configuration Register Write Protection bit (Configuration registers not Write protected)
+#pragma config WRTD = OFF       // Data EEPROM Write Protection bit (Data EEPROM not Write protected)
+#pragma config WRTSAF = OFF     // SAF Write protection bit (SAF not Write Protected)
+#pragma config WRTAPP = OFF     // Application Block write protection bit (Application Block not write protected)
+// CONFIG9
+#pragma config CP = OFF         // PFM and Data EEPROM Code Protection bit (PFM and Data EEPROM code protection disabled)
+
+#define _XTAL_FREQ 64000000
+
+#include<xc.h>
+#include"bootloader.h"
+
+uint8_t bootReceive(void)
+{
+	while(!PIR4bits.U1RXIF);
+	return U1RXB;
+}
+
+void bootSend(uint8_t data)
+{
+	while(!PIR4bits.U1TXIF);
+	U1TXB = data;
+}
+
+/**
+ * @brief Executes the NVM command that has been selected
+ * @details Interrupts are never enabled, so the unlock sequence can't be
+ * interrupted. 
+ */
+static void nvmExecute(void)
+{
+	NVMLOCK = 0x55;
+	NVMLOCK = 0xAA;
+	NVMCON0bits.GO = 1;
+	while(NVMCON0bits.GO);
+	NVMCON1bits.CMD = 0b000;	// Back to reading (no accidental writes)
+}
+
+/**
+ * @brief Selects an address in the program flash memory
+ */
+static void nvmAddress(uint16_t address)
+{
+	NVMADRU = 0x00;
+	NVMADRH = (uint8_t)(address >> 8);
+	NVMADRL = (uint8_t)address;
+}
+
+void bootErase(uint16_t address)
+{
+	nvmAddress(address);
+	NVMCON1bits.CMD = 0b110;	// Erase page
+	nvmExecute();
+}
+
+void bootWrite(uint16_t address, uint16_t data)
+{
+	nvmAddress(address);
+	NVMDATH = (uint8_t)(data >> 8);
+	NVMDATL = (uint8_t)data;
+	NVMCON1bits.CMD = 0b011;	// Write word
+	nvmExecute();
+}
+
+uint16_t bootRead(uint16_t address)
+{
+	nvmAddress(address);
+	NVMCON1bits.CMD = 0b001;	// Read word
+	NVMCON0bits.GO = 1;
+	while(NVMCON0bits.GO);
+	return ((uint16_t)NVMDATH << 8) | NVMDATL;
+}
+
+void bootCrcStart(void)
+{
+	CRCCON0bits.GO = 0;
+	CRCCON0bits.EN = 1;
+	CRCCON0bits.ACCM = 1;		// Augment the data with zeros (standard CRC)
+	CRCCON0bits.SHIFTM = 0;		// Most significant bit first
+	CRCCON1bits.PLEN = 15;		// 16-bit polynomial
+	CRCCON1bits.DLEN = 7;		// 8-bit data
+	CRCXORH = 0x10;				// Polynomial 0x1021 (x^16 is implied)
+	CRCXORL = 0x21;
+	CRCACCH = 0xff;				// Start value 0xffff
+	CRCACCL = 0xff;
+	CRCCON0bits.GO = 1;
+}
+
+void bootCrcAdd(uint8_t data)
+{
+	while(CRCCON0bits.FULL);
+	CRCDATL = data;
+}
+
+uint16_t bootCrcResult(void)
+{
+	while(CRCCON0bits.BUSY);
+	CRCCON0bits.GO = 0;
+	return ((uint16_t)CRCACCH << 8) | CRCACCL;
+}
+
+/**
+ * @brief Starts the application
+ * @details Its reset vector is at BOOT_APP_START. 
+ */
+static void startApplication(void)
+{
+	asm("goto 0x400");
+}
+
+/**
+ * @brief Main function
+ */
+void main(void)
+{
+	// Stay in the bootloader after a RESET instruction, while the right
+	// button (RB6, active low) is held or if there is no application
+	bool requested = !PCON0bits.RI;
+	PCON0bits.RI = 1;
+	ANSELBbits.ANSELB6 = 0;
+	WPUBbits.WPUB6 = 1;
+	__delay_us(100);			// Let the pull-up charge the pin
+	if(!requested && PORTBbits.RB6 && bootRead(BOOT_APP_START) != 0xffff)
+		startApplication();
+	
+	// Set up the UART like the application does (250kBaud, TX on RA2, RX on
+	// RA1), but without interrupts
+	U1CON0bits.BRGS = 0;		// Normal baud rate: F_OSC/(16*(U2BRG+1))
+	U1BRG = 15;					// = 64MHz/(16*(15+1)) = 250kBaud
+	U1CON0bits.MODE = 0b0000;	// Asynchronous 8-bit w/o parity
+	U1CON1bits.ON = 1;
+	U1CON0bits.TXEN = 1;
+	RA2PPS = 0x10;				// UART1_TX
+	TRISAbits.TRISA2 = 0;
+	ANSELAbits.ANSELA1 = 0;
+	TRISAbits.TRISA1 = 1;
+	WPUAbits.WPUA1 = 1;
+	U1RXPPS = 0x01;				// RA1
+	U1CON0bits.RXEN = 1;
+	
+	// Announce that we are ready, then execute commands
+	bootSend(BOOT_OK);
+	while(bootCommand());
+	
+	// Let the last reply go out, then leave the UART to the application
+	while(!U1ERRIRbits.TXMTIF);
+	U1CON1bits.ON = 0;
+	startApplication();
+}
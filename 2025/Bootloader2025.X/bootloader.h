@@ -0,0 +1,140 @@
+/**
+ * @file bootloader.h
+ * @date 2026-10-18
+ * @brief Memory map and protocol of the UART bootloader
+ * 
+ * The bootloader lives in the boot block (512 words, see BBSIZE in the
+ * configuration bits) and updates the application or the animation area
+ * (see animation.h) over the UART at 250kBaud, so no PIC programmer is needed
+ * after it has been flashed once. It runs after a reset if the application
+ * has asked for it (command "boot" on the console, which executes a RESET
+ * instruction), if the right button is held while the battery is inserted,
+ * or if there is no application. Otherwise it starts the application right
+ * away. 
+ * 
+ * The application is linked with a code offset of BOOT_APP_START (and its
+ * interrupt vector table follows it), the animation area is kept free. As an
+ * erased boot block reads as NOPs, the application also runs without the
+ * bootloader. 
+ * 
+ * The host sends commands, each answered with a status byte (BOOT_OK or an
+ * error) and, for some, data. All numbers are little-endian. 
+ * - BOOT_INFO: Answered with BOOT_VERSION, BOOT_APP_START,
+ *   BOOT_ANIMATION_START, BOOT_FLASH_END and BOOT_PAGE_SIZE (2 bytes each
+ *   except for the version)
+ * - BOOT_WRITE, address (2 bytes), BOOT_PAGE_SIZE bytes of data, CRC of the
+ *   address and the data (2 bytes): Erases and writes a page and reads it
+ *   back. The page must lie between BOOT_APP_START and BOOT_FLASH_END. 
+ * - BOOT_CHECK, address (2 bytes), length (2 bytes): Answered with the CRC of
+ *   the flash memory in that range (2 bytes)
+ * - BOOT_RUN, BOOT_RUN ^ 0xff: Starts the application (the second byte
+ *   keeps stray data from starting it after a lost byte)
+ * 
+ * If a byte is lost, the rest of a command is taken as commands, which are
+ * answered with BOOT_ERROR_COMMAND (or fail the CRC). The host resyncs by
+ * sending BOOT_PAGE_SIZE + 4 zeros and discarding the replies. 
+ * 
+ * The CRC is CRC-16/CCITT-FALSE (polynomial 0x1021, start value 0xffff, no
+ * reflection), computed by the CRC module. 
+ * Tools/flashupload.c is the uploader for the PC. It writes the first page
+ * of the application last, so an interrupted upload doesn't leave a broken
+ * application that would be started. 
+ */
+
+#ifndef BOOTLOADER_H
+#define	BOOTLOADER_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/**
+ * @brief Version of the protocol
+ */
+#define BOOT_VERSION 1
+
+/**
+ * @brief Start of the application (end of the boot block)
+ */
+#define BOOT_APP_START 0x0400
+
+/**
+ * @brief Start of the animation area (end of the application)
+ */
+#define BOOT_ANIMATION_START 0x3800
+
+/**
+ * @brief End of the program flash memory
+ */
+#define BOOT_FLASH_END 0x4000
+
+/**
+ * @brief Size of a page, the unit of erasing (in bytes)
+ */
+#define BOOT_PAGE_SIZE 256
+
+/**
+ * @brief Commands
+ */
+#define BOOT_INFO 'i'
+#define BOOT_WRITE 'w'
+#define BOOT_CHECK 'c'
+#define BOOT_RUN 'r'
+
+/**
+ * @brief Status bytes
+ */
+#define BOOT_OK 'K'
+#define BOOT_ERROR_COMMAND '?'	// Unknown command
+#define BOOT_ERROR_CRC 'C'		// Data received with a wrong CRC
+#define BOOT_ERROR_ADDRESS 'A'	// Range outside of the writable flash
+#define BOOT_ERROR_VERIFY 'V'	// Page read back differs
+
+/**
+ * @brief Receives and executes a command
+ * @details Implemented in bootprotocol.c on top of the functions below,
+ * which bootloader.c implements for the device. 
+ * @return Returns false if the application is to be started. 
+ */
+bool bootCommand(void);
+
+/**
+ * @brief Waits for a byte from the UART
+ */
+uint8_t bootReceive(void);
+
+/**
+ * @brief Sends a byte over the UART
+ */
+void bootSend(uint8_t data);
+
+/**
+ * @brief Erases the page of flash memory at an address
+ */
+void bootErase(uint16_t address);
+
+/**
+ * @brief Writes a word to erased flash memory
+ */
+void bootWrite(uint16_t address, uint16_t data);
+
+/**
+ * @brief Reads a word from flash memory
+ */
+uint16_t bootRead(uint16_t address);
+
+/**
+ * @brief Starts a new CRC
+ */
+void bootCrcStart(void);
+
+/**
+ * @brief Adds a byte to the CRC
+ */
+void bootCrcAdd(uint8_t data);
+
+/**
+ * @brief Returns the CRC of the bytes added since bootCrcStart()
+ */
+uint16_t bootCrcResult(void);
+
+#endif // BOOTLOADER_H
@@ -0,0 +1,122 @@
+/**
+ * @file bootprotocol.c
+ * @date 2026-10-18
+ * @brief Implements the protocol of bootloader.h
+ * 
+ * Only uses the functions declared in bootloader.h to access the hardware, so
+ * Tools/flashupload.c can run it against a simulated flash memory. 
+ */
+
+#include"bootloader.h"
+
+/**
+ * @brief The page being written
+ */
+static uint8_t page[BOOT_PAGE_SIZE];
+
+/**
+ * @brief Receives a word and adds it to the CRC
+ */
+static uint16_t receiveWord(void)
+{
+	uint8_t low = bootReceive();
+	uint8_t high = bootReceive();
+	bootCrcAdd(low);
+	bootCrcAdd(high);
+	return ((uint16_t)high << 8) | low;
+}
+
+/**
+ * @brief Sends a word
+ */
+static void sendWord(uint16_t data)
+{
+	bootSend((uint8_t)data);
+	bootSend((uint8_t)(data >> 8));
+}
+
+/**
+ * @brief Receives a page and writes it
+ * @return Returns the status. 
+ */
+static uint8_t writePage(void)
+{
+	bootCrcStart();
+	uint16_t address = receiveWord();
+	for(uint16_t i = 0; i < BOOT_PAGE_SIZE; i++)
+	{
+		page[i] = bootReceive();
+		bootCrcAdd(page[i]);
+	}
+	uint16_t crc = bootCrcResult();
+	bootCrcStart();
+	if(receiveWord() != crc)
+		return BOOT_ERROR_CRC;
+	if(address < BOOT_APP_START || address >= BOOT_FLASH_END || (address & (BOOT_PAGE_SIZE - 1)))
+		return BOOT_ERROR_ADDRESS;
+	
+	bootErase(address);
+	for(uint16_t i = 0; i < BOOT_PAGE_SIZE; i += 2)
+		bootWrite(address + i, ((uint16_t)page[i + 1] << 8) | page[i]);
+	for(uint16_t i = 0; i < BOOT_PAGE_SIZE; i += 2)
+		if(bootRead(address + i) != (((uint16_t)page[i + 1] << 8) | page[i]))
+			return BOOT_ERROR_VERIFY;
+	return BOOT_OK;
+}
+
+/**
+ * @brief Receives a range and sends the CRC of the flash memory in it
+ */
+static void checkRange(void)
+{
+	uint16_t address = receiveWord();
+	uint16_t length = receiveWord();
+	if(address >= BOOT_FLASH_END || length > BOOT_FLASH_END - address || ((address | length) & 1))
+	{
+		bootSend(BOOT_ERROR_ADDRESS);
+		return;
+	}
+	
+	bootCrcStart();
+	for(uint16_t i = 0; i < length; i += 2)
+	{
+		uint16_t data = bootRead(address + i);
+		bootCrcAdd((uint8_t)data);
+		bootCrcAdd((uint8_t)(data >> 8));
+	}
+	bootSend(BOOT_OK);
+	sendWord(bootCrcResult());
+}
+
+bool bootCommand(void)
+{
+	switch(bootReceive())
+	{
+		case BOOT_INFO:
+			bootSend(BOOT_OK);
+			bootSend(BOOT_VERSION);
+			sendWord(BOOT_APP_START);
+			sendWord(BOOT_ANIMATION_START);
+			sendWord(BOOT_FLASH_END);
+			sendWord(BOOT_PAGE_SIZE);
+			break;
+		case BOOT_WRITE:
+			bootSend(writePage());
+			break;
+		case BOOT_CHECK:
+			checkRange();
+			break;
+		case BOOT_RUN:
+			if(bootReceive() != (uint8_t)~BOOT_RUN)
+			{
+				bootSend(BOOT_ERROR_COMMAND);
+				break;
+			}
+			bootSend(BOOT_OK);
+			return false;
+		default:
+			bootSend(BOOT_ERROR_COMMAND);
+			break;
+	}
+	return true;
+}
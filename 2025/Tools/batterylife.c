@@ -0,0 +1,284 @@
+/**
+ * @file batterylife.c
+ * @date 2026-10-18
+ * @brief Estimates the CR2032 runtime of each program (runs on Linux)
+ *
+ * Runs the initFunction/updateFunction of each program from programs.c for a
+ * simulated day against a mocked LED driver and records the LED duty and the
+ * amount of work done. Together with a parameter file (see batterylife.txt)
+ * this is turned into an average current and a runtime on a fresh battery.
+ * Optimisations of the driver or the main loop can thus be judged before
+ * flashing.
+ *
+ * Build and run (in this directory):
+ *   gcc -std=c99 -O2 -I. -I../WinterDeco2025.X -o batterylife batterylife.c xc.c \
+ *       ../WinterDeco2025.X/programs.c ../WinterDeco2025.X/timebase.c
+ *   ./batterylife [batterylife.txt]
+ */
+
+#include<xc.h>
+#include<stdio.h>
+#include<stddef.h>
+#include<stdlib.h>
+#include<string.h>
+#include"led.h"
+#include"input.h"
+#include"timebase.h"
+#include"programs.h"
+
+// Interrupt handler of the timebase (see timebase.c)
+void timer2Isr(void);
+
+//-----------------------------------------------------------------------------
+// Parameters
+
+/**
+ * @brief Model parameters as read from the parameter file
+ */
+typedef struct
+{
+	double batteryCapacity;		// mAh
+	double batteryVoltage;		// mV (typical under load)
+	double ledForwardVoltage;	// mV of the selected colour
+	double ledResistor;			// Ohm
+	double ledReferenceVoltage;	// mV, see ledCompensateBattery() (0: off)
+	double mcuActive;			// uA, core running at 64MHz
+	double mcuIdle;				// uA, core idle, peripherals running
+	double mcuSleep;			// uA, sleep incl. button wake-up
+	double isrRate;				// Hz, LED scan interrupts
+	double isrCycles;			// Instruction cycles per scan interrupt
+	double updateCycles;		// Instruction cycles per program update
+	double ledSetCycles;		// Instruction cycles per ledSet()
+	double mainLoopIdles;		// 1 if the core idles while waiting for a tick
+	double awakeHours;			// Hours per day the device is on
+} Parameters;
+
+/**
+ * @brief Reads the parameter file
+ * @details Each line holds a key and a value, "led <colour> <mV>" lines give
+ * the forward voltage per colour and "colour <colour>" selects one.
+ * Everything after a # is ignored.
+ * @param path Path of the file.
+ * @param params Receives the parameters.
+ * @return Returns 0 on success.
+ */
+static int readParameters(const char* path, Parameters* params)
+{
+	FILE* file = fopen(path, "r");
+	if(!file)
+	{
+		perror(path);
+		return -1;
+	}
+
+	struct { char name[16]; double forward; } colours[8];
+	int numColours = 0;
+	char colour[16] = "";
+	char line[128];
+	int lineNumber = 0;
+	memset(params, 0, sizeof(Parameters));
+	while(fgets(line, sizeof(line), file))
+	{
+		lineNumber++;
+		char* comment = strchr(line, '#');
+		if(comment)
+			*comment = '\0';
+		char key[32], name[16];
+		double value;
+		if(sscanf(line, "%31s", key) != 1)
+			continue;
+		if(strcmp(key, "led") == 0 && numColours < 8 && sscanf(line, "%*s %15s %lf", name, &value) == 2)
+		{
+			strcpy(colours[numColours].name, name);
+			colours[numColours++].forward = value;
+			continue;
+		}
+		if(strcmp(key, "colour") == 0 && sscanf(line, "%*s %15s", colour) == 1)
+			continue;
+		if(sscanf(line, "%*s %lf", &value) != 1)
+		{
+			fprintf(stderr, "%s:%d: Missing value\n", path, lineNumber);
+			fclose(file);
+			return -1;
+		}
+		static const struct { const char* key; size_t offset; } KEYS[] =
+		{
+			{"battery_capacity_mah", offsetof(Parameters, batteryCapacity)},
+			{"battery_mv", offsetof(Parameters, batteryVoltage)},
+			{"led_resistor_ohm", offsetof(Parameters, ledResistor)},
+			{"led_reference_mv", offsetof(Parameters, ledReferenceVoltage)},
+			{"mcu_active_ua", offsetof(Parameters, mcuActive)},
+			{"mcu_idle_ua", offsetof(Parameters, mcuIdle)},
+			{"mcu_sleep_ua", offsetof(Parameters, mcuSleep)},
+			{"isr_rate_hz", offsetof(Parameters, isrRate)},
+			{"isr_cycles", offsetof(Parameters, isrCycles)},
+			{"update_cycles", offsetof(Parameters, updateCycles)},
+			{"ledset_cycles", offsetof(Parameters, ledSetCycles)},
+			{"main_loop_idles", offsetof(Parameters, mainLoopIdles)},
+			{"awake_hours", offsetof(Parameters, awakeHours)}
+		};
+		size_t i;
+		for(i = 0; i < sizeof(KEYS) / sizeof(KEYS[0]); i++)
+			if(strcmp(key, KEYS[i].key) == 0)
+				break;
+		if(i == sizeof(KEYS) / sizeof(KEYS[0]))
+		{
+			fprintf(stderr, "%s:%d: Unknown key \"%s\"\n", path, lineNumber, key);
+			fclose(file);
+			return -1;
+		}
+		*(double*)((char*)params + KEYS[i].offset) = value;
+	}
+	fclose(file);
+
+	for(int i = 0; i < numColours; i++)
+		if(strcmp(colours[i].name, colour) == 0)
+			params->ledForwardVoltage = colours[i].forward;
+	if(params->ledForwardVoltage == 0)
+	{
+		fprintf(stderr, "%s: No forward voltage for colour \"%s\"\n", path, colour);
+		return -1;
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Mocked drivers
+
+/**
+ * @brief Values of the LEDs as set by the program
+ */
+static uint8_t values[8][8];
+
+/**
+ * @brief Number of ledSet() calls
+ */
+static unsigned long ledSetCalls;
+
+void ledSet(uint8_t x, uint8_t y, uint8_t value)
+{
+	values[x][y] = value;
+	ledSetCalls++;
+}
+
+void ledSetAll(uint8_t value)
+{
+	for(uint8_t y = 0; y < 8; y++)
+		for(uint8_t x = 0; x < 8; x++)
+			ledSet(x, y, value);
+}
+
+bool inputIs(const InputRecord* record, Button button, InputEvent event)
+{
+	return record && record->button == button && record->event == event;
+}
+
+// The stream and animation programs (hidden) depend on the UART and the
+// flash memory, they are not simulated
+void streamInit(void) {}
+void streamUpdate(uint16_t dt, InputRecord* input) {}
+void animationInit(void) {}
+void animationUpdate(uint16_t dt, InputRecord* input) {}
+
+/**
+ * @brief Returns the LED load like ledLoad() in the driver
+ */
+static unsigned ledLoadNow(void)
+{
+	unsigned load = 0;
+	for(uint8_t y = 0; y < 8; y++)
+		for(uint8_t x = 0; x < 8; x++)
+			load += values[x][y] >> (8 - COLOUR_DEPTH);
+	return load;
+}
+
+//-----------------------------------------------------------------------------
+// Simulation
+
+/**
+ * @brief Simulated time per program (in ms)
+ */
+#define SIMULATED_TIME (24ul * 60 * 60 * 1000)
+
+/**
+ * @brief Results of the simulation of one program
+ */
+typedef struct
+{
+	double litLeds;				// Average number of lit LEDs
+	double updatesPerSecond;	// Program updates per second
+	double ledSetsPerSecond;	// ledSet() calls per second
+} Recording;
+
+/**
+ * @brief Runs a program for SIMULATED_TIME
+ * @param program The program.
+ * @param recording Receives the results.
+ */
+static void simulate(const Program* program, Recording* recording)
+{
+	memset(values, 0, sizeof(values));
+	ledSetCalls = 0;
+	timebaseInit();
+
+	program->initFunction();
+	double loadSum = 0;
+	unsigned long ticks = 0;
+	for(uint32_t now = 0; now < SIMULATED_TIME; now += TIMEBASE_TICK)
+	{
+		timer2Isr();
+		timebaseWaitTick();
+		program->updateFunction(TIMEBASE_TICK, NULL);
+		loadSum += ledLoadNow();
+		ticks++;
+	}
+
+	// A LED is lit for value / (2^COLOUR_DEPTH-1) of the time its row is
+	// selected (1/16)
+	recording->litLeds = loadSum / ticks / (16 * ((1 << COLOUR_DEPTH) - 1));
+	recording->updatesPerSecond = ticks * 1000.0 / SIMULATED_TIME;
+	recording->ledSetsPerSecond = ledSetCalls * 1000.0 / SIMULATED_TIME;
+}
+
+/**
+ * @brief Main function
+ */
+int main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "batterylife.txt";
+	Parameters params;
+	if(readParameters(path, &params) != 0)
+		return 1;
+
+	// Current through a lit LED; above the reference voltage the firmware
+	// scales the brightness to the current at the reference voltage
+	double ledVoltage = params.batteryVoltage;
+	if(params.ledReferenceVoltage > 0 && ledVoltage > params.ledReferenceVoltage)
+		ledVoltage = params.ledReferenceVoltage;
+	double ledCurrent = (ledVoltage - params.ledForwardVoltage) / params.ledResistor * 1000;
+	double sleepHours = 24 - params.awakeHours;
+
+	printf("Program           lit LEDs   LED mA   MCU mA  awake mA  mAh/day  runtime/days\n");
+	for(uint8_t i = 0; i < NUM_PROGRAMS; i++)
+	{
+		Recording recording;
+		simulate(&PROGRAMS[i], &recording);
+
+		// The core is busy with the scan interrupt, the program updates and
+		// the LED writes. Unless the main loop idles, it is active anyway.
+		double busy = (params.isrRate * params.isrCycles
+			+ recording.updatesPerSecond * params.updateCycles
+			+ recording.ledSetsPerSecond * params.ledSetCycles) / 16e6;
+		if(busy > 1)
+			busy = 1;
+		double mcuCurrent = params.mainLoopIdles != 0
+			? busy * params.mcuActive + (1 - busy) * params.mcuIdle
+			: params.mcuActive;
+		double awakeCurrent = recording.litLeds * ledCurrent + mcuCurrent;
+		double perDay = (awakeCurrent * params.awakeHours + params.mcuSleep * sleepHours) / 1000;
+		printf("%-16s %9.2f %8.2f %8.2f %9.2f %8.2f %13.1f\n", PROGRAMS[i].name,
+			recording.litLeds, recording.litLeds * ledCurrent / 1000, mcuCurrent / 1000,
+			awakeCurrent / 1000, perDay, params.batteryCapacity / perDay);
+	}
+	return 0;
+}
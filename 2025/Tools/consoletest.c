@@ -0,0 +1,300 @@
+/**
+ * @file consoletest.c
+ * @date 2026-10-18
+ * @brief Drives the command console of the firmware through a pty (runs on
+ * Linux)
+ *
+ * console.c and logger.c are compiled in unchanged. The UART driver is mocked
+ * by the slave side of a pseudo terminal, the test cases are written to the
+ * master side like a terminal would send them, including lines split across
+ * several writes. The other modules are mocked, so the test can check which
+ * calls a command has made. The replies are checked by their log message ID
+ * (see logmessages.h).
+ *
+ * Build and run (in this directory):
+ *   gcc -std=c99 -O2 -I. -I../WinterDeco2025.X -o consoletest consoletest.c \
+ *       ../WinterDeco2025.X/console.c ../WinterDeco2025.X/logger.c
+ *   ./consoletest
+ */
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include<xc.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<fcntl.h>
+#include<poll.h>
+#include<termios.h>
+#include<unistd.h>
+#include"console.h"
+#include"logger.h"
+#include"uart.h"
+#include"battery.h"
+#include"energy.h"
+#include"perf.h"
+#include"trace.h"
+#include"led.h"
+#include"autooff.h"
+
+//-----------------------------------------------------------------------------
+// Mocked drivers
+
+/**
+ * @brief Slave side of the pty (the firmware's UART)
+ */
+static int slave = -1;
+
+/**
+ * @brief Number of bytes received by the mocked UART
+ */
+static unsigned long received;
+
+/**
+ * @brief The last call of a mocked module, e.g. "brightness 128"
+ */
+static char effect[32];
+
+bool uartReceive(char* c)
+{
+	if(read(slave, c, 1) != 1)
+		return false;
+	received++;
+	return true;
+}
+
+void uartSend(char c)
+{
+	if(write(slave, &c, 1) != 1)
+		perror("write");
+}
+
+void uartSendBlock(const volatile void* data, uint16_t length, UartBlockCallback callback)
+{
+	const volatile char* bytes = data;
+	for(uint16_t i = 0; i < length; i++)
+		uartSend(bytes[i]);
+	if(callback)
+		callback();
+}
+
+uint16_t batteryCached(void)
+{
+	return 2900;
+}
+
+void energyReport(void)
+{
+	strcpy(effect, "energy");
+}
+
+void perfReport(void)
+{
+	strcpy(effect, "perf");
+}
+
+void traceDump(void)
+{
+	strcpy(effect, "trace");
+}
+
+void ledSetBrightnessLimit(uint8_t limit)
+{
+	snprintf(effect, sizeof(effect), "brightness %u", limit);
+}
+
+void ledSetLongLife(bool longLife)
+{
+	snprintf(effect, sizeof(effect), "longlife %d", longLife);
+}
+
+bool autoOffSetTimeout(uint16_t minutes)
+{
+	static const uint16_t TIMEOUTS[AUTOOFF_NUM_SETTINGS] = {0, 15, 30, 60, 120, 240};
+	for(int i = 0; i < AUTOOFF_NUM_SETTINGS; i++)
+	{
+		if(TIMEOUTS[i] == minutes)
+		{
+			snprintf(effect, sizeof(effect), "timeout %u", minutes);
+			return true;
+		}
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Test cases
+
+/**
+ * @brief No reply expected
+ */
+#define NO_REPLY (-1)
+
+/**
+ * @brief A test case
+ */
+typedef struct
+{
+	const char* input;		// Written to the pty
+	bool complete;			// consoleNext() returns true
+	ConsoleAction action;	// The request (if complete)
+	uint8_t program;		// Program of CONSOLE_PROGRAM
+	int reply;				// LogId of the reply or NO_REPLY
+	const char* text;		// String argument of the reply (or NULL)
+	const char* effect;		// Call of a mocked module ("" for none)
+} TestCase;
+
+static const TestCase TESTS[] =
+{
+	{"help\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_HELP, NULL, ""},
+	{"battery\r\n", true, CONSOLE_NONE, 0, LOG_BATTERY, NULL, ""},
+	{"\r\n\n", false, CONSOLE_NONE, 0, NO_REPLY, NULL, ""},
+	{"prog", false, CONSOLE_NONE, 0, NO_REPLY, NULL, ""},
+	{"ram 3\r", true, CONSOLE_PROGRAM, 3, NO_REPLY, NULL, ""},
+	{"program 255\n", true, CONSOLE_PROGRAM, 255, NO_REPLY, NULL, ""},
+	{"program 256\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "program 256", ""},
+	{"program 99999\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "program 99999", ""},
+	{"program\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "program", ""},
+	{"program x\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "program x", ""},
+	{"brightness 128\n", true, CONSOLE_NONE, 0, LOG_BRIGHTNESS_LIMIT, NULL, "brightness 128"},
+	{"brightness 256\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "brightness 256", ""},
+	{"longlife 1\n", true, CONSOLE_NONE, 0, LOG_LONG_LIFE, NULL, "longlife 1"},
+	{"longlife 2\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "longlife 2", ""},
+	{"timeout 30\n", true, CONSOLE_NONE, 0, NO_REPLY, NULL, "timeout 30"},
+	{"timeout 31\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "timeout 31", ""},
+	{"energy\n", true, CONSOLE_NONE, 0, NO_REPLY, NULL, "energy"},
+	{"perf\n", true, CONSOLE_NONE, 0, NO_REPLY, NULL, "perf"},
+	{"perf 1\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "perf 1", ""},
+	{"trace\n", true, CONSOLE_NONE, 0, NO_REPLY, NULL, "trace"},
+	{"sleep now\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "sleep now", ""},
+	{"Sleep\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "Sleep", ""},
+	{"this line is much too long for the console\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "this line is much too lo", ""},
+	{"boot 1\n", true, CONSOLE_NONE, 0, LOG_CONSOLE_ERROR, "boot 1", ""},
+	{"boot\n", true, CONSOLE_BOOT, 0, NO_REPLY, NULL, ""},
+	{"sleep\n", true, CONSOLE_SLEEP, 0, NO_REPLY, NULL, ""}
+};
+
+/**
+ * @brief Waits until a file descriptor is readable
+ * @param fd The file descriptor.
+ * @param timeout Timeout in ms.
+ * @return Returns false on timeout.
+ */
+static bool waitReadable(int fd, int timeout)
+{
+	struct pollfd pfd = {fd, POLLIN, 0};
+	return poll(&pfd, 1, timeout) == 1;
+}
+
+/**
+ * @brief Runs a test case
+ * @param master Master side of the pty.
+ * @param test The test case.
+ * @param written Number of bytes written to the pty so far (updated).
+ * @return Returns true if the test case has passed.
+ */
+static bool runTest(int master, const TestCase* test, unsigned long* written)
+{
+	size_t length = strlen(test->input);
+	if(write(master, test->input, length) != (ssize_t)length)
+	{
+		perror("write");
+		return false;
+	}
+	*written += length;
+	effect[0] = '\0';
+
+	// Let the console work with whatever has arrived, like the main loop
+	ConsoleRequest request = {CONSOLE_NONE, 0};
+	bool complete = false;
+	while(!(complete = consoleNext(&request)) && received < *written)
+		if(!waitReadable(slave, 1000))
+			break;
+
+	// Collect the reply until the line has been quiet for 20ms
+	unsigned char reply[64];
+	size_t replyLength = 0;
+	while(replyLength < sizeof(reply)
+		&& waitReadable(master, test->reply != NO_REPLY && replyLength == 0 ? 200 : 20))
+	{
+		ssize_t n = read(master, reply + replyLength, sizeof(reply) - replyLength);
+		if(n <= 0)
+			break;
+		replyLength += (size_t)n;
+	}
+
+	bool passed = true;
+	if(complete != test->complete)
+	{
+		printf("  consoleNext() returned %d\n", complete);
+		passed = false;
+	}
+	if(complete && (request.action != test->action || (request.action == CONSOLE_PROGRAM && request.program != test->program)))
+	{
+		printf("  Request %d (program %u)\n", request.action, request.program);
+		passed = false;
+	}
+	if(test->reply == NO_REPLY ? replyLength != 0
+		: replyLength < 2 || reply[0] != LOG_START || reply[1] != test->reply)
+	{
+		printf("  Reply of %zu bytes", replyLength);
+		if(replyLength >= 2)
+			printf(" (message %u)", reply[1]);
+		printf("\n");
+		passed = false;
+	}
+	else if(test->text && (replyLength < 2 + strlen(test->text) + 1 || strcmp((char*)reply + 2, test->text) != 0))
+	{
+		printf("  Reply text \"%.*s\"\n", (int)(replyLength > 2 ? replyLength - 2 : 0), (char*)reply + 2);
+		passed = false;
+	}
+	if(strcmp(effect, test->effect) != 0)
+	{
+		printf("  Effect \"%s\"\n", effect);
+		passed = false;
+	}
+	return passed;
+}
+
+/**
+ * @brief Main function
+ */
+int main(void)
+{
+	// Open a pty, raw mode on the slave side like a serial port
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		perror("posix_openpt");
+		return 1;
+	}
+	slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if(slave < 0)
+	{
+		perror(ptsname(master));
+		return 1;
+	}
+	struct termios termios;
+	tcgetattr(slave, &termios);
+	cfmakeraw(&termios);
+	tcsetattr(slave, TCSANOW, &termios);
+
+	consoleInit();
+	unsigned long written = 0;
+	int failed = 0;
+	int numTests = (int)(sizeof(TESTS) / sizeof(TESTS[0]));
+	for(int i = 0; i < numTests; i++)
+	{
+		bool passed = runTest(master, &TESTS[i], &written);
+		printf("%s: \"", passed ? "pass" : "FAIL");
+		for(const char* c = TESTS[i].input; *c; c++)
+			printf(*c == '\n' ? "\\n" : *c == '\r' ? "\\r" : "%c", *c);
+		printf("\"\n");
+		if(!passed)
+			failed++;
+	}
+	printf("%d of %d test cases failed\n", failed, numTests);
+	close(slave);
+	close(master);
+	return failed != 0;
+}
@@ -0,0 +1,713 @@
+/**
+ * @file flashupload.c
+ * @date 2026-10-18
+ * @brief Uploads firmware or an animation through the bootloader (runs on
+ * Linux)
+ *
+ * Writes the application from an Intel HEX file (as built by MPLAB X, linked
+ * with the code offset of bootloader.h) or an animation (see animation.h)
+ * from a file of frames (64 values per frame, row by row, as for streamsend)
+ * page by page, then checks the CRC of everything written and starts the
+ * application. Pages with a CRC error or no reply are sent again.
+ *
+ * With --simulate, nothing is sent to a device. bootprotocol.c, compiled in
+ * unchanged, runs in a child process on the other side of a pty against a
+ * simulated flash memory, which only allows erasing whole pages and clearing
+ * bits like the real one. Afterwards the simulated flash memory is compared
+ * with the image. --corrupt n flips a bit in every n-th byte sent to test the
+ * retries. Without a file, a random application and a test animation are
+ * uploaded.
+ *
+ * Build (in this directory):
+ *   gcc -std=c99 -O2 -I../WinterDeco2025.X -I../Bootloader2025.X \
+ *       -o flashupload flashupload.c ../Bootloader2025.X/bootprotocol.c
+ * Run with a serial port (set to 250000 baud, raw) or as a simulation:
+ *   stty -F /dev/ttyUSB0 250000 raw && ./flashupload --hex app.hex /dev/ttyUSB0
+ *   ./flashupload --animation frames.bin [--ticks 5] /dev/ttyUSB0
+ *   ./flashupload --simulate [--corrupt 500] [--hex app.hex] [--animation frames.bin]
+ * A running application is asked to start the bootloader ("boot" on the
+ * console) first.
+ */
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include<stdio.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+#include<fcntl.h>
+#include<poll.h>
+#include<signal.h>
+#include<termios.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/wait.h>
+#include"bootloader.h"
+#include"animation.h"
+
+//-----------------------------------------------------------------------------
+// Image
+
+/**
+ * @brief Number of pages of the flash memory
+ */
+#define NUM_PAGES (BOOT_FLASH_END / BOOT_PAGE_SIZE)
+
+/**
+ * @brief The content of the flash memory to be uploaded
+ */
+static uint8_t image[BOOT_FLASH_END];
+
+/**
+ * @brief The pages of the image to be written
+ */
+static bool used[NUM_PAGES];
+
+/**
+ * @brief Computes the CRC of bootloader.h
+ */
+static uint16_t crc16(uint16_t crc, const uint8_t* data, size_t length)
+{
+	for(size_t i = 0; i < length; i++)
+	{
+		crc ^= (uint16_t)data[i] << 8;
+		for(int bit = 0; bit < 8; bit++)
+			crc = crc & 0x8000 ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+	}
+	return crc;
+}
+
+/**
+ * @brief Marks the pages of a range of the image as used
+ */
+static void useRange(unsigned start, unsigned end)
+{
+	for(unsigned page = start / BOOT_PAGE_SIZE; page * BOOT_PAGE_SIZE < end; page++)
+		used[page] = true;
+}
+
+/**
+ * @brief Parses a hex number of a HEX record
+ */
+static unsigned hexValue(const char* text, int digits)
+{
+	char buffer[9];
+	memcpy(buffer, text, digits);
+	buffer[digits] = '\0';
+	return (unsigned)strtoul(buffer, NULL, 16);
+}
+
+/**
+ * @brief Reads the application from an Intel HEX file
+ * @details Data outside of the program flash memory (configuration bits,
+ * EEPROM) is ignored, the bootloader can't write it.
+ * @return Returns 0 on success.
+ */
+static int readHex(const char* path)
+{
+	FILE* file = fopen(path, "r");
+	if(!file)
+	{
+		perror(path);
+		return 1;
+	}
+	char line[600];
+	unsigned long upper = 0, ignored = 0;
+	int lineNumber = 0, result = 0;
+	while(result == 0 && fgets(line, sizeof(line), file))
+	{
+		lineNumber++;
+		line[strcspn(line, "\r\n")] = '\0';
+		size_t length = strlen(line);
+		if(length == 0)
+			continue;
+		unsigned count = length >= 11 ? hexValue(line + 1, 2) : 0;
+		if(line[0] != ':' || length != 11 + 2 * count)
+		{
+			fprintf(stderr, "%s:%d: Not a HEX record\n", path, lineNumber);
+			result = 1;
+			break;
+		}
+		uint8_t sum = 0;
+		for(size_t i = 1; i < length; i += 2)
+			sum += (uint8_t)hexValue(line + i, 2);
+		if(sum != 0)
+		{
+			fprintf(stderr, "%s:%d: Checksum error\n", path, lineNumber);
+			result = 1;
+			break;
+		}
+		unsigned offset = hexValue(line + 3, 4);
+		unsigned type = hexValue(line + 7, 2);
+		if(type == 0x01)
+			break;
+		if(type == 0x04)
+		{
+			upper = (unsigned long)hexValue(line + 9, 4) << 16;
+			continue;
+		}
+		if(type != 0x00)
+			continue;
+		for(unsigned i = 0; i < count; i++)
+		{
+			unsigned long address = upper + offset + i;
+			uint8_t data = (uint8_t)hexValue(line + 9 + 2 * i, 2);
+			if(address >= BOOT_FLASH_END)
+			{
+				ignored++;
+			}
+			else if(address < BOOT_APP_START || address >= BOOT_ANIMATION_START)
+			{
+				fprintf(stderr, "%s:%d: Address 0x%04lx outside of the application (linked without code offset 0x%x?)\n",
+					path, lineNumber, address, BOOT_APP_START);
+				result = 1;
+				break;
+			}
+			else
+			{
+				image[address] = data;
+				useRange((unsigned)address, (unsigned)address + 1);
+			}
+		}
+	}
+	fclose(file);
+	if(ignored)
+		fprintf(stderr, "%s: %lu bytes outside of the program flash memory ignored\n", path, ignored);
+	return result;
+}
+
+/**
+ * @brief Reads an animation from a file of frames
+ * @param path The file (64 values per frame).
+ * @param ticks Duration of each frame in ticks.
+ * @return Returns 0 on success.
+ */
+static int readAnimation(const char* path, unsigned ticks)
+{
+	FILE* file = fopen(path, "rb");
+	if(!file)
+	{
+		perror(path);
+		return 1;
+	}
+	uint8_t frame[64];
+	unsigned frames = 0;
+	while(fread(frame, 64, 1, file) == 1)
+	{
+		if(frames == ANIMATION_MAX_FRAMES)
+		{
+			fprintf(stderr, "%s: Only the first %u frames fit\n", path, ANIMATION_MAX_FRAMES);
+			break;
+		}
+		uint8_t* packed = image + BOOT_ANIMATION_START + ANIMATION_HEADER_SIZE + frames * ANIMATION_FRAME_SIZE;
+		for(int i = 0; i < ANIMATION_FRAME_SIZE; i++)
+			packed[i] = (uint8_t)((frame[2 * i] >> 4) | (frame[2 * i + 1] & 0xf0));
+		frames++;
+	}
+	fclose(file);
+	if(frames == 0)
+	{
+		fprintf(stderr, "%s: No complete frame\n", path);
+		return 1;
+	}
+	uint8_t* header = image + BOOT_ANIMATION_START;
+	header[0] = (uint8_t)ANIMATION_MAGIC;
+	header[1] = (uint8_t)(ANIMATION_MAGIC >> 8);
+	header[2] = (uint8_t)frames;
+	header[3] = (uint8_t)ticks;
+	useRange(BOOT_ANIMATION_START, BOOT_ANIMATION_START + ANIMATION_HEADER_SIZE + frames * ANIMATION_FRAME_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Makes up an application and an animation for the simulation
+ */
+static void makeTestImage(void)
+{
+	srand(2025);
+	for(unsigned address = BOOT_APP_START; address < 0x2345; address++)
+		image[address] = (uint8_t)rand();
+	useRange(BOOT_APP_START, 0x2345);
+
+	// A bar moving down
+	uint8_t* header = image + BOOT_ANIMATION_START;
+	header[0] = (uint8_t)ANIMATION_MAGIC;
+	header[1] = (uint8_t)(ANIMATION_MAGIC >> 8);
+	header[2] = 8;
+	header[3] = 5;
+	for(unsigned frame = 0; frame < 8; frame++)
+		memset(image + BOOT_ANIMATION_START + ANIMATION_HEADER_SIZE + frame * ANIMATION_FRAME_SIZE + 4 * frame, 0xff, 4);
+	useRange(BOOT_ANIMATION_START, BOOT_ANIMATION_START + ANIMATION_HEADER_SIZE + 8 * ANIMATION_FRAME_SIZE);
+}
+
+//-----------------------------------------------------------------------------
+// Link to the bootloader
+
+/**
+ * @brief The serial port or the master side of the pty
+ */
+static int port = -1;
+
+/**
+ * @brief Flip a bit in every corrupt-th byte sent (0 for none)
+ */
+static unsigned corrupt;
+
+/**
+ * @brief Number of bytes sent
+ */
+static unsigned long bytesSent;
+
+/**
+ * @brief Sends bytes to the bootloader
+ */
+static bool sendBytes(const uint8_t* data, size_t length)
+{
+	uint8_t buffer[BOOT_PAGE_SIZE + 8];
+	memcpy(buffer, data, length);
+	for(size_t i = 0; i < length; i++)
+	{
+		bytesSent++;
+		if(corrupt && bytesSent % corrupt == 0)
+			buffer[i] ^= 0x10;
+	}
+	if(write(port, buffer, length) != (ssize_t)length)
+	{
+		perror("write");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Receives bytes from the bootloader
+ * @param timeout Timeout for each byte in ms.
+ * @return Returns false on timeout.
+ */
+static bool receiveBytes(uint8_t* data, size_t length, int timeout)
+{
+	size_t received = 0;
+	while(received < length)
+	{
+		struct pollfd pfd = {port, POLLIN, 0};
+		if(poll(&pfd, 1, timeout) != 1)
+			return false;
+		ssize_t n = read(port, data + received, length - received);
+		if(n <= 0)
+			return false;
+		received += (size_t)n;
+	}
+	return true;
+}
+
+/**
+ * @brief Discards everything received until the line is quiet for 100ms
+ */
+static void drain(void)
+{
+	uint8_t byte;
+	while(receiveBytes(&byte, 1, 100));
+}
+
+/**
+ * @brief Brings the bootloader back to waiting for a command
+ * @details Completes any command that has lost a byte (see bootloader.h).
+ */
+static void resync(void)
+{
+	static const uint8_t ZEROS[BOOT_PAGE_SIZE + 4];
+	if(write(port, ZEROS, sizeof(ZEROS)) != (ssize_t)sizeof(ZEROS))
+		perror("write");
+	drain();
+}
+
+/**
+ * @brief Asks the application to start the bootloader and checks the memory
+ * map of the bootloader
+ * @return Returns 0 on success.
+ */
+static int connect(void)
+{
+	// Ignored by the bootloader (no command), starts it from the application
+	static const char BOOT[] = "\nboot\n";
+	if(write(port, BOOT, strlen(BOOT)) != (ssize_t)strlen(BOOT))
+		perror("write");
+	usleep(300000);
+	drain();
+
+	for(int attempt = 0; attempt < 3; attempt++)
+	{
+		uint8_t command = BOOT_INFO, info[10];
+		if(!sendBytes(&command, 1))
+			return 1;
+		if(!receiveBytes(info, sizeof(info), 500) || info[0] != BOOT_OK)
+		{
+			resync();
+			continue;
+		}
+		unsigned appStart = info[2] | info[3] << 8, animationStart = info[4] | info[5] << 8;
+		unsigned flashEnd = info[6] | info[7] << 8, pageSize = info[8] | info[9] << 8;
+		if(info[1] != BOOT_VERSION || appStart != BOOT_APP_START || animationStart != BOOT_ANIMATION_START
+			|| flashEnd != BOOT_FLASH_END || pageSize != BOOT_PAGE_SIZE)
+		{
+			fprintf(stderr, "Bootloader version %u (0x%04x, 0x%04x, 0x%04x, %u) doesn't match\n",
+				info[1], appStart, animationStart, flashEnd, pageSize);
+			return 1;
+		}
+		return 0;
+	}
+	fprintf(stderr, "No reply from the bootloader\n");
+	return 1;
+}
+
+/**
+ * @brief Number of pages sent again
+ */
+static unsigned retries;
+
+/**
+ * @brief Writes a page of the image
+ * @return Returns 0 on success.
+ */
+static int writePage(unsigned page)
+{
+	unsigned address = page * BOOT_PAGE_SIZE;
+	uint8_t packet[BOOT_PAGE_SIZE + 5];
+	packet[0] = BOOT_WRITE;
+	packet[1] = (uint8_t)address;
+	packet[2] = (uint8_t)(address >> 8);
+	memcpy(packet + 3, image + address, BOOT_PAGE_SIZE);
+	uint16_t crc = crc16(0xffff, packet + 1, BOOT_PAGE_SIZE + 2);
+	packet[BOOT_PAGE_SIZE + 3] = (uint8_t)crc;
+	packet[BOOT_PAGE_SIZE + 4] = (uint8_t)(crc >> 8);
+
+	for(int attempt = 0; attempt < 5; attempt++)
+	{
+		if(attempt)
+			retries++;
+		uint8_t status;
+		if(!sendBytes(packet, sizeof(packet)))
+			return 1;
+		if(!receiveBytes(&status, 1, 1000))
+		{
+			resync();
+			continue;
+		}
+		if(status == BOOT_OK)
+			return 0;
+		if(status == BOOT_ERROR_ADDRESS || status == BOOT_ERROR_VERIFY)
+		{
+			fprintf(stderr, "Page 0x%04x: Error '%c'\n", address, status);
+			return 1;
+		}
+		resync();
+	}
+	fprintf(stderr, "Page 0x%04x: No success\n", address);
+	return 1;
+}
+
+/**
+ * @brief Checks the CRC of a range of the flash memory against the image
+ * @return Returns 0 if it matches.
+ */
+static int checkRange(unsigned start, unsigned end)
+{
+	uint8_t command[5] = {BOOT_CHECK, (uint8_t)start, (uint8_t)(start >> 8),
+		(uint8_t)(end - start), (uint8_t)((end - start) >> 8)};
+	for(int attempt = 0; attempt < 3; attempt++)
+	{
+		uint8_t reply[3];
+		if(!sendBytes(command, sizeof(command)))
+			return 1;
+		if(!receiveBytes(reply, sizeof(reply), 1000) || reply[0] != BOOT_OK)
+		{
+			resync();
+			continue;
+		}
+		uint16_t crc = (uint16_t)(reply[1] | reply[2] << 8);
+		if(crc != crc16(0xffff, image + start, end - start))
+		{
+			fprintf(stderr, "0x%04x..0x%04x: CRC 0x%04x doesn't match\n", start, end - 1, crc);
+			return 1;
+		}
+		return 0;
+	}
+	fprintf(stderr, "0x%04x..0x%04x: No CRC\n", start, end - 1);
+	return 1;
+}
+
+/**
+ * @brief Starts the application
+ * @return Returns 0 on success.
+ */
+static int run(void)
+{
+	uint8_t command[2] = {BOOT_RUN, (uint8_t)~BOOT_RUN};
+	for(int attempt = 0; attempt < 3; attempt++)
+	{
+		uint8_t status;
+		if(!sendBytes(command, sizeof(command)))
+			return 1;
+		if(receiveBytes(&status, 1, 500) && status == BOOT_OK)
+			return 0;
+		resync();
+	}
+	fprintf(stderr, "The application has not been started\n");
+	return 1;
+}
+
+/**
+ * @brief Uploads the used pages of the image
+ * @return Returns 0 on success.
+ */
+static int upload(void)
+{
+	if(connect() != 0)
+		return 1;
+
+	// The first page of the application last, see bootloader.h
+	unsigned first = BOOT_APP_START / BOOT_PAGE_SIZE, written = 0;
+	for(unsigned page = first + 1; page <= NUM_PAGES; page++)
+	{
+		unsigned p = page == NUM_PAGES ? first : page;
+		if(!used[p])
+			continue;
+		if(writePage(p) != 0)
+			return 1;
+		written++;
+	}
+	fprintf(stderr, "%u pages written (%u sent again)\n", written, retries);
+
+	// Check each run of used pages
+	for(unsigned page = 0; page < NUM_PAGES; page++)
+	{
+		if(!used[page])
+			continue;
+		unsigned end = page;
+		while(end < NUM_PAGES && used[end])
+			end++;
+		if(checkRange(page * BOOT_PAGE_SIZE, end * BOOT_PAGE_SIZE) != 0)
+			return 1;
+		page = end;
+	}
+	fprintf(stderr, "CRC checked\n");
+	return run();
+}
+
+//-----------------------------------------------------------------------------
+// Simulation
+
+/**
+ * @brief The simulated flash memory (shared with the child process)
+ */
+static uint8_t* flash;
+
+/**
+ * @brief Slave side of the pty (the device's UART)
+ */
+static int slave = -1;
+
+/**
+ * @brief Number of writes to unerased or protected flash memory
+ */
+static unsigned* violations;
+
+/**
+ * @brief CRC of the simulated CRC module
+ */
+static uint16_t crc;
+
+uint8_t bootReceive(void)
+{
+	uint8_t data;
+	if(read(slave, &data, 1) != 1)
+		exit(1);
+	return data;
+}
+
+void bootSend(uint8_t data)
+{
+	if(write(slave, &data, 1) != 1)
+		exit(1);
+}
+
+void bootErase(uint16_t address)
+{
+	if(address % BOOT_PAGE_SIZE || address < BOOT_APP_START || address >= BOOT_FLASH_END)
+	{
+		(*violations)++;
+		return;
+	}
+	memset(flash + address, 0xff, BOOT_PAGE_SIZE);
+}
+
+void bootWrite(uint16_t address, uint16_t data)
+{
+	if(address % 2 || address < BOOT_APP_START || address >= BOOT_FLASH_END
+		|| flash[address] != 0xff || flash[address + 1] != 0xff)
+		(*violations)++;
+	// Programming only clears bits
+	if(address < BOOT_FLASH_END - 1)
+	{
+		flash[address] &= (uint8_t)data;
+		flash[address + 1] &= (uint8_t)(data >> 8);
+	}
+}
+
+uint16_t bootRead(uint16_t address)
+{
+	return (uint16_t)(flash[address] | flash[address + 1] << 8);
+}
+
+void bootCrcStart(void)
+{
+	crc = 0xffff;
+}
+
+void bootCrcAdd(uint8_t data)
+{
+	crc = crc16(crc, &data, 1);
+}
+
+uint16_t bootCrcResult(void)
+{
+	return crc;
+}
+
+/**
+ * @brief Uploads the image into a simulated device
+ * @return Returns 0 if the upload has succeeded and the flash memory matches.
+ */
+static int simulate(void)
+{
+	// Open a pty, raw mode on both sides like a serial port
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		perror("posix_openpt");
+		return 1;
+	}
+	slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	if(slave < 0)
+	{
+		perror(ptsname(master));
+		return 1;
+	}
+	struct termios termios;
+	tcgetattr(slave, &termios);
+	cfmakeraw(&termios);
+	tcsetattr(slave, TCSANOW, &termios);
+	tcgetattr(master, &termios);
+	cfmakeraw(&termios);
+	tcsetattr(master, TCSANOW, &termios);
+
+	// A bootloader and an old application in the simulated flash memory
+	flash = mmap(NULL, BOOT_FLASH_END + sizeof(unsigned), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if(flash == MAP_FAILED)
+	{
+		perror("mmap");
+		return 1;
+	}
+	violations = (unsigned*)(flash + BOOT_FLASH_END);
+	srand(1);
+	for(unsigned address = 0; address < BOOT_FLASH_END; address++)
+		flash[address] = address < BOOT_APP_START ? 0xb0 : (uint8_t)rand();
+
+	pid_t child = fork();
+	if(child < 0)
+	{
+		perror("fork");
+		return 1;
+	}
+	if(child == 0)
+	{
+		// The device: Announce the bootloader, then execute commands
+		close(master);
+		bootSend(BOOT_OK);
+		while(bootCommand());
+		_exit(0);
+	}
+
+	port = master;
+	int result = upload();
+	if(result != 0)
+		kill(child, SIGTERM);
+	int status;
+	waitpid(child, &status, 0);
+	if(result != 0)
+		return result;
+
+	// Compare the simulated flash memory with the image
+	unsigned mismatches = 0;
+	for(unsigned address = 0; address < BOOT_FLASH_END; address++)
+	{
+		bool expected = address < BOOT_APP_START ? flash[address] == 0xb0
+			: !used[address / BOOT_PAGE_SIZE] || flash[address] == image[address];
+		if(!expected)
+			mismatches++;
+	}
+	printf("%lu bytes sent, %u pages sent again, %u bytes differ, %u invalid writes: %s\n",
+		bytesSent, retries, mismatches, *violations, mismatches || *violations ? "FAIL" : "pass");
+	return mismatches || *violations || !WIFEXITED(status);
+}
+
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Main function
+ */
+int main(int argc, char** argv)
+{
+	bool sim = false, usage = false, haveFile = false;
+	unsigned ticks = 5;
+	const char* path = NULL;
+	const char* hexPath = NULL;
+	const char* animationPath = NULL;
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--simulate") == 0)
+			sim = true;
+		else if(strcmp(argv[i], "--hex") == 0 && i + 1 < argc)
+			hexPath = argv[++i];
+		else if(strcmp(argv[i], "--animation") == 0 && i + 1 < argc)
+			animationPath = argv[++i];
+		else if(strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+			ticks = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--corrupt") == 0 && i + 1 < argc)
+			corrupt = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if(argv[i][0] != '-' && !path)
+			path = argv[i];
+		else
+			usage = true;
+	}
+	if(usage || ticks < 1 || ticks > 255 || (!sim && (!path || !(hexPath || animationPath))))
+	{
+		fprintf(stderr, "Usage: %s [--hex app.hex] [--animation frames.bin [--ticks n]] <serial port>\n"
+			"       %s --simulate [--corrupt n] [--hex app.hex] [--animation frames.bin [--ticks n]]\n", argv[0], argv[0]);
+		return 2;
+	}
+
+	memset(image, 0xff, sizeof(image));
+	if(hexPath && readHex(hexPath) != 0)
+		return 1;
+	if(animationPath && readAnimation(animationPath, ticks) != 0)
+		return 1;
+	haveFile = hexPath || animationPath;
+	if(sim)
+	{
+		if(!haveFile)
+			makeTestImage();
+		return simulate();
+	}
+
+	port = open(path, O_RDWR | O_NOCTTY);
+	if(port < 0)
+	{
+		perror(path);
+		return 1;
+	}
+	int result = upload();
+	close(port);
+	return result;
+}
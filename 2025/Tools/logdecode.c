@@ -0,0 +1,269 @@
+/**
+ * @file logdecode.c
+ * @date 2026-10-18
+ * @brief Decodes the binary log records of the firmware (runs on Linux)
+ *
+ * The dictionary of formats is compiled in from logmessages.h, so the tool
+ * must be rebuilt whenever messages are added. Bytes outside of records are
+ * passed through unchanged, so plain text output stays readable.
+ *
+ * Build (in this directory):
+ *   gcc -std=c99 -O2 -I../WinterDeco2025.X -o logdecode logdecode.c
+ * Run with a serial port (set to 250000 baud, raw) or a captured file:
+ *   stty -F /dev/ttyUSB0 250000 raw && ./logdecode /dev/ttyUSB0
+ *   ./logdecode --check    (only checks the types against the formats)
+ */
+
+#include<stdio.h>
+#include<stdint.h>
+#include<stdbool.h>
+#include<stdlib.h>
+#include<string.h>
+#include"logger.h"
+
+/**
+ * @brief A message from logmessages.h
+ */
+typedef struct
+{
+	const char* name;
+	const char* types;
+	const char* format;
+} Message;
+
+/**
+ * @brief The dictionary, indexed by LogId
+ */
+static const Message MESSAGES[NUM_LOG_MESSAGES] =
+{
+#define LOG_MESSAGE(id, types, format) {#id, types, format},
+	LOG_MESSAGES
+#undef LOG_MESSAGE
+};
+
+/**
+ * @brief A conversion specification of a format
+ */
+typedef struct
+{
+	char spec[16];		// The whole specification, e.g. "%-6lu"
+	char conversion;	// The conversion character, e.g. 'u'
+	bool isLong;		// Has the 'l' length modifier
+} Conversion;
+
+/**
+ * @brief Finds the next conversion specification in a format
+ * @param format The format, advanced past the specification.
+ * @param conversion Receives the specification.
+ * @param out Receives the literal text before the specification (or NULL).
+ * @return Returns false at the end of the format.
+ */
+static bool nextConversion(const char** format, Conversion* conversion, FILE* out)
+{
+	const char* f = *format;
+	while(*f)
+	{
+		if(*f != '%' || f[1] == '%')
+		{
+			if(out)
+				fputc(*f, out);
+			f += *f == '%' ? 2 : 1;
+			continue;
+		}
+		// Flags, width and precision, then the length and the conversion
+		size_t length = strspn(f + 1, "-+ #0123456789.") + 1;
+		conversion->isLong = f[length] == 'l';
+		if(conversion->isLong)
+			length++;
+		conversion->conversion = f[length];
+		length++;
+		if(length >= sizeof(conversion->spec))
+			length = sizeof(conversion->spec) - 1;
+		memcpy(conversion->spec, f, length);
+		conversion->spec[length] = '\0';
+		*format = f + length;
+		return true;
+	}
+	*format = f;
+	return false;
+}
+
+/**
+ * @brief Checks whether an argument type matches a conversion
+ */
+static bool typeMatches(char type, const Conversion* conversion)
+{
+	switch(type)
+	{
+		case 'b':
+			return !conversion->isLong && strchr("cdiuxX", conversion->conversion);
+		case 'w':
+			return !conversion->isLong && strchr("diuxX", conversion->conversion);
+		case 'l':
+			return conversion->isLong && strchr("diuxX", conversion->conversion);
+		case 's':
+		case 'a':
+			return conversion->conversion == 's';
+	}
+	return false;
+}
+
+/**
+ * @brief Checks the types of all messages against their formats
+ * @return Returns the number of mismatches (reported on stderr).
+ */
+static int checkDictionary(void)
+{
+	int errors = 0;
+	for(int id = 0; id < NUM_LOG_MESSAGES; id++)
+	{
+		const char* format = MESSAGES[id].format;
+		const char* type = MESSAGES[id].types;
+		Conversion conversion;
+		while(nextConversion(&format, &conversion, NULL))
+		{
+			if(!*type || !typeMatches(*type, &conversion))
+				break;
+			type++;
+		}
+		if(*type || *format)
+		{
+			fprintf(stderr, "%s: Types \"%s\" don't match the format\n", MESSAGES[id].name, MESSAGES[id].types);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+/**
+ * @brief Reads a little-endian value
+ * @return Returns false at the end of the input.
+ */
+static bool readValue(FILE* in, int bytes, uint32_t* value)
+{
+	*value = 0;
+	for(int i = 0; i < bytes; i++)
+	{
+		int c = fgetc(in);
+		if(c == EOF)
+			return false;
+		*value |= (uint32_t)c << (8 * i);
+	}
+	return true;
+}
+
+/**
+ * @brief Decodes and prints one record (after LOG_START)
+ * @return Returns false at the end of the input.
+ */
+static bool decodeRecord(FILE* in)
+{
+	int id = fgetc(in);
+	if(id == EOF)
+		return false;
+	if(id >= NUM_LOG_MESSAGES)
+	{
+		printf("<unknown message %d>\n", id);
+		return true;
+	}
+
+	const char* format = MESSAGES[id].format;
+	const char* type = MESSAGES[id].types;
+	Conversion conversion;
+	while(nextConversion(&format, &conversion, stdout))
+	{
+		uint32_t value;
+		switch(*type++)
+		{
+			case 'b':
+				if(!readValue(in, 1, &value))
+					return false;
+				printf(conversion.spec, (int)value);
+				break;
+			case 'w':
+				if(!readValue(in, 2, &value))
+					return false;
+				if(strchr("di", conversion.conversion))
+					printf(conversion.spec, (int)(int16_t)value);
+				else
+					printf(conversion.spec, (unsigned)value);
+				break;
+			case 'l':
+				if(!readValue(in, 4, &value))
+					return false;
+				if(strchr("di", conversion.conversion))
+					printf(conversion.spec, (long)(int32_t)value);
+				else
+					printf(conversion.spec, (unsigned long)value);
+				break;
+			case 's':
+			{
+				char string[256];
+				size_t length = 0;
+				int c;
+				while((c = fgetc(in)) != EOF && c != '\0')
+					if(length < sizeof(string) - 1)
+						string[length++] = (char)c;
+				if(c == EOF)
+					return false;
+				string[length] = '\0';
+				printf(conversion.spec, string);
+				break;
+			}
+			case 'a':
+			{
+				// Printed in hex, separated by spaces
+				if(!readValue(in, 2, &value))
+					return false;
+				char* string = malloc(value * 3 + 1);
+				if(!string)
+					return false;
+				size_t length = 0;
+				string[0] = '\0';
+				for(uint32_t i = 0; i < value; i++)
+				{
+					int c = fgetc(in);
+					if(c == EOF)
+					{
+						free(string);
+						return false;
+					}
+					length += (size_t)sprintf(string + length, i ? " %02x" : "%02x", c);
+				}
+				printf(conversion.spec, string);
+				free(string);
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Main function
+ */
+int main(int argc, char** argv)
+{
+	if(checkDictionary() != 0)
+		return 2;
+	if(argc > 1 && strcmp(argv[1], "--check") == 0)
+		return 0;
+
+	FILE* in = stdin;
+	if(argc > 1 && !(in = fopen(argv[1], "rb")))
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	int c;
+	while((c = fgetc(in)) != EOF)
+	{
+		if(c != LOG_START)
+			putchar(c);
+		else if(!decodeRecord(in))
+			break;
+	}
+	return 0;
+}
@@ -0,0 +1,271 @@
+/**
+ * @file powersim.c
+ * @date 2026-10-18
+ * @brief Checks the power policy against synthetic discharge curves (runs on
+ * Linux)
+ *
+ * power.c is compiled in unchanged against a mocked LED driver and logger.
+ * First powerLevelFor() is checked for every level and battery voltage. Then
+ * each curve (a falling battery voltage with noise, some with recovery bumps)
+ * is fed to powerUpdate() sample by sample. The checks are:
+ * - a level is entered at the first sample below its threshold (see
+ *   POWER_THRESHOLDS) and left only once the voltage has recovered by
+ *   POWER_HYSTERESIS, but then right away,
+ * - levels change one at a time, the changes are logged and applied to the
+ *   LED driver,
+ * - the levels entered match the expected sequence, so on a monotonic
+ *   discharge each level is entered once and none is skipped,
+ * - POWER_EMPTY is reached before the brown-out reset at 1.9V.
+ *
+ * Build and run (in this directory):
+ *   gcc -std=c99 -O2 -I. -I../WinterDeco2025.X -o powersim powersim.c \
+ *       ../WinterDeco2025.X/power.c
+ *   ./powersim
+ */
+
+#include<xc.h>
+#include<stdio.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include"led.h"
+#include"logger.h"
+#include"power.h"
+
+/**
+ * @brief Brown-out reset voltage (in mV)
+ */
+#define BROWN_OUT 1900
+
+//-----------------------------------------------------------------------------
+// Mocked drivers
+
+/**
+ * @brief Colour depth as set by the power policy
+ */
+static uint8_t depth = COLOUR_DEPTH;
+
+/**
+ * @brief Scan rate as set by the power policy
+ */
+static bool slowScan;
+
+/**
+ * @brief Number of LOG_POWER_LEVEL messages
+ */
+static unsigned logged;
+
+void ledSetDepth(uint8_t newDepth)
+{
+	depth = newDepth;
+}
+
+void ledSetSlowScan(bool slow)
+{
+	slowScan = slow;
+}
+
+void logMessage(LogId id, ...)
+{
+	if(id == LOG_POWER_LEVEL)
+		logged++;
+}
+
+//-----------------------------------------------------------------------------
+// Checks
+
+/**
+ * @brief Checks a level against the rules of the policy
+ * @param from The level before.
+ * @param to The level after.
+ * @param millivolts The battery voltage.
+ * @param what Description for error messages.
+ * @return Returns true if the level is right.
+ */
+static bool checkLevel(PowerLevel from, PowerLevel to, uint16_t millivolts, const char* what)
+{
+	const char* error = NULL;
+	if(to < POWER_EMPTY && millivolts < POWER_THRESHOLDS[to])
+		error = "below the threshold of the next level";
+	else if(to > from && millivolts >= POWER_THRESHOLDS[to - 1])
+		error = "entered above its threshold";
+	else if(to < from && millivolts < POWER_THRESHOLDS[to] + POWER_HYSTERESIS)
+		error = "left within the hysteresis";
+	else if(to > POWER_NORMAL && to <= from && millivolts >= POWER_THRESHOLDS[to - 1] + POWER_HYSTERESIS)
+		error = "not left after recovering";
+	if(error)
+		printf("  %s: %u -> %u at %umV: %s\n", what, from, to, millivolts, error);
+	return !error;
+}
+
+/**
+ * @brief Checks powerLevelFor() for every level and voltage
+ * @return Returns true if all checks have passed.
+ */
+static bool checkLevelFor(void)
+{
+	bool passed = true;
+	for(PowerLevel level = POWER_NORMAL; level <= POWER_EMPTY; level++)
+		for(uint16_t millivolts = 1500; millivolts <= 3300 && passed; millivolts++)
+			passed = checkLevel(level, powerLevelFor(level, millivolts), millivolts, "powerLevelFor()");
+	return passed;
+}
+
+//-----------------------------------------------------------------------------
+// Discharge curves
+
+/**
+ * @brief Maximum number of points of a curve
+ */
+#define MAX_POINTS 8
+
+/**
+ * @brief Maximum number of level changes of a curve
+ */
+#define MAX_CHANGES 8
+
+/**
+ * @brief A discharge curve with the expected level changes
+ * @details The voltage moves linearly between the points by 1mV per sample,
+ * with noise on top. 
+ */
+typedef struct
+{
+	const char* name;
+	uint16_t points[MAX_POINTS];		// Battery voltage (in mV), ended by 0
+	uint16_t noise;						// Amplitude of the noise (in mV)
+	int8_t levels[MAX_CHANGES + 1];		// Levels changed to, ended by -1
+} Curve;
+
+static const Curve CURVES[] =
+{
+	{"monotonic discharge", {3000, 1850}, 0,
+		{POWER_REDUCED_DEPTH, POWER_SLOW_SCAN, POWER_LOW_POWER_ONLY, POWER_EMPTY, -1}},
+	{"monotonic discharge with noise", {3000, 1850}, 30,
+		{POWER_REDUCED_DEPTH, POWER_SLOW_SCAN, POWER_LOW_POWER_ONLY, POWER_EMPTY, -1}},
+	{"bump within the hysteresis", {3000, 2300, 2420, 2250, 1850}, 20,
+		{POWER_REDUCED_DEPTH, POWER_SLOW_SCAN, POWER_LOW_POWER_ONLY, POWER_EMPTY, -1}},
+	{"recovery bump", {3000, 2300, 2500, 2250, 1850}, 20,
+		{POWER_REDUCED_DEPTH, POWER_SLOW_SCAN, POWER_REDUCED_DEPTH, POWER_SLOW_SCAN, POWER_LOW_POWER_ONLY, POWER_EMPTY, -1}},
+	{"fresh battery after empty", {2500, 1950, 3000}, 20,
+		{POWER_REDUCED_DEPTH, POWER_SLOW_SCAN, POWER_LOW_POWER_ONLY, POWER_EMPTY,
+		POWER_LOW_POWER_ONLY, POWER_SLOW_SCAN, POWER_REDUCED_DEPTH, POWER_NORMAL, -1}}
+};
+
+/**
+ * @brief Returns deterministic noise in [-amplitude, amplitude]
+ */
+static int noise(uint16_t amplitude)
+{
+	static uint32_t state = 4711;
+	state = state * 1103515245u + 12345u;
+	return amplitude ? (int)((state >> 16) % (2u * amplitude + 1)) - amplitude : 0;
+}
+
+/**
+ * @brief Feeds a curve to powerUpdate()
+ * @param curve The curve.
+ * @return Returns true if all checks have passed.
+ */
+static bool runCurve(const Curve* curve)
+{
+	// Start at the normal level like after power-up
+	powerUpdate(3300);
+	bool passed = powerLevel() == POWER_NORMAL;
+	logged = 0;
+
+	int changes[32];
+	unsigned numChanges = 0;
+	uint16_t emptyAt = 0;
+	for(unsigned i = 0; i + 1 < MAX_POINTS && curve->points[i + 1]; i++)
+	{
+		int from = curve->points[i], to = curve->points[i + 1];
+		int step = to > from ? 1 : -1;
+		for(int level = from; level != to && passed; level += step)
+		{
+			uint16_t millivolts = (uint16_t)(level + noise(curve->noise));
+			PowerLevel before = powerLevel();
+			bool changed = powerUpdate(millivolts);
+			PowerLevel after = powerLevel();
+
+			passed = checkLevel(before, after, millivolts, "powerUpdate()");
+			if(changed != (after != before))
+			{
+				printf("  powerUpdate() returned %d at %umV\n", changed, millivolts);
+				passed = false;
+			}
+			if(!changed)
+				continue;
+			if(after != before + 1 && after != before - 1)
+			{
+				printf("  Skipped from %u to %u at %umV\n", before, after, millivolts);
+				passed = false;
+			}
+			if(depth != (after >= POWER_REDUCED_DEPTH ? POWER_DEPTH : COLOUR_DEPTH) || slowScan != (after >= POWER_SLOW_SCAN))
+			{
+				printf("  LED driver not set for level %u (depth %u, slow scan %d)\n", after, depth, slowScan);
+				passed = false;
+			}
+			if(after == POWER_EMPTY && !emptyAt)
+				emptyAt = millivolts;
+			if(numChanges < 32)
+				changes[numChanges++] = after;
+		}
+	}
+
+	unsigned expected = 0;
+	while(expected < MAX_CHANGES && curve->levels[expected] >= 0)
+		expected++;
+	bool sequence = numChanges == expected;
+	for(unsigned i = 0; sequence && i < expected; i++)
+		sequence = changes[i] == curve->levels[i];
+	if(!sequence)
+	{
+		printf("  Levels:");
+		for(unsigned i = 0; i < numChanges; i++)
+			printf(" %d", changes[i]);
+		printf("\n");
+		passed = false;
+	}
+	if(logged != numChanges)
+	{
+		printf("  %u changes logged instead of %u\n", logged, numChanges);
+		passed = false;
+	}
+	if(emptyAt && emptyAt < BROWN_OUT)
+	{
+		printf("  Empty only at %umV, below the brown-out voltage\n", emptyAt);
+		passed = false;
+	}
+	return passed;
+}
+
+/**
+ * @brief Main function
+ */
+int main(void)
+{
+	int failed = 0;
+	int numTests = 1;
+	bool passed = checkLevelFor();
+	printf("%s: powerLevelFor() for every level and voltage\n", passed ? "pass" : "FAIL");
+	if(!passed)
+		failed++;
+
+	// The last level must be reached before the brown-out reset
+	numTests++;
+	passed = POWER_THRESHOLDS[POWER_EMPTY - 1] > BROWN_OUT;
+	printf("%s: empty above the brown-out voltage\n", passed ? "pass" : "FAIL");
+	if(!passed)
+		failed++;
+
+	for(unsigned i = 0; i < sizeof(CURVES) / sizeof(CURVES[0]); i++)
+	{
+		numTests++;
+		passed = runCurve(&CURVES[i]);
+		printf("%s: %s\n", passed ? "pass" : "FAIL", CURVES[i].name);
+		if(!passed)
+			failed++;
+	}
+	printf("%d of %d test cases failed\n", failed, numTests);
+	return failed != 0;
+}
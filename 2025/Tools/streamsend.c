@@ -0,0 +1,448 @@
+/**
+ * @file streamsend.c
+ * @date 2026-10-18
+ * @brief Streams frames to the stream program of the firmware (runs on Linux)
+ *
+ * Sends a test animation or the frames of a file (64 bytes per frame, row by
+ * row, see ledShowValues()) as packets of stream.h, either as values or as
+ * pre-encoded bit planes (--planes).
+ *
+ * With --loopback, nothing is sent to a device. The packets go through a pty
+ * into stream.c and led.c, compiled in unchanged, while the UART, the tick and
+ * the scan interrupt are simulated in real proportions (250kBaud, 100Hz,
+ * 64kHz). Every frame the simulated scan shows is compared with the frames
+ * sent, so torn or corrupted frames are caught, and the frame rate that is
+ * sustained is reported.
+ *
+ * Build (in this directory):
+ *   gcc -std=c99 -O2 -I. -I../WinterDeco2025.X -o streamsend streamsend.c xc.c \
+ *       ../WinterDeco2025.X/stream.c ../WinterDeco2025.X/led.c \
+ *       ../WinterDeco2025.X/logger.c
+ * Run with a serial port (set to 250000 baud, raw) or as a loopback test:
+ *   stty -F /dev/ttyUSB0 250000 raw && ./streamsend /dev/ttyUSB0
+ *   ./streamsend --planes --fps 30 --file frames.bin /dev/ttyUSB0
+ *   ./streamsend --loopback [--planes] [--fps 60] [--corrupt 10]
+ * The device must run the stream program first ("program 6" on the console).
+ */
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include<xc.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include<fcntl.h>
+#include<poll.h>
+#include<termios.h>
+#include<unistd.h>
+#include"led.h"
+#include"uart.h"
+#include"stream.h"
+
+// Interrupt handler of the LED driver (see led.c)
+void timer0Isr(void);
+
+//-----------------------------------------------------------------------------
+// Frames and packets
+
+/**
+ * @brief Maximum size of a packet
+ */
+#define MAX_PACKET (4 + STREAM_VALUES_SIZE)
+
+/**
+ * @brief Frames read from a file (or NULL for the test animation)
+ */
+static uint8_t* fileFrames;
+static size_t numFileFrames;
+
+/**
+ * @brief Returns frame n
+ * @details The test animation is a diagonal gradient that moves by a few
+ * steps per frame, so consecutive frames always differ.
+ * @param n Number of the frame.
+ * @param frame Receives the 64 values.
+ */
+static void makeFrame(unsigned long n, uint8_t* frame)
+{
+	if(fileFrames)
+	{
+		memcpy(frame, fileFrames + (n % numFileFrames) * 64, 64);
+		return;
+	}
+	for(int y = 0; y < 8; y++)
+		for(int x = 0; x < 8; x++)
+			frame[8 * y + x] = (uint8_t)((x + 8 * y + 5 * n) * 4);
+}
+
+/**
+ * @brief Encodes a frame as bit planes for ledShowPlanes()
+ * @param frame The 64 values.
+ * @param planes Receives LED_PLANES_SIZE bytes.
+ */
+static void encodePlanes(const uint8_t* frame, uint8_t* planes)
+{
+	memset(planes, 0, LED_PLANES_SIZE);
+	for(int y = 0; y < 8; y++)
+	{
+		for(int x = 0; x < 8; x++)
+		{
+			// Columns of the left half are in rows 0..7, of the right half
+			// in rows 8..15 (see led.h)
+			int row = x < 4 ? y : y + 8;
+			int bit = (x & 3) + (row & 1) * 4;
+			uint8_t value = frame[8 * y + x] >> (8 - COLOUR_DEPTH);
+			for(int plane = 0; plane < COLOUR_DEPTH; plane++)
+				if(value & (1 << plane))
+					planes[8 * plane + row / 2] |= (uint8_t)(1 << bit);
+		}
+	}
+}
+
+/**
+ * @brief Builds the packet of a frame
+ * @param frame The 64 values.
+ * @param planes True to send bit planes, false to send values.
+ * @param packet Receives the packet (MAX_PACKET bytes).
+ * @return Returns the length of the packet.
+ */
+static size_t makePacket(const uint8_t* frame, bool planes, uint8_t* packet)
+{
+	size_t size = planes ? LED_PLANES_SIZE : STREAM_VALUES_SIZE;
+	packet[0] = STREAM_START;
+	packet[1] = planes ? STREAM_PLANES : STREAM_VALUES;
+	if(planes)
+		encodePlanes(frame, packet + 2);
+	else
+		memcpy(packet + 2, frame, STREAM_VALUES_SIZE);
+
+	// Fletcher-16 of the type and the payload
+	unsigned sum1 = 0, sum2 = 0;
+	for(size_t i = 1; i < size + 2; i++)
+	{
+		sum1 = (sum1 + packet[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	packet[size + 2] = (uint8_t)sum1;
+	packet[size + 3] = (uint8_t)sum2;
+	return size + 4;
+}
+
+//-----------------------------------------------------------------------------
+// Sending to a device
+
+/**
+ * @brief Sends frames to a serial port at a fixed rate
+ * @return Returns 0 on success.
+ */
+static int sendFrames(const char* path, bool planes, double fps, unsigned long frames)
+{
+	int fd = open(path, O_WRONLY | O_NOCTTY);
+	if(fd < 0)
+	{
+		perror(path);
+		return 1;
+	}
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	long period = (long)(1e9 / fps);
+	for(unsigned long n = 0; frames == 0 || n < frames; n++)
+	{
+		uint8_t frame[64], packet[MAX_PACKET];
+		makeFrame(n, frame);
+		size_t length = makePacket(frame, planes, packet);
+		if(write(fd, packet, length) != (ssize_t)length)
+		{
+			perror(path);
+			close(fd);
+			return 1;
+		}
+		next.tv_nsec += period;
+		while(next.tv_nsec >= 1000000000)
+		{
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	close(fd);
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Loopback test
+
+/**
+ * @brief Rates of the simulation
+ */
+#define SCAN_RATE 64000					// Timer 0 interrupts per second
+#define TICK_CALLS (SCAN_RATE / 100)	// Interrupts per tick (10ms)
+#define BYTE_TIME 40000					// ns per byte at 250kBaud
+#define FRAME_CALLS (16 * ((1 << COLOUR_DEPTH) - 1))	// Interrupts per frame
+
+/**
+ * @brief Command sent in between frames once per second
+ * @details Must not be taken by the stream program.
+ */
+#define COMMAND "battery\n"
+
+/**
+ * @brief The receive handler installed by stream.c
+ */
+static UartReceiveHandler receiveHandler;
+
+void uartSetReceiveHandler(UartReceiveHandler handler)
+{
+	receiveHandler = handler;
+}
+
+void uartSend(char c)
+{
+	// Log messages of stream.c are ignored
+}
+
+void uartSendBlock(const volatile void* data, uint16_t length, UartBlockCallback callback)
+{
+	if(callback)
+		callback();
+}
+
+void autoOffReset(void)
+{
+}
+
+/**
+ * @brief Compares a shown frame with a sent frame
+ * @param counts Number of interrupts each LED was lit during the frame.
+ * @param n Number of the sent frame.
+ * @return Returns true if they are the same.
+ */
+static bool frameMatches(const unsigned counts[8][8], unsigned long n)
+{
+	uint8_t frame[64];
+	makeFrame(n, frame);
+	for(int y = 0; y < 8; y++)
+		for(int x = 0; x < 8; x++)
+			if(counts[x][y] != (unsigned)(frame[8 * y + x] >> (8 - COLOUR_DEPTH)))
+				return false;
+	return true;
+}
+
+/**
+ * @brief Runs the loopback test
+ * @param planes True to send bit planes, false to send values.
+ * @param fps Frames per second to send.
+ * @param seconds Simulated time.
+ * @param corrupt Corrupt every corrupt-th packet (0 for none).
+ * @return Returns 0 if the test has passed.
+ */
+static int loopback(bool planes, double fps, unsigned seconds, unsigned corrupt)
+{
+	size_t packetLength = (planes ? LED_PLANES_SIZE : STREAM_VALUES_SIZE) + 4;
+	if(fps * packetLength > 1e9 / BYTE_TIME * 0.9)
+	{
+		fprintf(stderr, "%.0f fps of %zu bytes exceed the baud rate\n", fps, packetLength);
+		return 1;
+	}
+
+	// Open a pty, raw mode on the slave side like a serial port
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		perror("posix_openpt");
+		return 1;
+	}
+	int slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if(slave < 0)
+	{
+		perror(ptsname(master));
+		return 1;
+	}
+	struct termios termios;
+	tcgetattr(slave, &termios);
+	cfmakeraw(&termios);
+	tcsetattr(slave, TCSANOW, &termios);
+
+	ledInit();
+	ledOn();
+	streamInit();
+
+	unsigned long sent = 0;			// Frames sent
+	unsigned long written = 0;		// Bytes written to the pty
+	unsigned long delivered = 0;	// Bytes passed to the receive handler
+	unsigned long passedOn = 0;		// Bytes not taken by the handler
+	unsigned long long nextFrame = 0, nextByte = 0, nextCommand = 500000000;
+	unsigned counts[8][8] = {{0}};
+	long lastShown = -1;			// Number of the last frame shown
+	unsigned long shown = 0, mismatched = 0;
+	unsigned long long calls = (unsigned long long)seconds * SCAN_RATE;
+	for(unsigned long long call = 1; call <= calls; call++)
+	{
+		unsigned long long now = call * 1000000000ull / SCAN_RATE;
+
+		// Send the frames (and a command once per second) when they are due
+		while(nextFrame <= now)
+		{
+			uint8_t frame[64], packet[MAX_PACKET];
+			makeFrame(sent, frame);
+			size_t length = makePacket(frame, planes, packet);
+			if(corrupt && sent % corrupt == corrupt - 1)
+				packet[2] ^= 0x80;
+			written += (unsigned long)write(master, packet, length);
+			sent++;
+			nextFrame = (unsigned long long)(sent * 1e9 / fps);
+		}
+		if(nextCommand <= now)
+		{
+			written += (unsigned long)write(master, COMMAND, strlen(COMMAND));
+			nextCommand += 1000000000;
+		}
+
+		// Receive interrupt, one byte per byte time
+		if(delivered == written && nextByte < now)
+			nextByte = now;
+		while(nextByte <= now && delivered < written)
+		{
+			char c;
+			struct pollfd pfd = {slave, POLLIN, 0};
+			if(read(slave, &c, 1) != 1)
+			{
+				// Still on its way through the pty
+				poll(&pfd, 1, 1000);
+				continue;
+			}
+			if(!receiveHandler || !receiveHandler(c))
+				passedOn++;
+			delivered++;
+			nextByte += BYTE_TIME;
+		}
+
+		// Scan interrupt, check each complete frame that has been shown
+		if(call % FRAME_CALLS == 0 && call > FRAME_CALLS)
+		{
+			bool blank = true;
+			for(int y = 0; y < 8; y++)
+				for(int x = 0; x < 8; x++)
+					blank = blank && counts[x][y] == 0;
+			if(!blank || lastShown >= 0)
+			{
+				long n = lastShown < 0 ? 0 : lastShown;
+				while(n < (long)sent && !frameMatches(counts, (unsigned long)n))
+					n++;
+				if(n == (long)sent)
+					mismatched++;
+				else if(n != lastShown)
+				{
+					shown++;
+					lastShown = n;
+				}
+			}
+			memset(counts, 0, sizeof(counts));
+		}
+		timer0Isr();
+		uint8_t row = LATC >> 4;
+		for(int column = 0; column < 4; column++)
+			if(LATC & (1 << column))
+				counts[column + (row & 8 ? 4 : 0)][row & 7]++;
+
+		// Tick
+		if(call % TICK_CALLS == 0)
+			streamUpdate(10, NULL);
+	}
+	streamStop();
+	close(slave);
+	close(master);
+
+	unsigned long commands = passedOn / strlen(COMMAND);
+	double rate = shown / (double)seconds;
+	double expected = fps < 60 ? fps : 60;
+	if(corrupt)
+		expected *= 1 - 1.0 / corrupt;
+	bool passed = mismatched == 0 && rate >= expected * 0.98
+		&& passedOn == commands * strlen(COMMAND) && commands == seconds;
+	printf("%s packets of %zu bytes at %.0f fps for %us (simulated)\n",
+		planes ? "Plane" : "Value", packetLength, fps, seconds);
+	printf("  sent %lu, shown %lu (%.1f fps), never shown %lu\n", sent, shown, rate, sent - shown);
+	printf("  torn, corrupted or unknown frames shown %lu\n", mismatched);
+	printf("  bytes passed on to the console %lu (%lu commands)\n", passedOn, commands);
+	printf("%s\n", passed ? "pass" : "FAIL");
+	return passed ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Reads the frames of a file
+ * @return Returns 0 on success.
+ */
+static int readFrames(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if(!file)
+	{
+		perror(path);
+		return 1;
+	}
+	size_t capacity = 0;
+	uint8_t frame[64];
+	while(fread(frame, 64, 1, file) == 1)
+	{
+		if(numFileFrames == capacity)
+		{
+			capacity = capacity ? 2 * capacity : 64;
+			fileFrames = realloc(fileFrames, capacity * 64);
+		}
+		memcpy(fileFrames + numFileFrames++ * 64, frame, 64);
+	}
+	fclose(file);
+	if(numFileFrames == 0)
+	{
+		fprintf(stderr, "%s: No complete frame\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Main function
+ */
+int main(int argc, char** argv)
+{
+	bool planes = false, loop = false, usage = false;
+	double fps = 60;
+	unsigned long frames = 0;
+	unsigned corrupt = 0;
+	const char* path = NULL;
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--planes") == 0)
+			planes = true;
+		else if(strcmp(argv[i], "--loopback") == 0)
+			loop = true;
+		else if(strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+			fps = atof(argv[++i]);
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--corrupt") == 0 && i + 1 < argc)
+			corrupt = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--file") == 0 && i + 1 < argc)
+		{
+			if(readFrames(argv[++i]) != 0)
+				return 1;
+		}
+		else if(argv[i][0] != '-' && !path)
+			path = argv[i];
+		else
+			usage = true;
+	}
+	if(usage || fps <= 0 || (!loop && !path))
+	{
+		fprintf(stderr, "Usage: %s [--planes] [--fps n] [--frames n] [--file frames.bin] <serial port>\n"
+			"       %s --loopback [--planes] [--fps n] [--corrupt n] [--file frames.bin]\n", argv[0], argv[0]);
+		return 2;
+	}
+	if(loop)
+		return loopback(planes, fps, 10, corrupt);
+	return sendFrames(path, planes, fps, frames);
+}
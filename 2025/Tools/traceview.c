@@ -0,0 +1,282 @@
+/**
+ * @file traceview.c
+ * @date 2026-10-18
+ * @brief Renders the trace of the firmware as a timeline (runs on Linux)
+ *
+ * Reads the text output of logdecode (or of the firmware in text mode) and
+ * renders each trace dump (see trace.h) as a timeline with a column per
+ * context. A dump is the time of the dump followed by all ring buffers as
+ * one block of bytes (5 bytes per record, each ring from the oldest to the
+ * newest record). The timestamps are 24-bit cycle counts; they are turned
+ * into times before the dump by walking each ring back from its newest
+ * record. Lines that don't belong to a dump are ignored.
+ *
+ * Exit records show the time since the matching entry, tick entries the time
+ * since the previous tick, so long interrupts and tick jitter stand out.
+ *
+ * Build (in this directory):
+ *   gcc -std=c99 -O2 -I../WinterDeco2025.X -o traceview traceview.c
+ * Run with a capture of the serial port:
+ *   ./logdecode capture.bin | ./traceview
+ */
+
+#include<stdio.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+#include"trace.h"
+#include"input.h"
+
+/**
+ * @brief Instruction cycles per microsecond
+ */
+#define CYCLES_PER_US 16.0
+
+/**
+ * @brief Mask of the timestamps (SMT1 is a 24-bit counter)
+ */
+#define TIME_MASK 0xfffffful
+
+/**
+ * @brief Width of a column of the timeline
+ */
+#define COLUMN_WIDTH 26
+
+/**
+ * @brief Maximum number of records in a dump
+ */
+#define MAX_RECORDS (NUM_TRACE_RINGS * 256)
+
+/**
+ * @brief Bytes per record (see TraceRecord)
+ */
+#define RECORD_SIZE 5
+
+/**
+ * @brief Text before the block of records
+ */
+#define RECORDS_TEXT "Trace records:"
+
+/**
+ * @brief Names of the events
+ */
+static const char* const EVENT_NAMES[NUM_TRACE_EVENTS] =
+{
+#define TRACE_EVENT(id, name) name,
+	TRACE_EVENTS
+#undef TRACE_EVENT
+};
+
+/**
+ * @brief Column headings
+ */
+static const char* const RING_NAMES[NUM_TRACE_RINGS] = {"scan interrupt", "interrupts", "main loop"};
+
+static const char* const BUTTON_NAMES[NUM_BUTTONS] = {"left", "center", "right"};
+
+static const char* const INPUT_EVENT_NAMES[] = {"none", "press", "hold long", "release short", "release long"};
+
+/**
+ * @brief A record of a dump
+ */
+typedef struct
+{
+	unsigned ring;
+	unsigned event;
+	unsigned arg;
+	uint32_t time;		// Timestamp as sent
+	double age;			// Cycles before the dump
+	unsigned order;		// Position in the dump (for a stable sort)
+} Record;
+
+/**
+ * @brief Orders records from the oldest to the newest
+ */
+static int compareRecords(const void* a, const void* b)
+{
+	const Record* x = a;
+	const Record* y = b;
+	if(x->age != y->age)
+		return x->age > y->age ? -1 : 1;
+	return x->order < y->order ? -1 : 1;
+}
+
+/**
+ * @brief Describes a record
+ * @param record The record.
+ * @param last The last record of each event in the same ring (or NULL).
+ * @param text Receives the description.
+ * @param size Size of text.
+ */
+static void describe(const Record* record, const Record* const* last, char* text, size_t size)
+{
+	const char* name = record->event < NUM_TRACE_EVENTS ? EVENT_NAMES[record->event] : "?";
+	const Record* enter = NULL;
+	switch(record->event)
+	{
+		case TRACE_SCAN_LATE:
+			snprintf(text, size, "%s %uus", name, record->arg);
+			return;
+		case TRACE_TICK_ENTER:
+			if(last[TRACE_TICK_ENTER])
+			{
+				snprintf(text, size, "%s +%.2fms", name, (last[TRACE_TICK_ENTER]->age - record->age) / CYCLES_PER_US / 1000);
+				return;
+			}
+			break;
+		case TRACE_TICK_EXIT:
+			enter = last[TRACE_TICK_ENTER];
+			break;
+		case TRACE_DEBOUNCE_EXIT:
+			enter = last[TRACE_DEBOUNCE_ENTER];
+			break;
+		case TRACE_EDGE:
+		{
+			int length = snprintf(text, size, "%s", name);
+			for(unsigned i = 0; i < NUM_BUTTONS && length < (int)size; i++)
+				if((record->arg >> (4 + i)) & 1)
+					length += snprintf(text + length, size - length, " %s", BUTTON_NAMES[i]);
+			return;
+		}
+		case TRACE_INPUT:
+		{
+			unsigned button = record->arg >> 4;
+			unsigned event = record->arg & 0x0f;
+			snprintf(text, size, "%s %s", button < NUM_BUTTONS ? BUTTON_NAMES[button] : "?",
+				event < sizeof(INPUT_EVENT_NAMES) / sizeof(INPUT_EVENT_NAMES[0]) ? INPUT_EVENT_NAMES[event] : "?");
+			return;
+		}
+		case TRACE_TICK_MISSED:
+		case TRACE_PROGRAM:
+			snprintf(text, size, "%s %u", name, record->arg);
+			return;
+	}
+	if(enter)
+		snprintf(text, size, "%s %.1fus", name, (enter->age - record->age) / CYCLES_PER_US);
+	else
+		snprintf(text, size, "%s", name);
+}
+
+/**
+ * @brief Renders a dump
+ * @param now Time of the dump.
+ * @param records The records in the order of the dump (sorted).
+ * @param numRecords Number of records.
+ */
+static void render(uint32_t now, Record* records, unsigned numRecords)
+{
+	// Each ring is sent from the oldest to the newest record, so walk it
+	// back from the newest one, which was taken less than 2^24 cycles ago
+	for(unsigned ring = 0; ring < NUM_TRACE_RINGS; ring++)
+	{
+		const Record* next = NULL;
+		for(unsigned i = numRecords; i-- > 0;)
+		{
+			Record* record = &records[i];
+			if(record->ring != ring)
+				continue;
+			record->age = next
+				? next->age + ((next->time - record->time) & TIME_MASK)
+				: (double)((now - record->time) & TIME_MASK);
+			next = record;
+		}
+	}
+	qsort(records, numRecords, sizeof(Record), compareRecords);
+
+	printf("Trace at %lu (%u records, times in us before the dump)\n", (unsigned long)now, numRecords);
+	printf("%10s", "time");
+	for(unsigned ring = 0; ring < NUM_TRACE_RINGS; ring++)
+		printf("  %-*s", ring + 1 < NUM_TRACE_RINGS ? COLUMN_WIDTH : 0, RING_NAMES[ring]);
+	printf("\n");
+
+	const Record* last[NUM_TRACE_RINGS][NUM_TRACE_EVENTS] = {{NULL}};
+	for(unsigned i = 0; i < numRecords; i++)
+	{
+		const Record* record = &records[i];
+		if(record->ring >= NUM_TRACE_RINGS)
+			continue;
+		char text[64];
+		describe(record, last[record->ring], text, sizeof(text));
+		printf("%10.1f%*s  %s\n", -record->age / CYCLES_PER_US, (int)(record->ring * (COLUMN_WIDTH + 2)), "", text);
+		if(record->event < NUM_TRACE_EVENTS)
+			last[record->ring][record->event] = record;
+	}
+	printf("\n");
+}
+
+/**
+ * @brief Parses the block of records
+ * @param text The bytes in hex.
+ * @param records Receives the records in the order of the dump, without
+ * unused ones.
+ * @return Returns the number of records.
+ */
+static unsigned parseRecords(const char* text, Record* records)
+{
+	static uint8_t bytes[MAX_RECORDS * RECORD_SIZE];
+	unsigned numBytes = 0;
+	char* end;
+	unsigned long value;
+	while(numBytes < sizeof(bytes) && (value = strtoul(text, &end, 16), end != text))
+	{
+		bytes[numBytes++] = (uint8_t)value;
+		text = end;
+	}
+
+	// The rings are of the same size
+	unsigned perRing = numBytes / RECORD_SIZE / NUM_TRACE_RINGS;
+	unsigned numRecords = 0;
+	for(unsigned i = 0; i < perRing * NUM_TRACE_RINGS; i++)
+	{
+		const uint8_t* raw = &bytes[i * RECORD_SIZE];
+		if(raw[0] == TRACE_NONE)
+			continue;
+		Record* record = &records[numRecords];
+		record->ring = i / perRing;
+		record->event = raw[0];
+		record->arg = raw[1];
+		record->time = raw[2] | (uint32_t)raw[3] << 8 | (uint32_t)raw[4] << 16;
+		record->order = numRecords++;
+	}
+	return numRecords;
+}
+
+/**
+ * @brief Main function
+ */
+int main(int argc, char** argv)
+{
+	FILE* in = stdin;
+	if(argc > 1 && !(in = fopen(argv[1], "r")))
+	{
+		perror(argv[1]);
+		return 1;
+	}
+
+	static Record records[MAX_RECORDS];
+	static char line[MAX_RECORDS * RECORD_SIZE * 3 + 64];
+	unsigned long now = 0;
+	int dumps = 0;
+	bool inDump = false;
+	while(fgets(line, sizeof(line), in))
+	{
+		const char* text = strstr(line, RECORDS_TEXT);
+		if(inDump && text)
+		{
+			unsigned numRecords = parseRecords(text + strlen(RECORDS_TEXT), records);
+			if(numRecords)
+				render((uint32_t)now, records, numRecords);
+			dumps++;
+			inDump = false;
+			continue;
+		}
+
+		// Anything else ends a dump
+		const char* header = strstr(line, "Trace at ");
+		inDump = header && sscanf(header, "Trace at %lu", &now) == 1;
+	}
+	if(!dumps)
+		fprintf(stderr, "No trace found\n");
+	return dumps ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+/**
+ * @file xc.c
+ * @date 2026-10-18
+ * @brief Register variables for xc.h
+ */
+
+#include<xc.h>
+
+// Timer 2
+__typeof__(T2CLKCONbits) T2CLKCONbits;
+__typeof__(T2CONbits) T2CONbits;
+uint8_t T2PR;
+__typeof__(PIE3bits) PIE3bits;
+__typeof__(PIR3bits) PIR3bits;
+
+// Timer 0 and LED pins
+__typeof__(T0CON0bits) T0CON0bits;
+__typeof__(T0CON1bits) T0CON1bits;
+uint8_t TMR0H, TMR0IF;
+uint8_t LATC, TRISC;
+__typeof__(LATBbits) LATBbits;
+__typeof__(TRISBbits) TRISBbits;
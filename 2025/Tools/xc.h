@@ -0,0 +1,43 @@
+/**
+ * @file xc.h
+ * @date 2026-10-18
+ * @brief Stand-in for the XC8 device header when building firmware modules
+ * for Linux
+ * 
+ * Registers are plain variables, so modules that only configure peripherals
+ * compile and run (without effect). Intrinsics that would wait for the
+ * hardware do nothing. 
+ */
+
+#ifndef XC_H
+#define	XC_H
+
+#include<stdint.h>
+
+#define __interrupt(...)
+#define irq(x)
+#define high_priority
+#define low_priority
+#define di()
+#define ei()
+#define SLEEP()
+#define NOP()
+#define __delay_ms(x)
+#define __delay_us(x)
+
+// Timer 2 (timebase.c)
+extern struct { uint8_t CS; } T2CLKCONbits;
+extern struct { uint8_t CKPS, OUTPS, ON; } T2CONbits;
+extern uint8_t T2PR;
+extern struct { uint8_t TMR0IE, TMR2IE; } PIE3bits;
+extern struct { uint8_t TMR2IF; } PIR3bits;
+
+// Timer 0 and LED pins (led.c)
+extern struct { uint8_t MD16, OUTPS, EN; } T0CON0bits;
+extern struct { uint8_t CS, CKPS; } T0CON1bits;
+extern uint8_t TMR0H, TMR0IF;
+extern uint8_t LATC, TRISC;
+extern struct { uint8_t LATB7; } LATBbits;
+extern struct { uint8_t TRISB7; } TRISBbits;
+
+#endif // XC_H
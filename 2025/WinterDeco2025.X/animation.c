@@ -0,0 +1,105 @@
+/**
+ * @file animation.c
+ * @date 2026-10-18
+ * @brief Implements animation.h
+ */
+
+#include<xc.h>
+#include<stdbool.h>
+#include"animation.h"
+#include"led.h"
+#include"timebase.h"
+
+/**
+ * @brief Number of frames (0 if there is no animation)
+ */
+static uint8_t numFrames = 0;
+
+/**
+ * @brief Duration of each frame (in ms)
+ */
+static uint16_t frameDuration = 0;
+
+/**
+ * @brief The frame to be shown next
+ */
+static uint8_t nextFrame = 0;
+
+/**
+ * @brief Time since the last frame was shown (see timebaseElapsed())
+ */
+static uint16_t elapsed = 0;
+
+/**
+ * @brief Set while the next frame has not been taken by the LED driver
+ */
+static bool frameDue = false;
+
+/**
+ * @brief Reads a byte from the animation area
+ * @param offset The offset within the area. 
+ * @return Returns the byte. 
+ */
+static uint8_t animationRead(uint16_t offset)
+{
+	uint16_t address = BOOT_ANIMATION_START + offset;
+	NVMADRU = 0x00;
+	NVMADRH = (uint8_t)(address >> 8);
+	NVMADRL = (uint8_t)address;
+	NVMCON1bits.CMD = 0b000;	// Read byte
+	NVMCON0bits.GO = 1;
+	while(NVMCON0bits.GO);
+	return NVMDATL;
+}
+
+void animationInit(void)
+{
+	numFrames = 0;
+	nextFrame = 0;
+	elapsed = 0;
+	frameDue = true;
+	uint8_t frames = animationRead(2);
+	uint8_t ticks = animationRead(3);
+	if((animationRead(0) | (uint16_t)animationRead(1) << 8) != ANIMATION_MAGIC
+		|| frames == 0 || frames > ANIMATION_MAX_FRAMES || ticks == 0)
+	{
+		// No animation: show a cross
+		ledSetAll(0);
+		for(uint8_t i = 0; i < 8; i++)
+		{
+			ledSet(i, i, 64);
+			ledSet(i, 7 - i, 64);
+		}
+		return;
+	}
+	numFrames = frames;
+	frameDuration = ticks * TIMEBASE_TICK;
+}
+
+void animationUpdate(uint16_t dt, InputRecord* input)
+{
+	if(numFrames == 0)
+		return;
+	if(timebaseElapsed(&elapsed, dt, frameDuration))
+		frameDue = true;
+	if(!frameDue)
+		return;
+	
+	// Unpack the frame, two values per byte
+	uint8_t frame[64];
+	uint16_t offset = ANIMATION_HEADER_SIZE + (uint16_t)nextFrame * ANIMATION_FRAME_SIZE;
+	for(uint8_t i = 0; i < ANIMATION_FRAME_SIZE; i++)
+	{
+		uint8_t values = animationRead(offset + i);
+		frame[2 * i] = (uint8_t)(values << 4) | (values & 0x0f);
+		frame[2 * i + 1] = (values & 0xf0) | (values >> 4);
+	}
+	
+	// Try again at the next tick if the last frame is still pending
+	if(!ledShowValues(frame))
+		return;
+	frameDue = false;
+	nextFrame++;
+	if(nextFrame == numFrames)
+		nextFrame = 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file animation.h
+ * @date 2026-10-18
+ * @brief Program that plays an animation from the flash memory
+ * 
+ * The animation is uploaded into the animation area of the flash memory (see
+ * bootloader.h) by Tools/flashupload.c, so it can be changed without
+ * rebuilding the firmware. The area holds: 
+ * - ANIMATION_MAGIC (2 bytes, little-endian)
+ * - The number of frames (1 byte, 1..ANIMATION_MAX_FRAMES)
+ * - The duration of each frame in ticks (1 byte, 1..255)
+ * - The frames: 64 values of 4 bits each, row by row, two per byte (the
+ *   first one in the low nibble), so ANIMATION_FRAME_SIZE bytes per frame
+ * 
+ * The frames are shown with ledShowValues(), so the brightness settings
+ * apply. A frame that is still pending when the program is left is dropped by
+ * ledCancelFrame(). If there is no animation, a cross is shown instead. 
+ */
+
+#ifndef ANIMATION_H
+#define	ANIMATION_H
+
+#include<stdint.h>
+#include"input.h"
+#include"../Bootloader2025.X/bootloader.h"
+
+/**
+ * @brief Marks the start of an animation ("An")
+ */
+#define ANIMATION_MAGIC 0x6e41
+
+/**
+ * @brief Size of the header before the frames
+ */
+#define ANIMATION_HEADER_SIZE 4
+
+/**
+ * @brief Size of a frame
+ */
+#define ANIMATION_FRAME_SIZE 32
+
+/**
+ * @brief Number of frames that fit into the animation area
+ */
+#define ANIMATION_MAX_FRAMES ((BOOT_FLASH_END - BOOT_ANIMATION_START - ANIMATION_HEADER_SIZE) / ANIMATION_FRAME_SIZE)
+
+/**
+ * @brief Starts the animation from the first frame
+ * @details The initFunction of the program. 
+ */
+void animationInit(void);
+
+/**
+ * @brief Shows the next frame when it is due
+ * @details The updateFunction of the program. 
+ * @param dt Time since the last call (in ms). 
+ * @param input The input event or NULL. 
+ */
+void animationUpdate(uint16_t dt, InputRecord* input);
+
+#endif // ANIMATION_H
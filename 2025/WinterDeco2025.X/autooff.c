@@ -0,0 +1,86 @@
+/**
+ * @file autooff.c
+ * @date 2026-10-18
+ * @brief Implements autooff.h
+ */
+
+#include<xc.h>
+#include"autooff.h"
+#include"eeprom.h"
+#include"logger.h"
+
+/**
+ * @brief Available timeouts in minutes (0 = never)
+ */
+static const uint16_t TIMEOUTS[AUTOOFF_NUM_SETTINGS] = {0, 15, 30, 60, 120, 240};
+
+/**
+ * @brief The selected setting (index into TIMEOUTS)
+ */
+static uint8_t setting = AUTOOFF_DEFAULT;
+
+/**
+ * @brief Time since the last input (in ms)
+ */
+static uint32_t sinceInput;
+
+void autoOffInit(void)
+{
+	// Erased EEPROM reads 0xff
+	setting = eepromRead(AUTOOFF_ADDRESS);
+	if(setting >= AUTOOFF_NUM_SETTINGS)
+		setting = AUTOOFF_DEFAULT;
+	sinceInput = 0;
+}
+
+void autoOffReset(void)
+{
+	sinceInput = 0;
+}
+
+bool autoOffUpdate(uint16_t dt)
+{
+	if(TIMEOUTS[setting] == 0)
+		return false;
+	sinceInput += dt;
+	return sinceInput >= TIMEOUTS[setting] * 60000ul;
+}
+
+/**
+ * @brief Selects a setting, stores it and restarts the timer
+ * @param newSetting The setting (0..AUTOOFF_NUM_SETTINGS-1). 
+ */
+static void selectSetting(uint8_t newSetting)
+{
+	setting = newSetting;
+	eepromWrite(AUTOOFF_ADDRESS, setting);
+	sinceInput = 0;
+	if(TIMEOUTS[setting] == 0)
+		logMessage(LOG_AUTOOFF_DISABLED);
+	else
+		logMessage(LOG_AUTOOFF, TIMEOUTS[setting]);
+}
+
+uint8_t autoOffNextSetting(void)
+{
+	selectSetting((setting + 1) % AUTOOFF_NUM_SETTINGS);
+	return setting;
+}
+
+bool autoOffSetTimeout(uint16_t minutes)
+{
+	for(uint8_t i = 0; i < AUTOOFF_NUM_SETTINGS; i++)
+	{
+		if(TIMEOUTS[i] == minutes)
+		{
+			selectSetting(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+uint16_t autoOffTimeout(void)
+{
+	return TIMEOUTS[setting];
+}
@@ -5,11 +5,61 @@
  */
 
 #include<xc.h>
+#include<stdbool.h>
 #include"battery.h"
+#include"energy.h"
 
-#define SAMPLES 8 // 1..16
+/**
+ * @brief Lowest ADC reading covered by RECIPROCALS (VDD = 4096mV)
+ */
+#define RECIPROCAL_MIN 1024
 
-uint16_t batteryVoltage(void)
+/**
+ * @brief Step between the entries of RECIPROCALS (as power of 2)
+ */
+#define RECIPROCAL_SHIFT 5
+
+/**
+ * @brief Number of entries in RECIPROCALS
+ */
+#define RECIPROCAL_SIZE 49
+
+/**
+ * @brief Battery voltage in mV for ADC readings of the 1.024V reference
+ * @details Entry i is 1024mV * 4096 / (RECIPROCAL_MIN + i * 32), covering
+ * 4096mV down to 1638mV. Values in between are interpolated linearly (error
+ * below 1mV). 
+ */
+static const uint16_t RECIPROCALS[RECIPROCAL_SIZE] =
+{
+	4096, 3972, 3855, 3745, 3641, 3542, 3449, 3361, 3277, 3197,
+	3121, 3048, 2979, 2913, 2849, 2789, 2731, 2675, 2621, 2570,
+	2521, 2473, 2427, 2383, 2341, 2300, 2260, 2222, 2185, 2149,
+	2114, 2081, 2048, 2016, 1986, 1956, 1928, 1900, 1872, 1846,
+	1820, 1796, 1771, 1748, 1725, 1702, 1680, 1659, 1638
+};
+
+/**
+ * @brief Latest battery voltage (in mV)
+ */
+static uint16_t cachedVoltage;
+
+/**
+ * @brief Time since the last measurement was started (in ms)
+ */
+static uint32_t sinceMeasurement;
+
+/**
+ * @brief True while a background measurement is running
+ */
+static bool measuring;
+
+/**
+ * @brief Powers up the FVR and the ADC and starts a burst of conversions
+ * @details The ADC averages BATTERY_SAMPLES conversions of the 1.024V
+ * reference in hardware. 
+ */
+static void measurementStart(void)
 {
 	// Enable FVR and wait for it to stabilise
 	PMD0bits.FVRMD = 0;
@@ -24,6 +74,10 @@ uint16_t batteryVoltage(void)
 	ADCON0bits.FM = 1;				// Result right aligned
 	ADCON0bits.CS = 0;				// Derive ADC clock from F_OSC
 	ADCON1bits.DSEN = 0;			// No double sampling
+	ADCON2bits.MD = 0b011;			// Burst average mode: all conversions on one trigger
+	ADCON2bits.CRS = 5;				// Filtered result = accumulator / 2^5
+	ADCON2bits.ACLR = 1;			// Clear accumulator
+	ADRPT = BATTERY_SAMPLES;		// Number of conversions
 	ADCLKbits.CS = 31;				// ADC Clock freq. = F_OSC/(2*(31+1)) = 1MHz
 	ADPCHbits.PCH = 0b00111110;		// Input: FVR Buffer 1
 	ADREFbits.NREF = 0b0;			// Negative Reference: AVSS
@@ -31,18 +85,19 @@ uint16_t batteryVoltage(void)
 	ADPRE = 0;						// No Precharging
 	ADACQ = 32;						// Acquisition time: 32 clock cycles
 	ADCAP = 0;						// No additional Sample&Hold capacity
+	
+	// Start conversions
+	ADCON0bits.GO_nDONE = 1;
+	energyAddConversions(BATTERY_SAMPLES);
+}
 
-	uint16_t adcValue = 0;
-	for(uint8_t i = 0; i < SAMPLES; i++)
-	{
-		// Start conversion
-		ADCON0bits.GO_nDONE = 1;
-		// Wait for it to finish
-		while(ADCON0bits.GO_nDONE);
-		// Read result
-		adcValue += ADRES;
-	}
-	adcValue /= SAMPLES;
+/**
+ * @brief Reads the result of the burst, powers down ADC and FVR and updates
+ * the cached voltage
+ */
+static void measurementFinish(void)
+{
+	uint16_t adcValue = ADFLTR;
 	
 	// Disable ADC
 	ADCON0bits.ON = 0;
@@ -52,5 +107,65 @@ uint16_t batteryVoltage(void)
 	FVRCONbits.EN = 0;
 	PMD0bits.FVRMD = 1;
 	
-	return (uint16_t)(1024ul * (1ul << 12) / adcValue);
+	// Look up voltage
+	if(adcValue < RECIPROCAL_MIN)
+		adcValue = RECIPROCAL_MIN;
+	uint16_t offset = adcValue - RECIPROCAL_MIN;
+	uint8_t index = (uint8_t)(offset >> RECIPROCAL_SHIFT);
+	if(index >= RECIPROCAL_SIZE - 1)
+	{
+		cachedVoltage = RECIPROCALS[RECIPROCAL_SIZE - 1];
+		return;
+	}
+	uint8_t fraction = offset & ((1 << RECIPROCAL_SHIFT) - 1);
+	uint16_t step = RECIPROCALS[index] - RECIPROCALS[index + 1];
+	cachedVoltage = RECIPROCALS[index] - (uint16_t)((step * fraction) >> RECIPROCAL_SHIFT);
+}
+
+uint16_t batteryVoltage(void)
+{
+	if(!measuring)
+		measurementStart();
+	while(ADCON0bits.GO_nDONE);
+	measurementFinish();
+	measuring = false;
+	sinceMeasurement = 0;
+	return cachedVoltage;
+}
+
+void batteryUpdate(uint16_t dt)
+{
+	if(measuring)
+	{
+		// Collect result once the burst has finished
+		if(!ADCON0bits.GO_nDONE)
+		{
+			measurementFinish();
+			measuring = false;
+		}
+		return;
+	}
+	
+	sinceMeasurement += dt;
+	if(sinceMeasurement >= BATTERY_INTERVAL)
+	{
+		sinceMeasurement = 0;
+		measurementStart();
+		measuring = true;
+	}
+}
+
+void batteryStop(void)
+{
+	if(measuring)
+	{
+		while(ADCON0bits.GO_nDONE);
+		measurementFinish();
+		measuring = false;
+	}
+}
+
+uint16_t batteryCached(void)
+{
+	return cachedVoltage;
 }
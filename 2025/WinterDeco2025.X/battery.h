@@ -3,6 +3,12 @@
  * @date 2024-10-06
  * @brief Library for checking battery voltage using the ADC and the internal
  * fixed voltage reference. 
+ * 
+ * The ADC measures the 1.024V reference against VDD, averaging a burst of
+ * conversions in hardware. The battery voltage is then looked up in a table
+ * instead of dividing. Apart from the measurement at start-up, the voltage is
+ * measured in the background every few minutes and cached, so other modules
+ * can use it at no cost. 
  */
 
 #ifndef BATTERY_H
@@ -10,11 +16,44 @@
 
 #include<stdint.h>
 
+/**
+ * @brief Number of conversions averaged by the ADC per measurement
+ * @details Must match the right shift ADCON2bits.CRS in battery.c. 
+ */
+#define BATTERY_SAMPLES 32
+
+/**
+ * @brief Period of the background measurements (in ms)
+ */
+#define BATTERY_INTERVAL 120000ul
+
 /**
  * @brief Reads the battery voltage
- * @details The ADC and the fixed voltage reference must not be in use. 
+ * @details Waits for the measurement to finish (about 2ms). The ADC and the
+ * fixed voltage reference must not be in use. 
  * @return The battery voltage in millivolts (mV). 
  */
 uint16_t batteryVoltage(void);
 
+/**
+ * @brief Measures the battery voltage in the background
+ * @details Called from the main loop at every system clock tick. Every
+ * BATTERY_INTERVAL, this starts a measurement and collects its result at the
+ * next call. 
+ * @param dt Time since the last call (in ms). 
+ */
+void batteryUpdate(uint16_t dt);
+
+/**
+ * @brief Finishes any running measurement and powers down ADC and FVR
+ * @details Call before going to sleep. 
+ */
+void batteryStop(void);
+
+/**
+ * @brief Returns the latest battery voltage
+ * @return The battery voltage in millivolts (mV) as of the last measurement. 
+ */
+uint16_t batteryCached(void);
+
 #endif // BATTERY_H
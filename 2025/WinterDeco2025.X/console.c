@@ -0,0 +1,169 @@
+/**
+ * @file console.c
+ * @date 2026-10-18
+ * @brief Implements console.h
+ */
+
+#include<xc.h>
+#include<string.h>
+#include"console.h"
+#include"uart.h"
+#include"logger.h"
+#include"battery.h"
+#include"energy.h"
+#include"perf.h"
+#include"trace.h"
+#include"led.h"
+#include"autooff.h"
+
+/**
+ * @brief The line being received
+ */
+static char line[CONSOLE_LINE_LENGTH + 1];
+
+/**
+ * @brief Number of characters in line
+ */
+static uint8_t length = 0;
+
+/**
+ * @brief Set if the line being received is too long
+ */
+static bool overflow = false;
+
+void consoleInit(void)
+{
+	length = 0;
+	overflow = false;
+}
+
+/**
+ * @brief Parses a decimal number
+ * @param text The number, nothing else. 
+ * @param value Receives the number. 
+ * @return Returns false if the text is not a number from 0 to 65535. 
+ */
+static bool parseNumber(const char* text, uint16_t* value)
+{
+	if(!*text)
+		return false;
+	uint32_t result = 0;
+	for(; *text; text++)
+	{
+		if(*text < '0' || *text > '9')
+			return false;
+		result = result * 10 + (uint8_t)(*text - '0');
+		if(result > 0xffff)
+			return false;
+	}
+	*value = (uint16_t)result;
+	return true;
+}
+
+/**
+ * @brief Executes the command in line
+ * @param request Receives what is left for the main loop to do. 
+ */
+static void execute(ConsoleRequest* request)
+{
+	request->action = CONSOLE_NONE;
+	
+	// Split the line into the command and the argument (if any)
+	char* split = strchr(line, ' ');
+	char* argument = NULL;
+	if(split)
+	{
+		*split = '\0';
+		argument = split + 1;
+	}
+	uint16_t value = 0;
+	bool hasValue = argument && parseNumber(argument, &value);
+	
+	if(strcmp(line, "help") == 0 && !argument)
+	{
+		logMessage(LOG_CONSOLE_HELP);
+	}
+	else if(strcmp(line, "program") == 0 && hasValue && value <= 255)
+	{
+		request->action = CONSOLE_PROGRAM;
+		request->program = (uint8_t)value;
+	}
+	else if(strcmp(line, "battery") == 0 && !argument)
+	{
+		logMessage(LOG_BATTERY, batteryCached());
+	}
+	else if(strcmp(line, "energy") == 0 && !argument)
+	{
+		energyReport();
+	}
+	else if(strcmp(line, "perf") == 0 && !argument)
+	{
+		perfReport();
+	}
+	else if(strcmp(line, "trace") == 0 && !argument)
+	{
+		traceDump();
+	}
+	else if(strcmp(line, "brightness") == 0 && hasValue && value <= 255)
+	{
+		ledSetBrightnessLimit((uint8_t)value);
+		logMessage(LOG_BRIGHTNESS_LIMIT, value);
+	}
+	else if(strcmp(line, "longlife") == 0 && hasValue && value <= 1)
+	{
+		ledSetLongLife(value != 0);
+		logMessage(LOG_LONG_LIFE, value);
+	}
+	else if(strcmp(line, "timeout") == 0 && hasValue && autoOffSetTimeout(value))
+	{
+		// Logged by autoOffSetTimeout()
+	}
+	else if(strcmp(line, "sleep") == 0 && !argument)
+	{
+		request->action = CONSOLE_SLEEP;
+	}
+	else if(strcmp(line, "boot") == 0 && !argument)
+	{
+		request->action = CONSOLE_BOOT;
+	}
+	else
+	{
+		if(split)
+			*split = ' ';
+		logMessage(LOG_CONSOLE_ERROR, line);
+	}
+}
+
+bool consoleNext(ConsoleRequest* request)
+{
+	char c;
+	while(uartReceive(&c))
+	{
+		if(c != '\r' && c != '\n')
+		{
+			if(length < CONSOLE_LINE_LENGTH)
+				line[length++] = c;
+			else
+				overflow = true;
+			continue;
+		}
+		
+		// Skip empty lines (e.g. the LF of CR LF)
+		if(length == 0 && !overflow)
+			continue;
+		line[length] = '\0';
+		length = 0;
+		if(overflow)
+		{
+			overflow = false;
+			request->action = CONSOLE_NONE;
+			logMessage(LOG_CONSOLE_ERROR, line);
+		}
+		else
+		{
+			execute(request);
+		}
+		return true;
+	}
+	return false;
+}
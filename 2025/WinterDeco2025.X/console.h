@@ -0,0 +1,79 @@
+/**
+ * @file console.h
+ * @date 2026-10-18
+ * @brief Command console over UART
+ * 
+ * Commands are received as lines of text (terminated by CR and/or LF) and
+ * answered with log messages (see logger.h): 
+ * - help: Lists the commands
+ * - program <n>: Switches to program n
+ * - battery: Reports the battery voltage
+ * - energy: Reports the energy used by each program (see energy.h)
+ * - perf: Reports the cycle counts (see perf.h)
+ * - trace: Sends the trace of recent events (see trace.h)
+ * - brightness <0..255>: Limits the brightness (see ledSetBrightnessLimit(),
+ *   not applied to streamed planes)
+ * - longlife <0|1>: Selects the long-life setting
+ * - timeout <minutes>: Selects the auto-off timeout (see autooff.h)
+ * - sleep: Turns the device off
+ * - boot: Starts the bootloader (see bootloader.h)
+ * 
+ * The console only works with what has already been received, so it never
+ * waits for the rest of a line. Commands that concern the main loop are
+ * passed on to it as a ConsoleRequest. 
+ */
+
+#ifndef CONSOLE_H
+#define	CONSOLE_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/**
+ * @brief Maximum length of a command line (without terminator)
+ * @details Longer lines are rejected as a whole. 
+ */
+#define CONSOLE_LINE_LENGTH 24
+
+/**
+ * @brief Enumeration type for requests to the main loop
+ */
+typedef enum
+{
+	/// Nothing to do, the command has been executed by the console
+	CONSOLE_NONE,
+	/// Switch to a program
+	CONSOLE_PROGRAM,
+	/// Go to sleep
+	CONSOLE_SLEEP,
+	/// Start the bootloader
+	CONSOLE_BOOT
+} ConsoleAction;
+
+/**
+ * @brief Request to the main loop
+ */
+typedef struct
+{
+	/// What to do
+	ConsoleAction action;
+	/// Index of the program (CONSOLE_PROGRAM only, not checked)
+	uint8_t program;
+} ConsoleRequest;
+
+/**
+ * @brief Discards a partly received line
+ * @details Call after wake-up. 
+ */
+void consoleInit(void);
+
+/**
+ * @brief Executes the next complete command line, if any
+ * @details Called from the main loop until it returns false. Doesn't wait
+ * for input. 
+ * @param request Receives what is left for the main loop to do. 
+ * @return Returns true if a command has been received (valid or not). 
+ */
+bool consoleNext(ConsoleRequest* request);
+
+#endif // CONSOLE_H
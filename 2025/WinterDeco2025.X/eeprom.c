@@ -0,0 +1,66 @@
+/**
+ * @file eeprom.c
+ * @date 2026-10-18
+ * @brief Implementation of eeprom.h
+ */
+
+#include<xc.h>
+#include<stdbool.h>
+#include"eeprom.h"
+
+/**
+ * @brief Selects an EEPROM address for the next NVM operation
+ * @param address The address within the EEPROM.
+ */
+static void eepromAddress(uint8_t address)
+{
+	// Data EEPROM starts at 0x380000
+	NVMADRU = 0x38;
+	NVMADRH = 0x00;
+	NVMADRL = address;
+}
+
+uint8_t eepromRead(uint8_t address)
+{
+	eepromAddress(address);
+	NVMCON1bits.CMD = 0b000;	// Read byte
+	NVMCON0bits.GO = 1;
+	while(NVMCON0bits.GO);
+	return NVMDATL;
+}
+
+void eepromWrite(uint8_t address, uint8_t data)
+{
+	if(eepromRead(address) == data)
+		return;
+	
+	NVMDATL = data;
+	NVMCON1bits.CMD = 0b011;	// Write byte
+	
+	// Unlock sequence, must not be interrupted
+	bool interrupts = INTCON0bits.GIE;
+	di();
+	NVMLOCK = 0x55;
+	NVMLOCK = 0xAA;
+	NVMCON0bits.GO = 1;
+	if(interrupts)
+		ei();
+	
+	// Wait for write to finish
+	while(NVMCON0bits.GO);
+	NVMCON1bits.CMD = 0b000;	// Back to reading (no accidental writes)
+}
+
+void eepromReadBlock(uint8_t address, void* data, uint8_t length)
+{
+	uint8_t* bytes = data;
+	for(uint8_t i = 0; i < length; i++)
+		bytes[i] = eepromRead(address + i);
+}
+
+void eepromWriteBlock(uint8_t address, const void* data, uint8_t length)
+{
+	const uint8_t* bytes = data;
+	for(uint8_t i = 0; i < length; i++)
+		eepromWrite(address + i, bytes[i]);
+}
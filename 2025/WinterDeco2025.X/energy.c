@@ -0,0 +1,78 @@
+/**
+ * @file energy.c
+ * @date 2026-10-18
+ * @brief Implements energy.h
+ */
+
+#include<xc.h>
+#include"energy.h"
+#include"led.h"
+#include"logger.h"
+#include"programs.h"
+
+/**
+ * @brief Charge drawn by each program (in uA*s)
+ */
+static uint32_t charge[ENERGY_MAX_PROGRAMS];
+
+/**
+ * @brief Running time of each program (in ms)
+ */
+static uint32_t runTime[ENERGY_MAX_PROGRAMS];
+
+/**
+ * @brief Charge not yet added to a program (in uA*ms, below 1uA*s)
+ */
+static uint32_t fraction = 0;
+
+/**
+ * @brief The program that is charged
+ */
+static uint8_t currentProgram = 0;
+
+/**
+ * @brief Adds the collected fraction to the current program
+ */
+static void energyCarry(void)
+{
+	charge[currentProgram] += fraction / 1000;
+	fraction %= 1000;
+}
+
+void energySelect(uint8_t program)
+{
+	if(program >= ENERGY_MAX_PROGRAMS)
+		program = ENERGY_MAX_PROGRAMS - 1;
+	currentProgram = program;
+}
+
+void energyUpdate(uint16_t dt)
+{
+	// Average LED current from the number of lit LEDs (see ledLoad()) plus the
+	// core
+	uint32_t current = (uint32_t)ledLoad() * ENERGY_LED_CURRENT / (16 * ((1 << COLOUR_DEPTH) - 1));
+	current += ENERGY_CPU_CURRENT;
+	fraction += current * dt;
+	runTime[currentProgram] += dt;
+	energyCarry();
+}
+
+void energyAddConversions(uint8_t conversions)
+{
+	fraction += (uint16_t)conversions * ENERGY_ADC_CHARGE;
+	energyCarry();
+}
+
+void energyReport(void)
+{
+	logMessage(LOG_ENERGY_HEADER);
+	for(uint8_t i = 0; i < NUM_ALL_PROGRAMS && i < ENERGY_MAX_PROGRAMS; i++)
+	{
+		if(runTime[i] < 1000)
+			continue;
+		// 1uAh = 3600uA*s
+		uint32_t tenthsUAh = charge[i] * 10 / 3600;
+		logMessage(LOG_ENERGY, PROGRAMS[i].name, runTime[i] / 1000,
+			tenthsUAh / 10, tenthsUAh % 10, charge[i] / (runTime[i] / 1000));
+	}
+}
@@ -0,0 +1,68 @@
+/**
+ * @file energy.h
+ * @date 2026-10-18
+ * @brief Estimates the charge drawn from the battery by each program
+ *
+ * The estimate adds up the LED on-time (see ledLoad()), the time the core is
+ * active and the ADC conversions. The totals are kept in RAM since power-up and
+ * can be reported over UART, so programs can be ranked by their drain.
+ *
+ * The currents are typical values at 3V, so the results are estimates that are
+ * mainly good for comparing programs with each other.
+ */
+
+#ifndef ENERGY_H
+#define	ENERGY_H
+
+#include<stdint.h>
+
+/**
+ * @brief Current through a lit LED (in uA)
+ * @details (3V - V_F) / 68 Ohm with the typical V_F of 1.9V.
+ */
+#define ENERGY_LED_CURRENT 16000
+
+/**
+ * @brief Current of the active core at 64MHz (in uA)
+ * @details The main loop waits for the tick without idling, so the core is
+ * active all the time the device is awake.
+ */
+#define ENERGY_CPU_CURRENT 4500
+
+/**
+ * @brief Charge of one ADC conversion including the FVR (in uA*ms)
+ */
+#define ENERGY_ADC_CHARGE 20
+
+/**
+ * @brief Maximum number of programs that are accounted for
+ */
+#define ENERGY_MAX_PROGRAMS 8
+
+/**
+ * @brief Selects the program that is charged from now on
+ * @param program Index of the program.
+ */
+void energySelect(uint8_t program);
+
+/**
+ * @brief Accounts for the time since the last call
+ * @details Called from the main loop at every system clock tick.
+ * @param dt Time since the last call (in ms).
+ */
+void energyUpdate(uint16_t dt);
+
+/**
+ * @brief Accounts for ADC conversions
+ * @param conversions Number of conversions.
+ */
+void energyAddConversions(uint8_t conversions);
+
+/**
+ * @brief Reports the totals of all programs over UART
+ * @details Prints the running time, the charge (in uAh) and the average
+ * current of each program that has run.
+ */
+void energyReport(void);
+
+#endif // ENERGY_H
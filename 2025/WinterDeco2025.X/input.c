@@ -7,17 +7,53 @@
 #include<stdbool.h>
 #include<stdint.h>
 #include<xc.h>
+#include"timebase.h"
 #include"input.h"
+#include"perf.h"
+#include"trace.h"
 
 /**
- * @brief Current status of the buttons (pressed or not)
+ * @brief Mask for the button pins RB[4:6] in PORTB and the IOC registers
  */
-static bool isPressed[NUM_BUTTONS];
+#define BUTTON_MASK 0b01110000
 
 /**
- * @brief Press duration for buttons that are currently pressed
+ * @brief Debounced status of the buttons (Bit i set if Button i is pressed)
  */
-static uint8_t pressDuration[NUM_BUTTONS];
+static volatile uint8_t isPressed;
+
+/**
+ * @brief System time at which the buttons that are currently pressed were
+ * pressed
+ */
+static volatile uint32_t pressTime[NUM_BUTTONS];
+
+/**
+ * @brief System time of the first edge since the last debounce
+ */
+static volatile uint32_t edgeTime;
+
+/**
+ * @brief Events detected by the interrupts that have not been collected by
+ * inputNext() yet
+ */
+static volatile InputRecord queue[INPUT_QUEUE_SIZE];
+
+/**
+ * @brief Index of the oldest event in the queue (only written by inputNext())
+ */
+static volatile uint8_t queueHead;
+
+/**
+ * @brief Index after the newest event in the queue (only written by the ISR)
+ */
+static volatile uint8_t queueTail;
+
+/**
+ * @brief Buttons for which EVENT_HOLD_LONG has been reported during the
+ * current press (Bit i set for Button i)
+ */
+static uint8_t isPressedLong;
 
 void inputInit()
 {
@@ -32,59 +68,173 @@ void inputInit()
 	WPUBbits.WPUB5 = 1;
 	WPUBbits.WPUB6 = 1;
 	
+	// Set up Timer 4 as one-shot debounce timer
+	PMD1bits.TMR4MD = 0;
+	T4CONbits.ON = 0;
+	T4CLKCONbits.CS = 0b0100;	// Clock source: LFINTOSC (31kHz)
+	T4HLTbits.MODE = 0b01000;	// One-shot, started by software
+	T4CONbits.CKPS = 0b000;		// Prescaler 1:1
+	T4CONbits.OUTPS = 0b0000;	// Postscaler 1:1
+	T4PR = 155;					// Compare value (31kHz/155 = 5ms)
+	TMR4IF = 0;
+	TMR4IE = 1;					// Enable interrupt on compare match
+	
 	// Reset internal state
-	for(uint8_t i = 0; i < NUM_BUTTONS; i++)
-	{
-		isPressed[i] = false;
-		pressDuration[i] = 0;
-	}
+	isPressed = 0;
+	isPressedLong = 0;
+	queueHead = queueTail = 0;
+	
+	// Interrupt on both edges of all buttons
+	IOCBP |= BUTTON_MASK;
+	IOCBN |= BUTTON_MASK;
+	IOCBF &= ~BUTTON_MASK;
+	PIE0bits.IOCIE = 1;
 }
 
-void inputUpdate(InputEvent events[NUM_BUTTONS])
+void inputStop()
 {
-	for(uint8_t i = 0; i < NUM_BUTTONS; i++)
+	PIE0bits.IOCIE = 0;
+	IOCBP &= ~BUTTON_MASK;
+	IOCBN &= ~BUTTON_MASK;
+	IOCBF &= ~BUTTON_MASK;
+	T4CONbits.ON = 0;
+	TMR4IE = 0;
+	PMD1bits.TMR4MD = 1;
+}
+
+bool inputNext(InputRecord* record)
+{
+	// Take the oldest event from the queue
+	if(queueHead != queueTail)
 	{
-		// Initialise event
-		events[i] = EVENT_NONE;
-		
-		// Increment press duration
-		if(isPressed[i] && pressDuration[i] < 255)
-			pressDuration[i]++;
-		
-		// Get current state of the button
-		bool pressed = ((PORTB >> (4 + i)) & 1) == 0;
+		uint8_t head = queueHead;
+		record->button = queue[head].button;
+		record->event = queue[head].event;
+		record->time = queue[head].time;
+		queueHead = (head + 1) & (INPUT_QUEUE_SIZE - 1);
 		
-		// Detect events
-		if(pressed && !isPressed[i])
-		{
-			// Button was just pressed
-			isPressed[i] = true;
-			pressDuration[i] = 0;
-			events[i] = EVENT_PRESS;
-		}
-		else if(pressed && isPressed[i] && pressDuration[i] >= LONG_PRESS_DURATION)
-		{
-			events[i] = EVENT_HOLD_LONG;
-		}
-		else if(!pressed && isPressed[i])
+		// A new press may be held long again
+		if(record->event == EVENT_PRESS)
+			isPressedLong &= (uint8_t)~(1 << record->button);
+		return true;
+	}
+	
+	// Report buttons that have been held for a long time
+	uint32_t now = timebaseNow();
+	for(uint8_t i = 0; i < NUM_BUTTONS; i++)
+	{
+		if((isPressedLong >> i) & 1)
+			continue;
+		di();
+		bool pressed = (isPressed >> i) & 1;
+		uint32_t since = pressTime[i];
+		ei();
+		if(pressed && now - since >= LONG_PRESS_DURATION)
 		{
-			// Button was just released
-			isPressed[i] = false;
-			// Check how long it was pressed for
-			events[i] = pressDuration[i] >= LONG_PRESS_DURATION ? EVENT_RELEASE_LONG : EVENT_RELEASE_SHORT;
+			isPressedLong |= (uint8_t)(1 << i);
+			record->button = i;
+			record->event = EVENT_HOLD_LONG;
+			record->time = since + LONG_PRESS_DURATION;
+			return true;
 		}
 	}
+	return false;
+}
+
+bool inputIs(const InputRecord* record, Button button, InputEvent event)
+{
+	return record && record->button == button && record->event == event;
 }
 
 bool inputPressed(Button button)
 {
-	return isPressed[button];
+	return (isPressed >> button) & 1;
+}
+
+bool inputPressedLong(Button button)
+{
+	return (isPressed & isPressedLong) >> button & 1;
 }
 
 bool inputPressedAny()
 {
+	return isPressed != 0;
+}
+
+/**
+ * @brief Adds an event to the queue
+ * @details Must only be called from the ISRs. 
+ * @param button The button.
+ * @param event What happened.
+ * @param time System time of the event.
+ */
+static void inputPush(Button button, InputEvent event, uint32_t time)
+{
+	uint8_t tail = queueTail;
+	uint8_t next = (tail + 1) & (INPUT_QUEUE_SIZE - 1);
+	if(next == queueHead)
+		// Queue is full, drop event
+		return;
+	queue[tail].button = button;
+	queue[tail].event = event;
+	queue[tail].time = time;
+	queueTail = next;
+}
+
+/**
+ * @brief Interrupt handler for pin changes on the buttons
+ * 
+ * Timestamps the first edge and (re-)starts the debounce timer. The buttons
+ * are only read once they have not changed for a whole debounce period. 
+ */
+void __interrupt(irq(IOC), low_priority) iocIsr(void)
+{
+	if(!T4CONbits.ON)
+		edgeTime = timebaseNow();
+	T4CONbits.ON = 0;
+	T4TMR = 0;
+	T4CONbits.ON = 1;
+
+	// Clear interrupt flags (only those that were set when reading them)
+	uint8_t flags = IOCBF & BUTTON_MASK;
+	IOCBF ^= flags;
+	TRACE(TRACE_LOW, TRACE_EDGE, flags);
+}
+
+/**
+ * @brief Interrupt handler for Timer 4 (end of debounce period)
+ */
+void __interrupt(irq(TMR4), low_priority) timer4Isr(void)
+{
+	PERF_BEGIN();
+	TRACE(TRACE_LOW, TRACE_DEBOUNCE_ENTER, 0);
+	
+	// Get the current state of the buttons (active low)
+	uint8_t pressed = (uint8_t)(~PORTB & BUTTON_MASK) >> 4;
+	uint8_t changed = pressed ^ isPressed;
+	isPressed = pressed;
+	
+	// Detect events
 	for(uint8_t i = 0; i < NUM_BUTTONS; i++)
-		if(isPressed[i])
-			return true;
-	return false;
+	{
+		if(!((changed >> i) & 1))
+			continue;
+		if((pressed >> i) & 1)
+		{
+			// Button was just pressed
+			pressTime[i] = edgeTime;
+			inputPush(i, EVENT_PRESS, edgeTime);
+		}
+		else
+		{
+			// Button was just released, check how long it was pressed for
+			inputPush(i, edgeTime - pressTime[i] >= LONG_PRESS_DURATION ? EVENT_RELEASE_LONG : EVENT_RELEASE_SHORT, edgeTime);
+		}
+	}
+	
+	// Clear interrupt
+	TMR4IF = 0;
+	
+	TRACE(TRACE_LOW, TRACE_DEBOUNCE_EXIT, 0);
+	PERF_END(PERF_INPUT);
 }
@@ -5,12 +5,21 @@
  * 
  * Each time a button is pressed or released, an input event is generated. In
  * the case of a button release, the duration of the press is also calculated. 
+ * 
+ * The buttons on RB[4:6] are not polled. Instead, an interrupt-on-change
+ * timestamps each edge and starts Timer 4, which reads the buttons once they
+ * have been stable for 5ms. 
+ * 
+ * The events are stored with their timestamp in a queue, so none are lost if
+ * several occur between two calls to inputNext(). The queue is lock-free: The
+ * interrupts are the only producer, the main loop the only consumer. 
  */
 
 #ifndef INPUT_H
 #define	INPUT_H
 
 #include<stdbool.h>
+#include<stdint.h>
 
 /**
  * @brief Enumeration type for buttons
@@ -39,27 +48,64 @@ typedef enum
 } InputEvent;
 
 /**
- * @brief Defines swhat constitutes a "long" time
- * @details This is in units of 100ms (or whatever the period between calls to
- * inputUpdate()).
+ * @brief Input event with the time at which it occurred
+ */
+typedef struct
+{
+	/// The button
+	Button button;
+	/// What happened
+	InputEvent event;
+	/// System time of the event (in ms)
+	uint32_t time;
+} InputRecord;
+
+/**
+ * @brief Defines what constitutes a "long" time (in ms)
  */
-#define LONG_PRESS_DURATION 20
+#define LONG_PRESS_DURATION 2000
+
+/**
+ * @brief Number of events that can be queued (must be a power of 2)
+ * @details If the queue is full, new events are dropped. 
+ */
+#define INPUT_QUEUE_SIZE 8
 
 /**
  * @brief Initialise the library
  * @details This should be called before any other functions in this library.
+ * It enables the pin change interrupt, interrupts must be enabled globally
+ * separately. 
  */
 void inputInit(void);
 
 /**
- * @brief Queries all buttons and calculates input events
- * @details This function is called from the main loop at regular intervals,
- * typically 100ms. Note that inputs shorter than this period might not be
- * detected.
- * @param events Upon return, this array contains the latest input event for
- * each button.
+ * @brief Stops monitoring the buttons
+ * @details Disables the pin change interrupt and the debounce timer, e.g.
+ * before going to sleep. Call inputInit() to start again. 
+ */
+void inputStop(void);
+
+/**
+ * @brief Takes the next input event from the queue
+ * @details Events are returned in the order in which they occurred. Once the
+ * queue is empty, an EVENT_HOLD_LONG is returned (once per press) for each
+ * button that has been held for LONG_PRESS_DURATION. Events are detected by
+ * interrupts, so this is cheap. 
+ * @param record Upon return, this contains the event (if any). 
+ * @return Returns true if there was an event, false otherwise. 
+ */
+bool inputNext(InputRecord* record);
+
+/**
+ * @brief Check for a specific input event
+ * @param record The input event to be checked (may be null).
+ * @param button The button in question.
+ * @param event The event in question.
+ * @return True if record is not null and matches button and event, false
+ * otherwise. 
  */
-void inputUpdate(InputEvent events[NUM_BUTTONS]);
+bool inputIs(const InputRecord* record, Button button, InputEvent event);
 
 /**
  * @brief Get the state of a button
@@ -70,6 +116,16 @@ void inputUpdate(InputEvent events[NUM_BUTTONS]);
  */
 bool inputPressed(Button button);
 
+/**
+ * @brief Check if a button is being held for a long time
+ * @details True once the EVENT_HOLD_LONG of the button has been returned by
+ * inputNext() and until the button is released. 
+ * @param button The button in question.
+ * @return True if the button is currently held for a long time, false
+ * otherwise. 
+ */
+bool inputPressedLong(Button button);
+
 /**
  * @brief Check if any button is currently pressed
  * @details Note that this function does not query the button itself but instead
@@ -6,17 +6,90 @@
 
 #include<xc.h>
 #include"led.h"
+#include"perf.h"
+#include"trace.h"
 
 /**
- * @brief The framebuffer for the LEDs
- * 
- * The buffer has a separate plane for each bit of the colour depth. 
- * Each plane stores the LATC values for each row. 
+ * @brief A row of the framebuffer
  */
-static volatile struct
+typedef struct
 {
 	uint8_t lat;
-} buffer[COLOUR_DEPTH][16];
+} Row;
+
+/**
+ * @brief The framebuffers for the LEDs
+ * 
+ * Each buffer has a separate plane for each bit of the colour depth. 
+ * Each plane stores the LATC values for each row. 
+ * 
+ * One buffer is shown and written by ledSet(), the other one takes the next
+ * frame of ledShowValues() or ledShowPlanes() until it is swapped in. 
+ */
+static volatile Row buffers[2][COLOUR_DEPTH][16];
+
+/**
+ * @brief The buffer that is shown
+ */
+static volatile Row (*volatile buffer)[16] = buffers[0];
+
+/**
+ * @brief The buffer for the next frame
+ */
+static volatile Row (*volatile backBuffer)[16] = buffers[1];
+
+/**
+ * @brief Set while a frame in backBuffer waits for the next frame boundary
+ */
+static volatile bool framePending = false;
+
+/**
+ * @brief Unscaled values of the LEDs as set by ledSet()
+ */
+static uint8_t values[8][8];
+
+/**
+ * @brief Set while values[] does not describe the LEDs (after ledShowPlanes()
+ * or ledCancelFrame()), so ledSetBrightness() must not redraw them
+ */
+static bool valuesStale = false;
+
+/**
+ * @brief Master brightness (0..255)
+ */
+static uint8_t masterBrightness = 255;
+
+/**
+ * @brief Long-life mode for ledCompensateBattery()
+ */
+static bool longLifeMode = false;
+
+/**
+ * @brief Brightness limit for ledCompensateBattery() (0..255)
+ */
+static uint8_t brightnessLimit = 255;
+
+/**
+ * @brief Sum of the displayed values of all LEDs (see ledLoad())
+ */
+static uint16_t load = 0;
+
+/**
+ * @brief Slow scan rate (see ledSetSlowScan())
+ */
+static bool slowScan = false;
+
+#if TRACE_ENABLED
+/**
+ * @brief Low bits of SMT1 at the last scan interrupt (see timer0Isr())
+ */
+static uint16_t lastScan = 0;
+
+/**
+ * @brief Set once lastScan is valid, cleared by ledOn()
+ */
+static bool scanRunning = false;
+#endif
 
 /**
  * @brief Multiplexing sequence for LEDs
@@ -27,6 +100,11 @@ static volatile struct
 #define SEQUENCE_LENGTH ((1 << COLOUR_DEPTH) - 1)
 static uint8_t planeSequence[SEQUENCE_LENGTH];
 
+/**
+ * @brief Length of the sequence for the current colour depth
+ */
+static uint8_t sequenceLength;
+
 /**
  * @brief The current position in the sequence
  */
@@ -37,26 +115,44 @@ static volatile uint8_t currentSeqPos;
  */
 static volatile uint8_t currentRow;
 
-void ledInit()
+/**
+ * @brief Generates the plane sequence for a colour depth
+ * @param depth The colour depth (1..COLOUR_DEPTH). Only the highest depth
+ * many planes are part of the sequence. 
+ */
+static void generateSequence(uint8_t depth)
 {
-	// Initialise plane sequence
-	// The plane sequence contains plane p (0..COLOUR_DEPTH-1) 2^p times for a
-	// total sequence length of 2^COLOR_DEPTH-1. It needs to be sufficiently
-	// "mixed" to avoid flickering, e.g. for COLOUR_DEPTH=3 we want
+	// The plane sequence contains plane p (0..depth-1) 2^p times for a
+	// total sequence length of 2^depth-1. It needs to be sufficiently
+	// "mixed" to avoid flickering, e.g. for depth 3 we want
 	// (2,1,2,0,2,1,2) rather than (0,1,1,2,2,2,2). 
 	// To generate this, we go through the planes in descending order and insert
-	// each plane p at every k-th place (where k = 2^(COLOUR_DEPTH - 1 - p)),
+	// each plane p at every k-th place (where k = 2^(depth - 1 - p)),
 	// starting at offset k - 1. 
-	for(int p = COLOUR_DEPTH - 1; p >= 0; p--)
+	// For reduced depths, the planes are offset by COLOUR_DEPTH - depth, so the
+	// lowest planes are skipped. 
+	sequenceLength = (uint8_t)((1 << depth) - 1);
+	for(int p = depth - 1; p >= 0; p--)
 	{
-		int k = 1 << (COLOUR_DEPTH - 1 - p);
-		for(int i = k - 1; i < SEQUENCE_LENGTH; i += k)
-			planeSequence[i] = (uint8_t)p;
+		int k = 1 << (depth - 1 - p);
+		for(int i = k - 1; i < sequenceLength; i += k)
+			planeSequence[i] = (uint8_t)(p + COLOUR_DEPTH - depth);
 	}
-	// Initialise buffer
+}
+
+void ledInit()
+{
+	// Initialise plane sequence
+	generateSequence(COLOUR_DEPTH);
+	// Initialise buffers
 	for(uint8_t plane = 0; plane < COLOUR_DEPTH; plane++)
+	{
 		for(uint8_t row = 0; row < 16; row++)
-			buffer[plane][row].lat = (uint8_t)(row << 4);
+		{
+			buffers[0][plane][row].lat = (uint8_t)(row << 4);
+			buffers[1][plane][row].lat = (uint8_t)(row << 4);
+		}
+	}
 	
 	currentSeqPos = 0;
 	currentRow = 0;
@@ -75,8 +171,11 @@ void ledOn(void)
 	T0CON0bits.MD16 = 0; // Operate in 8-bit mode
 	T0CON0bits.OUTPS = 0b0000; // Postscaler 1:1
 	T0CON1bits.CS = 0b010; // Clock Source F_OSC/4 = 16Mhz
-	T0CON1bits.CKPS = 0b0000; // Prescaler 1:1
-	TMR0H = 250; // Compare value (-> 64kHz)
+	T0CON1bits.CKPS = slowScan ? 0b0001 : 0b0000; // Prescaler 1:1 (1:2 for slow scan)
+	TMR0H = 250; // Compare value (-> 64kHz or 32kHz)
+#if TRACE_ENABLED
+	scanRunning = false;
+#endif
 	PIE3bits.TMR0IE = 1; // Enable interrupt on compare match
 	T0CON0bits.EN = 1;
 }
@@ -94,7 +193,13 @@ void ledOff(void)
 	LATC = 0;
 }
 
-void ledSet(uint8_t x, uint8_t y, uint8_t value)
+/**
+ * @brief Writes the value of one LED into the framebuffer
+ * @param x,y Coordinates of the LED (0..7).
+ * @param value The brightness value of the LED (scaled by the master
+ * brightness)
+ */
+static void ledWrite(uint8_t x, uint8_t y, uint8_t value)
 {
 	di();
 	if(x & 4u)
@@ -103,21 +208,199 @@ void ledSet(uint8_t x, uint8_t y, uint8_t value)
 		y |= 8u;
 	}
 	value >>= 8 - COLOUR_DEPTH; // Ignore all but the leftmost COLOUR_DEPTH many bits
+	uint8_t old = 0;
 	for(uint8_t plane = 0; plane < COLOUR_DEPTH; plane++)
 	{
+		uint8_t lat = buffer[plane][y].lat;
+		// Collect the previous value for the load
+		old |= (uint8_t)(((lat >> x) & 1u) << plane);
 		// Extract plane-th last bit from value
 		uint8_t bit = (value >> plane) & 1u;
 		// Write this into the x-th last bit of lat
-		buffer[plane][y].lat = (buffer[plane][y].lat & ~(1 << x)) | (uint8_t)(bit << x);
+		buffer[plane][y].lat = (lat & ~(1 << x)) | (uint8_t)(bit << x);
 	}
+	load += value - old;
 	ei();
 }
 
+void ledSet(uint8_t x, uint8_t y, uint8_t value)
+{
+	values[x][y] = value;
+	ledWrite(x, y, (uint8_t)(((uint16_t)value * (masterBrightness + 1)) >> 8));
+}
+
 void ledSetAll(uint8_t value)
 {
 	for(uint8_t y = 0; y < 8; y++)
 		for(uint8_t x = 0; x < 8; x++)
 			ledSet(x, y, value);
+	valuesStale = false;
+}
+
+/**
+ * @brief Counts the lit LEDs in a row of a plane
+ * @param lat The LATC value of the row (columns are LATC[0:3]). 
+ * @return The number of lit LEDs (0..4). 
+ */
+static uint8_t countLit(uint8_t lat)
+{
+	return (lat & 1u) + ((lat >> 1) & 1u) + ((lat >> 2) & 1u) + ((lat >> 3) & 1u);
+}
+
+void ledDim(void)
+{
+	di();
+	load = 0;
+	for(uint8_t row = 0; row < 16; row++)
+	{
+		// Move each plane down by one, i.e. halve all values
+		for(uint8_t plane = 0; plane < COLOUR_DEPTH - 1; plane++)
+		{
+			uint8_t lat = buffer[plane + 1][row].lat;
+			buffer[plane][row].lat = lat;
+			load += (uint16_t)(countLit(lat) << plane);
+		}
+		// Clear the highest plane
+		buffer[COLOUR_DEPTH - 1][row].lat &= ~0x0fu;
+	}
+	ei();
+}
+
+uint16_t ledLoad(void)
+{
+	return load;
+}
+
+bool ledShowValues(const uint8_t* frame)
+{
+	if(framePending)
+		return false;
+	
+	// Clear the columns of all rows
+	for(uint8_t plane = 0; plane < COLOUR_DEPTH; plane++)
+		for(uint8_t row = 0; row < 16; row++)
+			backBuffer[plane][row].lat = (uint8_t)(row << 4);
+	
+	uint16_t newLoad = 0;
+	for(uint8_t y = 0; y < 8; y++)
+	{
+		for(uint8_t x = 0; x < 8; x++)
+		{
+			uint8_t value = *frame++;
+			values[x][y] = value;
+			value = (uint8_t)(((uint16_t)value * (masterBrightness + 1)) >> 8) >> (8 - COLOUR_DEPTH);
+			newLoad += value;
+			uint8_t row = (x & 4u) ? (y | 8u) : y;
+			uint8_t column = (uint8_t)(1u << (x & 3u));
+			for(uint8_t plane = 0; plane < COLOUR_DEPTH; plane++)
+			{
+				if(value & 1u)
+					backBuffer[plane][row].lat |= column;
+				value >>= 1;
+			}
+		}
+	}
+	load = newLoad;
+	valuesStale = false;
+	framePending = true;
+	return true;
+}
+
+bool ledShowPlanes(const uint8_t* planes)
+{
+	if(framePending)
+		return false;
+	
+	uint16_t newLoad = 0;
+	for(uint8_t plane = 0; plane < COLOUR_DEPTH; plane++)
+	{
+		for(uint8_t row = 0; row < 16; row += 2)
+		{
+			uint8_t columns = *planes++;
+			backBuffer[plane][row].lat = (uint8_t)(row << 4) | (columns & 0x0fu);
+			backBuffer[plane][row + 1].lat = (uint8_t)((row + 1) << 4) | (columns >> 4);
+			newLoad += (uint16_t)((countLit(columns) + countLit(columns >> 4)) << plane);
+		}
+	}
+	load = newLoad;
+	valuesStale = true;
+	framePending = true;
+	return true;
+}
+
+bool ledFramePending(void)
+{
+	return framePending;
+}
+
+void ledCancelFrame(void)
+{
+	di();
+	if(framePending)
+	{
+		framePending = false;
+		valuesStale = true;
+		
+		// The load is that of the frame that is still shown
+		load = 0;
+		for(uint8_t plane = 0; plane < COLOUR_DEPTH; plane++)
+			for(uint8_t row = 0; row < 16; row++)
+				load += (uint16_t)(countLit(buffer[plane][row].lat) << plane);
+	}
+	ei();
+}
+
+void ledSetBrightness(uint8_t brightness)
+{
+	if(brightness == masterBrightness)
+		return;
+	masterBrightness = brightness;
+	
+	// Redraw all LEDs (unless values[] is out of date, the LEDs keep their
+	// brightness until the next ledSetAll() then)
+	if(valuesStale)
+		return;
+	for(uint8_t y = 0; y < 8; y++)
+		for(uint8_t x = 0; x < 8; x++)
+			ledSet(x, y, values[x][y]);
+}
+
+void ledSetLongLife(bool longLife)
+{
+	longLifeMode = longLife;
+}
+
+void ledSetBrightnessLimit(uint8_t limit)
+{
+	brightnessLimit = limit;
+}
+
+void ledSetDepth(uint8_t depth)
+{
+	di();
+	generateSequence(depth);
+	currentSeqPos = 0;
+	ei();
+}
+
+void ledSetSlowScan(bool slow)
+{
+	slowScan = slow;
+	if(T0CON0bits.EN)
+		T0CON1bits.CKPS = slowScan ? 0b0001 : 0b0000;
+}
+
+void ledCompensateBattery(uint16_t millivolts)
+{
+	// LED current is roughly proportional to the voltage across the resistor,
+	// i.e. (V - V_F). Scale brightness by (V_ref - V_F) / (V - V_F). 
+	uint8_t brightness = 255;
+	if(millivolts > LED_REFERENCE_VOLTAGE)
+		brightness = (uint8_t)(255ul * (LED_REFERENCE_VOLTAGE - LED_FORWARD_VOLTAGE) / (millivolts - LED_FORWARD_VOLTAGE));
+	if(longLifeMode)
+		brightness /= 2;
+	brightness = (uint8_t)(((uint16_t)brightness * (brightnessLimit + 1)) >> 8);
+	ledSetBrightness(brightness);
 }
 
 /**
@@ -125,14 +408,45 @@ void ledSetAll(uint8_t value)
  */
 void __interrupt(irq(IRQ_TMR0), high_priority) timer0Isr(void)
 {
+	PERF_BEGIN();
+	
+#if TRACE_ENABLED
+	// Trace interrupts that come late, e.g. while ledSet() has interrupts
+	// disabled or another interrupt is running
+	{
+		uint32_t now;
+		PERF_NOW(now);
+		uint16_t interval = (uint16_t)now - lastScan;
+		uint16_t period = (uint16_t)(TMR0H + 1) << (slowScan ? 1 : 0);
+		lastScan = (uint16_t)now;
+		if(scanRunning && interval > period + TRACE_SCAN_LATE_CYCLES)
+		{
+			uint16_t late = (interval - period) >> 4; // In us
+			TRACE(TRACE_HIGH, TRACE_SCAN_LATE, late > 255 ? 255 : late);
+		}
+		scanRunning = true;
+	}
+#endif
+	
 	// Increment currentRow and - if necessary - currentSeqPos
 	currentRow++;
 	if(currentRow == 16)
 	{
 		currentRow = 0;
 		currentSeqPos++;
-		if(currentSeqPos == SEQUENCE_LENGTH)
+		if(currentSeqPos == sequenceLength)
+		{
 			currentSeqPos = 0;
+			
+			// Frame boundary: swap in the next frame (if any)
+			if(framePending)
+			{
+				volatile Row (*shown)[16] = backBuffer;
+				backBuffer = buffer;
+				buffer = shown;
+				framePending = false;
+			}
+		}
 	}
 
 	// Disable row demux while new column data is applied
@@ -146,4 +460,6 @@ void __interrupt(irq(IRQ_TMR0), high_priority) timer0Isr(void)
 
 	// Clear interrupt
 	TMR0IF = 0;
+	
+	PERF_END(PERF_SCAN);
 }
@@ -7,11 +7,23 @@
  * controlled via the 74HC154 demultiplexer, 4 columns). The rows are on RC[4:7]
  * and the columns on RC[0:3]. RB7 is the demux enable pin (active low).
  * Timer 0 is used for timing the multiplexing. 
+ * 
+ * All values are scaled by a master brightness. It can be derived from the
+ * battery voltage to keep the perceived brightness constant while the battery
+ * drains (the LED current through the resistors falls with the voltage). 
+ * 
+ * To save power on a weak battery, the effective colour depth and the scan
+ * rate can be reduced at runtime. 
+ * 
+ * Whole frames (e.g. streamed over UART) are double-buffered: They are
+ * written to a second framebuffer and swapped in at the next frame boundary,
+ * so they never show half-drawn. 
  */
 
 #ifndef LED_H
 #define	LED_H
 
+#include<stdbool.h>
 #include<stdint.h>
 
 /* 
@@ -39,6 +51,24 @@
  */
 #define COLOUR_DEPTH 6
 
+/**
+ * @brief Typical forward voltage of the LEDs (in mV)
+ */
+#define LED_FORWARD_VOLTAGE 1900
+
+/**
+ * @brief Battery voltage (in mV) at and below which the LEDs are driven at
+ * full brightness by ledCompensateBattery()
+ * @details Above it, the brightness is reduced so the LED current matches the
+ * one at this voltage. 
+ */
+#define LED_REFERENCE_VOLTAGE 2400
+
+/**
+ * @brief Size of a frame for ledShowPlanes() in bytes
+ */
+#define LED_PLANES_SIZE (COLOUR_DEPTH * 8)
+
 /**
  * @brief Initialises the driver
  * 
@@ -76,4 +106,119 @@ void ledSet(uint8_t x, uint8_t y, uint8_t value);
  */
 void ledSetAll(uint8_t value);
 
+/**
+ * @brief Shows a frame of values from the next frame boundary on
+ * @details Like ledSet() for all LEDs, but the frame is swapped in as a
+ * whole. 
+ * @param frame The 64 values, row by row (frame[8 * y + x]). 
+ * @return Returns false if the previous frame has not been swapped in yet
+ * (see ledFramePending()), the frame is not taken then. 
+ */
+bool ledShowValues(const uint8_t* frame);
+
+/**
+ * @brief Shows a frame of pre-encoded bit planes from the next frame boundary
+ * on
+ * @details The planes are copied into the framebuffer as they are, so there is
+ * nothing to decode. Plane p (0 = least significant bit) starts at
+ * planes[8 * p], each byte holds the columns of two rows (see the positions of
+ * the LEDs above): bits 0..3 for row 2 * i, bits 4..7 for row 2 * i + 1. The
+ * master brightness is not applied, so planes bypass the battery compensation
+ * and the brightness limit. Changes of the master brightness don't redraw the
+ * LEDs until the next ledSetAll() or ledShowValues(). 
+ * @param planes The LED_PLANES_SIZE bytes of the planes. 
+ * @return Returns false if the previous frame has not been swapped in yet
+ * (see ledFramePending()), the frame is not taken then. 
+ */
+bool ledShowPlanes(const uint8_t* planes);
+
+/**
+ * @brief Checks whether a frame waits for the next frame boundary
+ * @return Returns true until the last frame of ledShowValues() or
+ * ledShowPlanes() is shown. 
+ */
+bool ledFramePending(void);
+
+/**
+ * @brief Drops the frame that waits for the next frame boundary (if any)
+ * @details The LEDs keep showing the current frame, so ledSet() draws on top
+ * of it. Like after ledShowPlanes(), changes of the master brightness don't
+ * redraw the LEDs until the next ledSetAll(). Must be called before another program draws with ledSet(), otherwise
+ * the pending frame would replace its drawing at the next frame boundary. 
+ */
+void ledCancelFrame(void);
+
+/**
+ * @brief Halves the brightness of all LEDs
+ * @details The framebuffer is shifted down by one plane, so after COLOUR_DEPTH
+ * calls all LEDs are off. The values set by ledSet()
+ * are kept, a change of the master brightness restores them. Used for fading
+ * out. 
+ */
+void ledDim(void);
+
+/**
+ * @brief Sets the master brightness
+ * @details All values set by ledSet() are scaled by this. Changing it redraws
+ * all LEDs, except after ledShowPlanes() or ledCancelFrame() (see there). 
+ * @param brightness The brightness (0..255, 255 is full brightness)
+ */
+void ledSetBrightness(uint8_t brightness);
+
+/**
+ * @brief Returns the load of the LEDs
+ * @details The sum of the displayed values (0..2^COLOUR_DEPTH-1, after the
+ * master brightness) of all LEDs, kept up to date by ledSet() and the
+ * ledShow*() functions. A LED is lit for value / (2^COLOUR_DEPTH-1) of the
+ * time its row is selected (1/16), so the average number of lit LEDs is
+ * load / (16 * (2^COLOUR_DEPTH-1)). A reduced colour depth (ledSetDepth()) is
+ * not taken into account. 
+ * @return The load (0..64 * (2^COLOUR_DEPTH-1)). 
+ */
+uint16_t ledLoad(void);
+
+/**
+ * @brief Selects the long-life setting
+ * @details In long-life mode, ledCompensateBattery() halves the brightness to
+ * stretch the battery life. 
+ * @param longLife True to select long-life mode, false for normal mode. 
+ */
+void ledSetLongLife(bool longLife);
+
+/**
+ * @brief Limits the brightness chosen by ledCompensateBattery()
+ * @details The compensated brightness is scaled by this, on top of the
+ * long-life setting. 
+ * @param limit The limit (0..255, 255 is no limit). 
+ */
+void ledSetBrightnessLimit(uint8_t limit);
+
+/**
+ * @brief Sets the effective colour depth
+ * @details Only the highest depth many bits of each value are shown. This
+ * shortens the multiplexing sequence, so the frame rate goes up (e.g. from
+ * 63Hz to 267Hz for depth 4) which leaves room for ledSetSlowScan(). The
+ * values set by ledSet() are kept at full depth. 
+ * @param depth The colour depth in bits (1..COLOUR_DEPTH).
+ */
+void ledSetDepth(uint8_t depth);
+
+/**
+ * @brief Selects the slow scan rate
+ * @details Halves the rate of the multiplexing interrupt (and thereby the CPU
+ * time spent on it) and the frame rate. Only flicker-free together with a
+ * reduced colour depth (see ledSetDepth()). 
+ * @param slow True for half the scan rate, false for the normal rate.
+ */
+void ledSetSlowScan(bool slow);
+
+/**
+ * @brief Sets the master brightness according to the battery voltage
+ * @details The brightness is chosen such that the LED current stays at what
+ * it would be at LED_REFERENCE_VOLTAGE. Cheap unless the brightness actually
+ * changes, so this may be called frequently. 
+ * @param millivolts The battery voltage (in mV).
+ */
+void ledCompensateBattery(uint16_t millivolts);
+
 #endif // LED_H
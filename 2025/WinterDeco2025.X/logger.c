@@ -0,0 +1,107 @@
+/**
+ * @file logger.c
+ * @date 2026-10-18
+ * @brief Implements logger.h
+ */
+
+#include<xc.h>
+#include<stdarg.h>
+#include<stdio.h>
+#include"logger.h"
+#include"uart.h"
+
+#if LOG_BINARY
+/**
+ * @brief Argument types of the messages
+ */
+static const char* const TYPES[NUM_LOG_MESSAGES] =
+{
+#define LOG_MESSAGE(id, types, format) types,
+	LOG_MESSAGES
+#undef LOG_MESSAGE
+};
+#else
+/**
+ * @brief Formats of the messages
+ */
+static const char* const FORMATS[NUM_LOG_MESSAGES] =
+{
+#define LOG_MESSAGE(id, types, format) format,
+	LOG_MESSAGES
+#undef LOG_MESSAGE
+};
+#endif
+
+void logMessage(LogId id, ...)
+{
+	va_list args;
+	va_start(args, id);
+#if LOG_BINARY
+	uartSend((char)LOG_START);
+	uartSend((char)id);
+	for(const char* type = TYPES[id]; *type; type++)
+	{
+		switch(*type)
+		{
+			case 'b':
+				uartSend((char)va_arg(args, int));
+				break;
+			case 'w':
+			{
+				unsigned int value = va_arg(args, unsigned int);
+				uartSend((char)value);
+				uartSend((char)(value >> 8));
+				break;
+			}
+			case 'l':
+			{
+				unsigned long value = va_arg(args, unsigned long);
+				for(uint8_t i = 0; i < 4; i++)
+				{
+					uartSend((char)value);
+					value >>= 8;
+				}
+				break;
+			}
+			case 's':
+			{
+				const char* string = va_arg(args, const char*);
+				do
+					uartSend(*string);
+				while(*string++);
+				break;
+			}
+		}
+	}
+#else
+	vprintf(FORMATS[id], args);
+#endif
+	va_end(args);
+}
+
+void logBlock(LogId id, const volatile void* data, uint16_t length, UartBlockCallback callback)
+{
+#if LOG_BINARY
+	uartSend((char)LOG_START);
+	uartSend((char)id);
+	uartSend((char)length);
+	uartSend((char)(length >> 8));
+	uartSendBlock(data, length, callback);
+#else
+	// The block takes the place of the %s
+	const volatile uint8_t* bytes = data;
+	for(const char* format = FORMATS[id]; *format; format++)
+	{
+		if(format[0] == '%' && format[1] == 's')
+		{
+			for(uint16_t i = 0; i < length; i++)
+				printf(i ? " %02x" : "%02x", bytes[i]);
+			format++;
+		}
+		else
+			uartSend(*format);
+	}
+	if(callback)
+		callback();
+#endif
+}
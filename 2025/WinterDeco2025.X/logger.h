@@ -0,0 +1,69 @@
+/**
+ * @file logger.h
+ * @date 2026-10-18
+ * @brief Diagnostic messages over UART
+ * 
+ * All messages are listed in logmessages.h. In binary mode, only a compact
+ * record is sent for each message: LOG_START, the message ID and the raw
+ * argument bytes (little endian, strings including the terminating zero). The
+ * format strings don't take up flash and nothing is formatted on the device.
+ * The host decoder (Tools/logdecode.c) turns the records back into text. 
+ * 
+ * In text mode, the messages are formatted with printf() as usual, which is
+ * handy with a plain serial terminal. 
+ * 
+ * Blocks of bytes (e.g. dumps) are sent with logBlock(): In binary mode, the
+ * block goes to the UART by DMA without a copy (see uartSendBlock()). 
+ */
+
+#ifndef LOGGER_H
+#define	LOGGER_H
+
+#include<stdint.h>
+#include"logmessages.h"
+#include"uart.h"
+
+/**
+ * @brief Send binary records (1) or formatted text (0)
+ */
+#define LOG_BINARY 1
+
+/**
+ * @brief First byte of each binary record
+ */
+#define LOG_START 0xa5
+
+/**
+ * @brief IDs of the log messages
+ */
+typedef enum
+{
+#define LOG_MESSAGE(id, types, format) id,
+	LOG_MESSAGES
+#undef LOG_MESSAGE
+	NUM_LOG_MESSAGES
+} LogId;
+
+/**
+ * @brief Sends a log message
+ * @details The arguments must match the types of the message in
+ * logmessages.h. Strings must be in RAM or flash, not longer than 255 bytes. 
+ * @param id The message.
+ * @param ... The arguments.
+ */
+void logMessage(LogId id, ...);
+
+/**
+ * @brief Sends a log message with a block of bytes
+ * @details For messages of type "a". In binary mode, the record is the
+ * length (16 bits) and the bytes as they are. In text mode, the bytes are
+ * printed in hex right away. 
+ * @param id The message.
+ * @param data The bytes in RAM, must stay unchanged until the callback.
+ * @param length Number of bytes.
+ * @param callback Called once the block has been sent (or NULL), see
+ * uartSendBlock(). 
+ */
+void logBlock(LogId id, const volatile void* data, uint16_t length, UartBlockCallback callback);
+
+#endif // LOGGER_H
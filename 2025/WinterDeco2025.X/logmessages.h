@@ -0,0 +1,44 @@
+/**
+ * @file logmessages.h
+ * @date 2026-10-18
+ * @brief List of all log messages (see logger.h)
+ * 
+ * Each entry is LOG_MESSAGE(id, types, format): 
+ * - id: Name of the message, used with logMessage()
+ * - types: One character per argument: 'b' for 8 bits, 'w' for 16 bits (int),
+ *   'l' for 32 bits (long), 's' for a string, 'a' for a block of bytes (only
+ *   argument, sent with logBlock() and printed in hex with %s)
+ * - format: printf() format of the message, only used in text mode and by the
+ *   host decoder (Tools/logdecode.c)
+ * 
+ * New messages must be added at the end, so the IDs of the existing ones stay
+ * the same. 
+ */
+
+#define LOG_MESSAGES \
+	LOG_MESSAGE(LOG_HELLO, "", "\n\n------------------------------\nHappy Winter Season!\n") \
+	LOG_MESSAGE(LOG_BATTERY, "w", "Battery Voltage: %umV\n") \
+	LOG_MESSAGE(LOG_SLEEP, "", "Going to sleep...") \
+	LOG_MESSAGE(LOG_ASLEEP, "", "Zzz\n") \
+	LOG_MESSAGE(LOG_WAKE, "", "Waking up...") \
+	LOG_MESSAGE(LOG_AWAKE, "", "I'm up!\n") \
+	LOG_MESSAGE(LOG_PROGRAM, "s", "Switching to program \"%s\"\n") \
+	LOG_MESSAGE(LOG_NO_INPUT, "w", "No input for %u minutes\n") \
+	LOG_MESSAGE(LOG_AUTOOFF_DISABLED, "", "Auto-off disabled\n") \
+	LOG_MESSAGE(LOG_AUTOOFF, "w", "Auto-off after %u minutes\n") \
+	LOG_MESSAGE(LOG_ENERGY_HEADER, "", "Energy since power-up:\n") \
+	LOG_MESSAGE(LOG_ENERGY, "sllll", "  %-16s %6lus %5lu.%luuAh %5luuA\n") \
+	LOG_MESSAGE(LOG_POWER_LEVEL, "ws", "Battery %umV: Power level \"%s\"\n") \
+	LOG_MESSAGE(LOG_CONSOLE_HELP, "", "Commands: program <n>, battery, energy, perf, trace, brightness <0..255>, longlife <0|1>, timeout <minutes>, sleep, boot\n") \
+	LOG_MESSAGE(LOG_CONSOLE_ERROR, "s", "Invalid command \"%s\"\n") \
+	LOG_MESSAGE(LOG_BRIGHTNESS_LIMIT, "b", "Brightness limit %u\n") \
+	LOG_MESSAGE(LOG_LONG_LIFE, "b", "Long-life mode %u\n") \
+	LOG_MESSAGE(LOG_PROGRAM_UNAVAILABLE, "b", "Program %u is not available\n") \
+	LOG_MESSAGE(LOG_STREAM, "wwww", "Stream: %u frames shown, %u received, %u dropped, %u errors\n") \
+	LOG_MESSAGE(LOG_PERF_HEADER, "", "Cycles since the last report (min, avg, max, count):\n") \
+	LOG_MESSAGE(LOG_PERF, "slllw", "  %-16s %7lu %7lu %7lu %6u\n") \
+	LOG_MESSAGE(LOG_PERF_DISABLED, "", "Performance counters not compiled in (see PERF_ENABLED)\n") \
+	LOG_MESSAGE(LOG_TRACE_DUMP, "l", "Trace at %lu:\n") \
+	LOG_MESSAGE(LOG_TRACE_RECORDS, "a", "Trace records: %s\n") \
+	LOG_MESSAGE(LOG_TRACE_DISABLED, "", "Trace not compiled in (see TRACE_ENABLED)\n") \
+	LOG_MESSAGE(LOG_BOOTLOADER, "", "Starting the bootloader\n")
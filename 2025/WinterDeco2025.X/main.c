@@ -33,7 +33,7 @@
 #pragma config XINST = OFF      // Extended Instruction Set Enable bit (Extended Instruction Set and Indexed Addressing Mode disabled)
 // CONFIG5
 #pragma config WDTCPS = WDTCPS_31// WDT Period selection bits (Divider ratio 1:65536; software control of WDTPS)
-#pragma config WDTE = OFF       // WDT operating mode (WDT Disabled; SWDTEN is ignored)
+#pragma config WDTE = SWDTEN    // WDT operating mode (WDT enabled/disabled by SWDTEN bit)
 // CONFIG6
 #pragma config WDTCWS = WDTCWS_7// WDT Window Select bits (window always open (100%); software control; keyed access not required)
 #pragma config WDTCCS = SC      // WDT input clock selector (Software Control)
@@ -55,39 +55,81 @@
 
 #include<xc.h>
 #include<stdbool.h>
-#include<stdio.h>
+#include<stddef.h>
 #include"uart.h"
+#include"console.h"
+#include"logger.h"
 #include"battery.h"
 #include"led.h"
+#include"power.h"
+#include"autooff.h"
+#include"energy.h"
+#include"perf.h"
+#include"trace.h"
 #include"input.h"
+#include"timebase.h"
 #include"programs.h"
+#include"stream.h"
 
 /**
- * @brief Tick flag for system clock
- * @details Set by the Timer 2 interrupt every 10ms, cleared by main.
+ * @brief Waits until the center button is released
+ * @details The core idles between interrupts (e.g. LED multiplexing) instead
+ * of busy waiting. 
  */
-volatile bool tick = false;
+void waitForRelease(void)
+{
+	CPUDOZEbits.IDLEN = 1; // Idle instead of sleep, peripherals keep running
+	while(!PORTBbits.RB5)
+		SLEEP();
+}
 
 /**
- * @brief Timer 2 interrupt service routine
+ * @brief Flashes a low-battery glyph (an empty battery) three times
  */
-void __interrupt(irq(TMR2), low_priority) timer2Isr(void)
+void showLowBattery(void)
 {
-	// Set tick flag
-	tick = true;
-	// Reset interrupt flag
-	PIR3bits.TMR2IF = 0;
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		ledSetAll(0);
+		for(uint8_t x = 1; x < 7; x++)
+		{
+			ledSet(x, 2, 255);
+			ledSet(x, 6, 255);
+		}
+		for(uint8_t y = 3; y < 6; y++)
+		{
+			ledSet(0, y, 255);
+			ledSet(6, y, 255);
+		}
+		ledSet(7, 4, 255);
+		__delay_ms(500);
+		ledSetAll(0);
+		__delay_ms(500);
+	}
 }
 
 /**
  * @brief Sleeps until the center button is pressed for at least 2s
+ * 
+ * A falling edge on the button wakes the core. While the button is held, the
+ * core sleeps in between checks, woken up by either the watchdog timer
+ * (~128ms) or the button being released. 
  */
 void sleepUntilInput(void)
 {
-	// Turn off system clock
-	T2CONbits.ON = 0;
+	// Turn off system clock and battery monitor
+	TRACE(TRACE_MAIN, TRACE_SLEEP, 0);
+	timebaseStop();
+	batteryStop();
+	streamStop();
+	energyReport();
+#if TRACE_ENABLED
+	traceDump();
+#endif
 
-	// Show "OFF" until the button is released
+	// Show "OFF" until the button is released (instead of a frame that is
+	// still pending)
+	ledCancelFrame();
 	ledSetAll(0);
 	ledSet(0, 3, 255);
 	ledSet(0, 4, 255);
@@ -111,14 +153,14 @@ void sleepUntilInput(void)
 	ledSet(6, 6, 255);
 	ledSet(7, 1, 255);
 	ledSet(7, 4, 255);
-	printf("Going to sleep...");
-	while(!PORTBbits.RB5)
-		__delay_ms(50);
-	printf("Zzz\n");
+	logMessage(LOG_SLEEP);
+	waitForRelease();
+	logMessage(LOG_ASLEEP);
 	uartFlush();
 	
-	// Turn off LED driver
+	// Turn off LED driver and button interrupts
 	ledOff();
+	inputStop();
 
 	// Go to sleep until falling flank on RB5
 	while(1)
@@ -135,23 +177,37 @@ void sleepUntilInput(void)
 		// Zzzz...
 		SLEEP();
 		
-		// Disable & clear pin change interrupt
-		PIE0bits.IOCIE = 0;
+		// Switch pin change interrupt to rising edge to detect release
 		IOCBNbits.IOCBN5 = 0;
+		IOCBPbits.IOCBP5 = 1;		// Positive edge on RB5
 		IOCBFbits.IOCBF5 = 0;
-		ei();
 		
 		// Check RB5 remains low for ~2s
+		// Sleep between checks, waking up on watchdog timeout or release
 		bool pressAborted = false;
-		for(uint8_t i = 0; i < 20; i++)
+		for(uint8_t i = 0; i < 16; i++)
 		{
 			if(PORTBbits.RB5)
 			{
 				pressAborted = true;
 				break;
 			}
-			__delay_ms(100);
+			// Start Watchdog Timer
+			WDTCON0bits.SEN = 1;
+			// Zzzz...
+			// During sleep, the Watchdog causes only wake-up, no reset. 
+			SLEEP();
+			// Disable Watchdog Timer to prevent reset
+			WDTCON0bits.SEN = 0;
+			IOCBFbits.IOCBF5 = 0;
 		}
+		
+		// Disable & clear pin change interrupt
+		PIE0bits.IOCIE = 0;
+		IOCBPbits.IOCBP5 = 0;
+		IOCBFbits.IOCBF5 = 0;
+		ei();
+		
 		if(!pressAborted)
 			// Sensor has been touched for at least 2s in a row
 			break;
@@ -181,14 +237,91 @@ void sleepUntilInput(void)
 	ledSet(7, 5, 255);
 	ledSet(7, 6, 255);
 	ledOn();
-	printf("Waking up...");
-	while(!PORTBbits.RB5)
-		__delay_ms(50);
+	logMessage(LOG_WAKE);
+	waitForRelease();
 	ledSetAll(0x00);
-	printf("I'm up!\n");
+	logMessage(LOG_AWAKE);
 
 	// Turn on system clock
-	T2CONbits.ON = 1;
+	timebaseStart();
+	TRACE(TRACE_MAIN, TRACE_WAKE, 0);
+}
+
+/**
+ * @brief Shows an auto-off setting for 1s
+ * @details One LED in the bottom row is lit per step, all LEDs if the device
+ * is never turned off automatically. 
+ * @param setting The setting (see autoOffNextSetting()).
+ */
+void showAutoOff(uint8_t setting)
+{
+	ledSetAll(setting == 0 ? 255 : 0);
+	for(uint8_t x = 0; x < setting; x++)
+		ledSet(x, 7, 255);
+	__delay_ms(1000);
+	ledSetAll(0);
+}
+
+/**
+ * @brief Fades out all LEDs (takes about 1s)
+ */
+void fadeOut(void)
+{
+	for(uint8_t i = 0; i < COLOUR_DEPTH; i++)
+	{
+		ledDim();
+		__delay_ms(150);
+	}
+}
+
+/**
+ * @brief Checks whether a program may run at the current power level
+ * @param program Index of the program. 
+ * @return Returns true if the program may run. 
+ */
+bool powerAllowsProgram(uint8_t program)
+{
+	return powerLevel() < POWER_LOW_POWER_ONLY || PROGRAMS[program].lowPower;
+}
+
+/**
+ * @brief Finds the next program that may run at the current power level
+ * @param program Index of the current program. 
+ * @param step 1 for the next program, NUM_PROGRAMS - 1 for the previous one. 
+ * @return Returns the index of the next program (the current one if no other
+ * may run). 
+ */
+uint8_t nextProgram(uint8_t program, uint8_t step)
+{
+	uint8_t next = program;
+	do
+		next = (next + step) % NUM_PROGRAMS;
+	while(!powerAllowsProgram(next) && next != program);
+	return next;
+}
+
+/**
+ * @brief Switches to a program
+ * @details Reports the energy used so far, so the programs can be compared,
+ * and charges the new program from now on. Stops receiving frames in case
+ * the stream program was running. Drops a frame that the stream or the
+ * animation program has left pending, so it can't replace the drawing of the
+ * new program. 
+ * @param program Index of the program. 
+ * @return Returns the index of the program. 
+ */
+uint8_t switchProgram(uint8_t program)
+{
+	TRACE(TRACE_MAIN, TRACE_PROGRAM, program);
+	streamStop();
+	// Not part of streamStop(), the animation program leaves frames pending
+	// as well
+	ledCancelFrame();
+	energyReport();
+	energySelect(program);
+	logMessage(LOG_PROGRAM, PROGRAMS[program].name);
+	PROGRAMS[program].initFunction();
+	return program;
 }
 
 /**
@@ -197,15 +330,19 @@ void sleepUntilInput(void)
 void main(void)
 {
 	// Disable unused peripheral modules
-	// Used peripherals: Timer 0, Timer 1, UART 1, ADC, Fixed Voltage Reference
+	// Used peripherals: Timer 0, Timer 2, Timer 4, UART 1, ADC, Fixed Voltage Reference
+	// and SMT 1 (only for the performance counters and the trace, see perf.h)
+	// and DMA 1 (only for blocks sent over UART, see uart.h)
+	// (CRC is only used by the bootloader, see bootloader.h)
 	PMD0bits.CRCMD = 1;
 	PMD0bits.SCANMD = 1;
 	PMD1bits.CM1MD = 1;
 	PMD1bits.ZCDMD = 1;
+#if !PERF_ENABLED && !TRACE_ENABLED
 	PMD1bits.SMT1MD = 1;
+#endif
 	PMD1bits.TMR1MD = 1;
 	PMD1bits.TMR3MD = 1;
-	PMD1bits.TMR4MD = 1;
 	PMD2bits.CCP1MD = 1;
 	PMD2bits.CWG1MD = 1;
 	PMD2bits.DSM1MD = 1;
@@ -219,7 +356,9 @@ void main(void)
 	PMD3bits.PWM1MD = 1;
 	PMD3bits.PWM2MD = 1;
 	PMD3bits.PWM3MD = 1;
+#if !UART_TX_DMA
 	PMD4bits.DMA1MD = 1;
+#endif
 	PMD4bits.DMA2MD = 1;
 	PMD4bits.DMA3MD = 1;
 	PMD4bits.CLC1MD = 1;
@@ -231,32 +370,33 @@ void main(void)
 	PMD5bits.DMA4MD = 1;
 	PMD5bits.OPAMD = 1;
 	
-	// Initialise UART
+	// Initialise WDT
+	WDTCON0bits.SEN = 0;		// Disable WDT for now
+	WDTCON0bits.PS = 0b00111;	// WDT Prescaler: 1:4096 (128ms interval)
+	WDTCON1bits.CS = 0b000;		// WDT clock source. LFINTOSC (31kHz)
+	
+	// Initialise UART and performance counters
 	uartInit();
-	printf("\n\n------------------------------\n");
-	printf("Happy Winter Season!\n");
-	printf("Battery Voltage: %umV\n", batteryVoltage());
+	perfInit();
+	logMessage(LOG_HELLO);
+	logMessage(LOG_BATTERY, batteryVoltage());
 	
-	// Initialise inputs
+	// Initialise inputs and load auto-off timeout
 	inputInit();
+	autoOffInit();
 	
 	// Initialise LEDs
 	ledInit();
 	ledOn();
 	
-	// Initialise Timer 2 (System clock)
-	T2CLKCONbits.CS = 0b0001;	// Clock source: F_OSC/4
-	T2CONbits.CKPS = 0b111;		// Prescaler 1:128
-	T2CONbits.OUTPS = 0b1001;	// Postscaler 1:10
-	T2PR = 125;					// Compare value (16MHz/128/10/125 = 100Hz)
-	PIE3bits.TMR2IE = 1;		// Enable interrupt on compare match
-	T2CONbits.ON = 1;			// Enable Timer 2
+	// Initialise system clock
+	timebaseInit();
 	
 	// Enable interrupts
 	ei();
 	
-	// System clock counter (counts in units of 10ms)
-	uint16_t clk = 0;
+	// System time of the last program update (in ms)
+	uint32_t lastUpdate = 0;
 	// Program that is currently running
 	uint8_t currentProgram = 0;
 	
@@ -266,56 +406,151 @@ void main(void)
 		// Sleep
 		sleepUntilInput();
 		
+		// Refuse to run on an empty battery, it would only brown out
+		powerUpdate(batteryVoltage());
+		if(powerLevel() == POWER_EMPTY)
+		{
+			showLowBattery();
+			continue;
+		}
+		
 		// After wake-up start in Program 0
 		currentProgram = 0;
+		energySelect(currentProgram);
 		PROGRAMS[currentProgram].initFunction();
 		inputInit();
+		consoleInit();
+		autoOffReset();
+		lastUpdate = timebaseNow();
 		
 		// While running, perform the following tasks:
-		// - Monitor buttons for short and long presses
+		// - Collect button events for short and long presses
+		// - Execute commands received over UART
+		// - Turn off after a while without button presses or commands
 		// - Monitor system clock tick flag (100Hz)
-		// - After every tick, call program()
+		// - After every tick, call program() for every button event and once
+		//   more without event
 		while(1)
 		{
-			// Wait for system clock tick
-			while(!tick);
-			tick = false;
-			clk++;
-
-			// Check buttons every 100ms
-			InputEvent events[NUM_BUTTONS];
-			for(uint8_t i = 0; i < NUM_BUTTONS; i++)
-				events[i] = EVENT_NONE;
-			if(clk % 10 == 0)
-				inputUpdate(events);
+			// Wait for system clock tick and calculate the time that has
+			// passed since the last update (more than one tick if we fell
+			// behind)
+			timebaseWaitTick();
+			uint32_t now = timebaseNow();
+			uint16_t dt = (uint16_t)(now - lastUpdate);
+			lastUpdate = now;
+			if(dt > TIMEBASE_TICK)
+				TRACE(TRACE_MAIN, TRACE_TICK_MISSED, dt > 256 * TIMEBASE_TICK ? 255 : dt / TIMEBASE_TICK - 1);
 			
-			// If a long press of BTN_CENTER is detected, exit inner loop
-			// and go to sleep
-			if(events[BTN_CENTER] == EVENT_HOLD_LONG)
-				break;
-			
-			// Let current program do its work
-			PROGRAMS[currentProgram].updateFunction(clk, events);
+			// Keep an eye on the battery and adjust the brightness and the
+			// power level
+			batteryUpdate(dt);
+			ledCompensateBattery(batteryCached());
+			energyUpdate(dt);
+			if(powerUpdate(batteryCached()))
+			{
+				if(powerLevel() == POWER_EMPTY)
+				{
+					showLowBattery();
+					break;
+				}
+				if(!powerAllowsProgram(currentProgram))
+				{
+					currentProgram = switchProgram(nextProgram(currentProgram, 1));
+				}
+			}
 
-			// Process events that were not cleared by the program
-			if(events[BTN_RIGHT] == EVENT_RELEASE_SHORT)
+			// Pass each button event to the current program, then let it do
+			// its regular work
+			InputRecord input;
+			bool sleep = false;
+			while(inputNext(&input))
 			{
-				currentProgram = (currentProgram + 1) % NUM_PROGRAMS;
-				printf("Switching to program \"%s\"\n", PROGRAMS[currentProgram].name);
-				PROGRAMS[currentProgram].initFunction();
+				TRACE(TRACE_MAIN, TRACE_INPUT, input.button << 4 | input.event);
+				autoOffReset();
+				
+				// If a long press of BTN_CENTER is detected, exit inner loop
+				// and go to sleep (unless BTN_LEFT is held as well, see below)
+				if(inputIs(&input, BTN_CENTER, EVENT_HOLD_LONG) && !inputPressed(BTN_LEFT))
+				{
+					sleep = true;
+					break;
+				}
+				
+				// Long press of BTN_LEFT and BTN_CENTER together (hidden):
+				// Change the auto-off timeout
+				if((inputIs(&input, BTN_CENTER, EVENT_HOLD_LONG) && inputPressedLong(BTN_LEFT))
+					|| (inputIs(&input, BTN_LEFT, EVENT_HOLD_LONG) && inputPressedLong(BTN_CENTER)))
+				{
+					showAutoOff(autoOffNextSetting());
+					PROGRAMS[currentProgram].initFunction();
+					continue;
+				}
+				
+				{
+					PERF_BEGIN();
+					PROGRAMS[currentProgram].updateFunction(dt, &input);
+					PERF_END(PERF_PROGRAM + currentProgram);
+				}
+				dt = 0;
+				
+				// Process events that were not cleared by the program
+				if(inputIs(&input, BTN_RIGHT, EVENT_RELEASE_SHORT))
+				{
+					currentProgram = switchProgram(nextProgram(currentProgram, 1));
+				}
+				else if(inputIs(&input, BTN_LEFT, EVENT_RELEASE_SHORT))
+				{
+					currentProgram = switchProgram(nextProgram(currentProgram, NUM_PROGRAMS - 1));
+				}
+				else if(((inputIs(&input, BTN_LEFT, EVENT_HOLD_LONG) && inputPressedLong(BTN_RIGHT))
+					|| (inputIs(&input, BTN_RIGHT, EVENT_HOLD_LONG) && inputPressedLong(BTN_LEFT)))
+					&& powerAllowsProgram(NUM_PROGRAMS))
+				{
+					currentProgram = switchProgram(NUM_PROGRAMS);
+				}
 			}
-			else if(events[BTN_LEFT] == EVENT_RELEASE_SHORT)
+			
+			// Execute commands received over UART, the console passes on
+			// those that concern the main loop
+			ConsoleRequest request;
+			while(!sleep && consoleNext(&request))
 			{
-				currentProgram = (currentProgram + NUM_PROGRAMS - 1) % NUM_PROGRAMS;
-				printf("Switching to program \"%s\"\n", PROGRAMS[currentProgram].name);
-				PROGRAMS[currentProgram].initFunction();
+				autoOffReset();
+				if(request.action == CONSOLE_SLEEP)
+				{
+					sleep = true;
+				}
+				else if(request.action == CONSOLE_BOOT)
+				{
+					// The bootloader stays after a RESET instruction (see
+					// bootloader.h)
+					logMessage(LOG_BOOTLOADER);
+					uartFlush();
+					RESET();
+				}
+				else if(request.action == CONSOLE_PROGRAM)
+				{
+					if(request.program < NUM_ALL_PROGRAMS && powerAllowsProgram(request.program))
+						currentProgram = switchProgram(request.program);
+					else
+						logMessage(LOG_PROGRAM_UNAVAILABLE, request.program);
+				}
 			}
-			else if(events[BTN_LEFT] == EVENT_HOLD_LONG && events[BTN_RIGHT] == EVENT_HOLD_LONG)
+			if(sleep)
+				break;
+			
+			// Fade out and go to sleep if nobody has pressed a button for a
+			// while
+			if(autoOffUpdate(dt))
 			{
-				currentProgram = NUM_PROGRAMS;
-				printf("Starting Tetris\n");
-				PROGRAMS[currentProgram].initFunction();
+				logMessage(LOG_NO_INPUT, autoOffTimeout());
+				fadeOut();
+				break;
 			}
+			PERF_BEGIN();
+			PROGRAMS[currentProgram].updateFunction(dt, NULL);
+			PERF_END(PERF_PROGRAM + currentProgram);
 		}
 	}
 }
@@ -0,0 +1,103 @@
+/**
+ * @file perf.c
+ * @date 2026-10-18
+ * @brief Implements perf.h
+ */
+
+#include<xc.h>
+#include"perf.h"
+#include"trace.h"
+#include"logger.h"
+#include"programs.h"
+
+#if PERF_ENABLED
+
+volatile PerfRecord perfRecords[NUM_PERF_COUNTERS];
+
+/**
+ * @brief Cycles taken by PERF_NOW(), taken off each measurement
+ */
+static uint32_t overhead = 0;
+
+/**
+ * @brief Names of the counters before the programs
+ */
+static const char* const NAMES[PERF_PROGRAM] = {"Scan interrupt", "Tick interrupt", "Input interrupt"};
+
+/**
+ * @brief Resets a counter
+ * @param counter The counter. 
+ */
+static void perfReset(uint8_t counter)
+{
+	perfRecords[counter].min = 0xffffffff;
+	perfRecords[counter].max = 0;
+	perfRecords[counter].sum = 0;
+	perfRecords[counter].count = 0;
+}
+
+#endif
+
+void perfInit(void)
+{
+#if PERF_ENABLED || TRACE_ENABLED
+	// Set up SMT1 as a free-running counter
+	SMT1CLKbits.CSEL = 0b000;	// Clock source: F_OSC/4 (instruction cycles)
+	SMT1CON0bits.PS = 0b00;		// Prescaler 1:1
+	SMT1CON1bits.MODE = 0b0000;	// Timer mode
+	SMT1CON1bits.REPEAT = 1;	// Count continuously
+	SMT1PRU = 0xff;				// Period: Wrap around after 2^24 cycles (~1s)
+	SMT1PRH = 0xff;
+	SMT1PRL = 0xff;
+	SMT1CON0bits.EN = 1;
+	SMT1CON1bits.GO = 1;
+#endif
+	
+#if PERF_ENABLED
+	// Measure the time to read the counter
+	uint32_t start, end;
+	PERF_NOW(start);
+	PERF_NOW(end);
+	overhead = (end - start) & 0xffffffu;
+	
+	for(uint8_t i = 0; i < NUM_PERF_COUNTERS; i++)
+		perfReset(i);
+#endif
+}
+
+#if PERF_ENABLED
+
+void perfReport(void)
+{
+	logMessage(LOG_PERF_HEADER);
+	for(uint8_t i = 0; i < NUM_PERF_COUNTERS; i++)
+	{
+		if(i >= PERF_PROGRAM + NUM_ALL_PROGRAMS)
+			break;
+		
+		// Take a consistent copy, the counters are updated by interrupts
+		di();
+		PerfRecord record = perfRecords[i];
+		perfReset(i);
+		ei();
+		if(record.count == 0)
+			continue;
+		
+		const char* name = i < PERF_PROGRAM ? NAMES[i] : PROGRAMS[i - PERF_PROGRAM].name;
+		uint32_t average = record.sum / record.count;
+		logMessage(LOG_PERF, name,
+			record.min > overhead ? record.min - overhead : 0,
+			average > overhead ? average - overhead : 0,
+			record.max > overhead ? record.max - overhead : 0,
+			record.count);
+	}
+}
+
+#else
+
+void perfReport(void)
+{
+	logMessage(LOG_PERF_DISABLED);
+}
+
+#endif
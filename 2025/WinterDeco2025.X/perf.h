@@ -0,0 +1,139 @@
+/**
+ * @file perf.h
+ * @date 2026-10-18
+ * @brief Cycle counts of interrupts and program updates
+ * 
+ * The signal measurement timer (SMT1) runs as a free-running 24-bit counter
+ * of instruction cycles (16MHz). A section of code is measured by putting it
+ * between PERF_BEGIN() and PERF_END(), which keep the minimum, the average
+ * and the maximum number of cycles per counter. perfReport() sends them over
+ * UART (command "perf" on the console). 
+ * 
+ * The counts are wall-clock cycles: A section that is interrupted includes
+ * the time of the interrupt (e.g. a program update includes the scan
+ * interrupts that occur during it). Interrupt priorities are not enabled
+ * (INTCON0bits.IPEN is 0), so interrupts don't interrupt each other and their
+ * counts are their own. The time to read the counter is taken off. 
+ * 
+ * Measuring costs some 100 cycles per section, which adds up in the scan
+ * interrupt, so it is compiled in only if PERF_ENABLED is 1. SMT1 also
+ * provides the timestamps of the trace (see trace.h). 
+ */
+
+#ifndef PERF_H
+#define	PERF_H
+
+#include<stdint.h>
+
+/**
+ * @brief Compile the measurements in (1) or out (0)
+ */
+#define PERF_ENABLED 0
+
+/**
+ * @brief Maximum number of programs that are measured (at least
+ * NUM_ALL_PROGRAMS)
+ */
+#define PERF_MAX_PROGRAMS 8
+
+/**
+ * @brief Measured sections
+ */
+typedef enum
+{
+	PERF_SCAN,		// LED scan interrupt (led.c)
+	PERF_TICK,		// System clock interrupt (timebase.c)
+	PERF_INPUT,		// Button debounce interrupt (input.c)
+	PERF_PROGRAM,	// updateFunction of program 0, followed by the others
+	NUM_PERF_COUNTERS = PERF_PROGRAM + PERF_MAX_PROGRAMS
+} PerfCounter;
+
+/**
+ * @brief Initialises and starts SMT1
+ * @details Does nothing unless PERF_ENABLED or TRACE_ENABLED. 
+ */
+void perfInit(void);
+
+/**
+ * @brief Reports all counters over UART and resets them
+ * @details Only reports the counters that have measured something since
+ * the last report. 
+ */
+void perfReport(void);
+
+/**
+ * @brief Reads SMT1 into a variable
+ * @details The bytes are read again until the higher ones haven't changed
+ * in between, so this is safe from any context without disabling
+ * interrupts. 
+ */
+#define PERF_NOW(now) do { \
+	uint8_t perfUpper, perfHigh, perfLow; \
+	do \
+	{ \
+		perfUpper = SMT1TMRU; \
+		perfHigh = SMT1TMRH; \
+		perfLow = SMT1TMRL; \
+	} while(perfUpper != SMT1TMRU || perfHigh != SMT1TMRH); \
+	(now) = ((uint32_t)perfUpper << 16) | ((uint16_t)perfHigh << 8) | perfLow; \
+} while(0)
+
+#if PERF_ENABLED
+
+/**
+ * @brief Statistics of a counter
+ * @details Once count would overflow, count and sum are halved, so the
+ * average follows the recent measurements. The sum must not overflow, so
+ * the average must stay below 65536 cycles. 
+ */
+typedef struct
+{
+	uint32_t min;
+	uint32_t max;
+	uint32_t sum;
+	uint16_t count;
+} PerfRecord;
+
+/**
+ * @brief Statistics of all counters (only written by PERF_END())
+ */
+extern volatile PerfRecord perfRecords[NUM_PERF_COUNTERS];
+
+/**
+ * @brief Starts measuring a section
+ * @details Declares a variable, so there can only be one per block. 
+ */
+#define PERF_BEGIN() uint32_t perfStart; PERF_NOW(perfStart)
+
+/**
+ * @brief Stops measuring a section and adds it to a counter
+ * @details A macro rather than a function, so it can be used from both
+ * interrupt levels and the main loop alike. 
+ * @param counter The counter (PerfCounter). 
+ */
+#define PERF_END(counter) do { \
+	uint32_t perfCycles; \
+	PERF_NOW(perfCycles); \
+	perfCycles = (perfCycles - perfStart) & 0xffffffu; \
+	volatile PerfRecord* perfRecord = &perfRecords[counter]; \
+	if(perfCycles < perfRecord->min) \
+		perfRecord->min = perfCycles; \
+	if(perfCycles > perfRecord->max) \
+		perfRecord->max = perfCycles; \
+	if(perfRecord->count == 0xffff) \
+	{ \
+		perfRecord->count = 0x8000; \
+		perfRecord->sum >>= 1; \
+	} \
+	perfRecord->count++; \
+	perfRecord->sum += perfCycles; \
+} while(0)
+
+#else
+
+#define PERF_BEGIN()
+#define PERF_END(counter)
+
+#endif
+
+#endif // PERF_H
@@ -0,0 +1,64 @@
+/**
+ * @file power.c
+ * @date 2026-10-18
+ * @brief Implements power.h
+ */
+
+#include<xc.h>
+#include"led.h"
+#include"logger.h"
+#include"power.h"
+
+const uint16_t POWER_THRESHOLDS[NUM_POWER_LEVELS - 1] =
+{
+	2500,	// POWER_REDUCED_DEPTH
+	2350,	// POWER_SLOW_SCAN
+	2200,	// POWER_LOW_POWER_ONLY
+	2050	// POWER_EMPTY
+};
+
+/**
+ * @brief Names of the levels for the log
+ */
+static const char* const NAMES[NUM_POWER_LEVELS] =
+{
+	"normal",
+	"reduced colour depth",
+	"slow scan",
+	"low-power programs only",
+	"empty"
+};
+
+/**
+ * @brief The current power level
+ */
+static PowerLevel currentLevel = POWER_NORMAL;
+
+PowerLevel powerLevelFor(PowerLevel level, uint16_t millivolts)
+{
+	// Step down while below the threshold of the next level, step up while
+	// the threshold of the current level is exceeded by the hysteresis
+	while(level < POWER_EMPTY && millivolts < POWER_THRESHOLDS[level])
+		level++;
+	while(level > POWER_NORMAL && millivolts >= POWER_THRESHOLDS[level - 1] + POWER_HYSTERESIS)
+		level--;
+	return level;
+}
+
+bool powerUpdate(uint16_t millivolts)
+{
+	PowerLevel level = powerLevelFor(currentLevel, millivolts);
+	if(level == currentLevel)
+		return false;
+	currentLevel = level;
+
+	logMessage(LOG_POWER_LEVEL, millivolts, NAMES[level]);
+	ledSetDepth(level >= POWER_REDUCED_DEPTH ? POWER_DEPTH : COLOUR_DEPTH);
+	ledSetSlowScan(level >= POWER_SLOW_SCAN);
+	return true;
+}
+
+PowerLevel powerLevel(void)
+{
+	return currentLevel;
+}
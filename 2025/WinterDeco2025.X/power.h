@@ -0,0 +1,77 @@
+/**
+ * @file power.h
+ * @date 2026-10-18
+ * @brief Power policy for a draining battery
+ * 
+ * Close to the brown-out voltage, the battery sags under the LED current and
+ * the device resets in the middle of an animation. To avoid this, the policy
+ * steps through progressively cheaper levels as the battery voltage falls
+ * (see PowerLevel). Each level keeps the savings of the levels below it. A
+ * level is left again once the voltage has recovered by POWER_HYSTERESIS. 
+ */
+
+#ifndef POWER_H
+#define	POWER_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/**
+ * @brief Power levels from a good battery to an empty one
+ */
+typedef enum
+{
+	POWER_NORMAL,			// Everything allowed
+	POWER_REDUCED_DEPTH,	// Reduced colour depth (see POWER_DEPTH)
+	POWER_SLOW_SCAN,		// Half the LED scan rate
+	POWER_LOW_POWER_ONLY,	// Only programs marked as lowPower
+	POWER_EMPTY				// Show the low-battery glyph and sleep
+} PowerLevel;
+
+/**
+ * @brief Number of power levels
+ */
+#define NUM_POWER_LEVELS 5
+
+/**
+ * @brief Colour depth from POWER_REDUCED_DEPTH upwards
+ */
+#define POWER_DEPTH 4
+
+/**
+ * @brief Battery voltage (in mV) required to recover from a level, on top of
+ * the voltage at which it was entered
+ */
+#define POWER_HYSTERESIS 100
+
+/**
+ * @brief Battery voltages (in mV) below which the levels are entered
+ * @details Entry i is the threshold of level i + 1. Brown-out is at 1.9V. 
+ */
+extern const uint16_t POWER_THRESHOLDS[NUM_POWER_LEVELS - 1];
+
+/**
+ * @brief Determines the power level for a battery voltage
+ * @details Has no side effects, so the thresholds can be checked on their own. 
+ * @param level The current power level. 
+ * @param millivolts The battery voltage (in mV). 
+ * @return Returns the new power level. 
+ */
+PowerLevel powerLevelFor(PowerLevel level, uint16_t millivolts);
+
+/**
+ * @brief Updates the power level and applies it to the LED driver
+ * @details Logs any change of the level over UART. Cheap unless the level
+ * changes, so this may be called at every tick. 
+ * @param millivolts The battery voltage (in mV). 
+ * @return Returns true if the level has changed. 
+ */
+bool powerUpdate(uint16_t millivolts);
+
+/**
+ * @brief Returns the current power level
+ * @return The power level as of the last call of powerUpdate(). 
+ */
+PowerLevel powerLevel(void);
+
+#endif // POWER_H
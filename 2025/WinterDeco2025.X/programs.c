@@ -7,11 +7,14 @@
 #include<xc.h>
 #include<stdio.h>
 #include"led.h"
+#include"timebase.h"
 #include"programs.h"
+#include"stream.h"
+#include"animation.h"
 
 // Dummy functions that do nothing
 void nullInit() {}
-void nullUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS]) {}
+void nullUpdate(uint16_t dt, InputRecord* input) {}
 
 // VERY simple (and terrible) PRNG
 uint8_t random()
@@ -26,10 +29,11 @@ uint8_t random()
 
 void typewriterInit() {}
 
-void typewriterUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
+void typewriterUpdate(uint16_t dt, InputRecord* input)
 {
 	// Act only every 200ms
-	if(clk % 20 != 0)
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 200))
 		return;
 	
 	static uint8_t page[8][8] =
@@ -84,10 +88,11 @@ void typewriterUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
 
 void matrixInit() {}
 
-void matrixUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
+void matrixUpdate(uint16_t dt, InputRecord* input)
 {
 	// Act only every 100ms
-	if(clk % 10 != 0)
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 100))
 		return;
 	
 	// Store position of flare in each column, 12 if none
@@ -147,17 +152,18 @@ void bouncyInit()
 	bouncyRollVelocity();
 }
 
-void bouncyUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
+void bouncyUpdate(uint16_t dt, InputRecord* input)
 {
 	// When center button was pressed, choose a new random velocity vector
-	if(events[BTN_CENTER] == EVENT_RELEASE_SHORT)
+	if(inputIs(input, BTN_CENTER, EVENT_RELEASE_SHORT))
 	{
 		bouncyRollVelocity();
-		events[BTN_CENTER] = EVENT_NONE;
+		input->event = EVENT_NONE;
 	}
 	
 	// Act only every 50ms
-	if(clk % 5 != 0)
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 50))
 		return;
 	
 	// Move in x direction
@@ -233,7 +239,7 @@ void newyearInit()
 	ledSet(3, 6, 255);
 }
 
-void newyearUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
+void newyearUpdate(uint16_t dt, InputRecord* input)
 {
 	static const uint8_t BITMAP[15][4] =
 	{
@@ -254,12 +260,17 @@ void newyearUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
 		{  0,   0,   0,   0}
 	};
 
+	// Position within the 2.56s animation cycle (in ms)
+	static uint16_t cycle = 0;
+	cycle = (cycle + dt) % 2560;
+
 	// Act only every 100ms
-	if(clk % 10 != 0)
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 100))
 		return;
 	
 	uint8_t yOff;
-	uint8_t phase = (uint8_t)clk;
+	uint8_t phase = (uint8_t)(cycle / 10);
 	if(phase > 127) phase = 255 - phase;
 	if(phase <= 32) yOff = 0;
 	else if(phase > 96) yOff = 7;
@@ -296,9 +307,11 @@ void snakeInit()
 	snakeDirection = SNAKE_RIGHT;
 }
 
-void snakeUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
+void snakeUpdate(uint16_t dt, InputRecord* input)
 {
-	if(clk % 10 != 0)
+	// Act only every 100ms
+	static uint16_t elapsed = 0;
+	if(!timebaseElapsed(&elapsed, dt, 100))
 		return;
 	
 	// Choose a direction for the next move
@@ -616,15 +629,21 @@ enum
 	TETRIS_END
 } tetrisState;
 
-// Countdown timer for current game state
+// Countdown timer for current game state (in ms)
 // When the countdown reaches zero, the state might change
-uint8_t tetrisCountdown;
+uint16_t tetrisCountdown;
+
+// Delays (in ms)
+static const uint16_t TETRIS_DELAY_FALL = 500;
+static const uint16_t TETRIS_DELAY_COLLAPSE = 1100;
+static const uint16_t TETRIS_DELAY_COLLAPSE_BLINK = 200;
+static const uint16_t TETRIS_DELAY_END = 1000;
 
-// Delays (in multiples of 10ms)
-static const uint8_t TETRIS_DELAY_FALL = 50;
-static const uint8_t TETRIS_DELAY_COLLAPSE = 101;
-static const uint8_t TETRIS_DELAY_COLLAPSE_BLINK = 20;
-static const uint8_t TETRIS_DELAY_END = 100;
+// Advance the countdown timer by dt, stopping at zero
+void tetrisCountDown(uint16_t dt)
+{
+	tetrisCountdown = tetrisCountdown > dt ? tetrisCountdown - dt : 0;
+}
 
 
 // Contents of the playing field
@@ -661,14 +680,14 @@ void tetrisInit()
 	tetrominoDraw(tetrominoType, tetrominoRotation, tetrominoX, tetrominoY, true);
 }
 
-void tetrisUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
+void tetrisUpdate(uint16_t dt, InputRecord* input)
 {
 	switch(tetrisState)
 	{
 		case TETRIS_FALLING:
 		{
 			// Check for user input
-			if(events[BTN_LEFT] == EVENT_PRESS)
+			if(inputIs(input, BTN_LEFT, EVENT_PRESS))
 			{
 				// Check if move to the left is possible
 				if(!tetrominoCollides(tetrominoType, tetrominoRotation, tetrisField, tetrominoX - 1, tetrominoY))
@@ -679,7 +698,7 @@ void tetrisUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
 					tetrominoDraw(tetrominoType, tetrominoRotation, tetrominoX, tetrominoY, true);
 				}
 			}
-			if(events[BTN_RIGHT] == EVENT_PRESS)
+			if(inputIs(input, BTN_RIGHT, EVENT_PRESS))
 			{
 				// Check if move to the right is possible
 				if(!tetrominoCollides(tetrominoType, tetrominoRotation, tetrisField, tetrominoX + 1, tetrominoY))
@@ -690,7 +709,7 @@ void tetrisUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
 					tetrominoDraw(tetrominoType, tetrominoRotation, tetrominoX, tetrominoY, true);
 				}
 			}
-			if(events[BTN_CENTER] == EVENT_PRESS)
+			if(inputIs(input, BTN_CENTER, EVENT_PRESS))
 			{
 				// Check if a rotation is possible
 				TetrominoRotation newRotation = (tetrominoRotation + 1) % NUM_ROTATIONS;
@@ -719,13 +738,13 @@ void tetrisUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
 					tetrominoX++;
 					tetrominoDraw(tetrominoType, tetrominoRotation, tetrominoX, tetrominoY, true);
 				}
-				events[BTN_CENTER] = EVENT_NONE;
+				input->event = EVENT_NONE;
 			}
 			
 			// Is there anything else to do?
 			if(tetrisCountdown > 0)
 			{
-				tetrisCountdown--;
+				tetrisCountDown(dt);
 				break;
 			}
 			
@@ -772,12 +791,13 @@ void tetrisUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
 		{
 			if(tetrisCountdown > 0)
 			{
-				tetrisCountdown--;
+				uint8_t blink = (uint8_t)(tetrisCountdown / TETRIS_DELAY_COLLAPSE_BLINK);
+				tetrisCountDown(dt);
 			
 				// Blink collapsing rows
-				if(tetrisCountdown % TETRIS_DELAY_COLLAPSE_BLINK == 0)
+				if(tetrisCountdown / TETRIS_DELAY_COLLAPSE_BLINK != blink)
 				{
-					uint8_t color = tetrisCountdown % (2 * TETRIS_DELAY_COLLAPSE_BLINK) == 0 ? 255 : 0;
+					uint8_t color = blink % 2 == 0 ? 255 : 0;
 					for(uint8_t row = 0; row < 8; row++)
 					{
 						if(tetrisRowCollapse(tetrisField, row))
@@ -824,15 +844,14 @@ void tetrisUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
 		{
 			// Short delay just in case the user had buttons pressed right before losing
 			if(tetrisCountdown > 0)
-				tetrisCountdown--;
+				tetrisCountDown(dt);
 			else
 			{
 				// Any button goes back to normal operation
-				if(events[BTN_LEFT] != EVENT_NONE || events[BTN_CENTER] != EVENT_NONE || events[BTN_RIGHT] != EVENT_NONE)
+				if(input && input->event != EVENT_NONE)
 				{
-					events[BTN_LEFT] = EVENT_NONE;
-					events[BTN_RIGHT] = EVENT_RELEASE_SHORT;
-					events[BTN_CENTER] = EVENT_NONE;
+					input->button = BTN_RIGHT;
+					input->event = EVENT_RELEASE_SHORT;
 					return;
 				}
 			}
@@ -842,7 +861,8 @@ void tetrisUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS])
 	
 	// Clear events on left and right button so main loop won't cycle to other
 	// programs.
-	events[BTN_LEFT] = events[BTN_RIGHT] = EVENT_NONE;
+	if(input && (input->button == BTN_LEFT || input->button == BTN_RIGHT))
+		input->event = EVENT_NONE;
 }
 
 //-----------------------------------------------------------------------------
@@ -857,7 +877,7 @@ void testInit()
 			ledSet(x, y, (y * 8 + x) * 4);
 }
 
-void testUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS]) {}
+void testUpdate(uint16_t dt, InputRecord* input) {}
 
 //-----------------------------------------------------------------------------
 
@@ -865,14 +885,19 @@ void testUpdate(uint16_t clk, InputEvent events[NUM_BUTTONS]) {}
  * @brief Array containing all implemented programs
  */
 const Program PROGRAMS[] = {
-	{"Typewriter", typewriterInit, typewriterUpdate},
-	{"Matrix", matrixInit, matrixUpdate},
-	{"Bouncy", bouncyInit, bouncyUpdate},
-	{"Happy New Year", newyearInit, newyearUpdate},
-	{"Snake", snakeInit, snakeUpdate},
-	{"Tetris", tetrisInit, tetrisUpdate}
+	{"Typewriter", typewriterInit, typewriterUpdate, false},
+	{"Matrix", matrixInit, matrixUpdate, true},
+	{"Bouncy", bouncyInit, bouncyUpdate, false},
+	{"Happy New Year", newyearInit, newyearUpdate, false},
+	{"Snake", snakeInit, snakeUpdate, true},
+	{"Tetris", tetrisInit, tetrisUpdate, false},
+	{"Stream", streamInit, streamUpdate, false},
+	{"Animation", animationInit, animationUpdate, false}
 };
 
 // Number of available programs to cycle through
-// (Tetris doesn't count as a normal program)
-const uint8_t NUM_PROGRAMS = (sizeof(PROGRAMS) / sizeof(Program)) - 1;
\ No newline at end of file
+// (Tetris, Stream and Animation don't count as normal programs)
+const uint8_t NUM_PROGRAMS = (sizeof(PROGRAMS) / sizeof(Program)) - 3;
+
+// Number of all programs including the hidden ones
+const uint8_t NUM_ALL_PROGRAMS = sizeof(PROGRAMS) / sizeof(Program);
\ No newline at end of file
@@ -7,6 +7,8 @@
 #ifndef PROGRAMS_H
 #define	PROGRAMS_H
 
+#include<stdbool.h>
+#include<stdint.h>
 #include"input.h"
 
 /**
@@ -19,13 +21,18 @@ typedef struct
 	/// Initialisation function called at the start of a program
 	/// If no initialisation is needed, this can be null.
 	void (*initFunction)(void);
-	/// Update function called at 10ms intervals
+	/// Update function called at every system clock tick (10ms) and for
+	/// every input event
 	/// If no updating is needed, this can be null. 
-	/// First parameter is the system clock. 
-	/// Second parameter are the input events. A program may process and clear
-	/// them (by assigning EVENT_NONE) or ignore them in which case the main
-	/// function might process them. 
-    void (*updateFunction)(uint16_t, InputEvent[NUM_BUTTONS]);
+	/// First parameter is the time since the last call in milliseconds. 
+	/// Second parameter is the input event or null (at the tick after all
+	/// events have been passed). A program may process and clear it (by
+	/// assigning EVENT_NONE) or ignore it in which case the main function
+	/// might process it. 
+    void (*updateFunction)(uint16_t, InputRecord*);
+	/// True if the program is cheap enough to run on a weak battery (few
+	/// LEDs lit, little computation)
+	bool lowPower;
 } Program;
 
 
@@ -34,6 +41,13 @@ typedef struct
  */
 extern const uint8_t NUM_PROGRAMS;
 
+/**
+ * @brief Number of programs including the hidden ones
+ * @details The hidden programs follow the normal ones: Tetris (index
+ * NUM_PROGRAMS), Stream (see stream.h) and Animation (see animation.h). 
+ */
+extern const uint8_t NUM_ALL_PROGRAMS;
+
 /**
  * @brief Array containing all implemented programs
  */
@@ -0,0 +1,205 @@
+/**
+ * @file stream.c
+ * @date 2026-10-18
+ * @brief Implements stream.h
+ */
+
+#include<xc.h>
+#include<stdbool.h>
+#include<stddef.h>
+#include"stream.h"
+#include"led.h"
+#include"uart.h"
+#include"autooff.h"
+#include"logger.h"
+
+/**
+ * @brief Maximum size of a payload
+ */
+#define MAX_PAYLOAD (STREAM_VALUES_SIZE > LED_PLANES_SIZE ? STREAM_VALUES_SIZE : LED_PLANES_SIZE)
+
+/**
+ * @brief Index of no packet
+ */
+#define NO_PACKET 0xff
+
+/**
+ * @brief States of the packet parser
+ */
+typedef enum
+{
+	WAIT_START, WAIT_TYPE, PAYLOAD, CHECKSUM1, CHECKSUM2
+} ParserState;
+
+/**
+ * @brief Received packets
+ * @details One is being received by the interrupt while the other one may be
+ * waiting to be shown. 
+ */
+static uint8_t packets[2][MAX_PAYLOAD];
+
+/**
+ * @brief Types of the packets
+ */
+static uint8_t types[2];
+
+/**
+ * @brief Index of the packet being received
+ */
+static uint8_t receiving = 0;
+
+/**
+ * @brief Index of the packet waiting to be shown (or NO_PACKET)
+ * @details Set by the interrupt, cleared by streamUpdate() once the packet
+ * has been shown. 
+ */
+static volatile uint8_t ready = NO_PACKET;
+
+/**
+ * @brief State of the parser
+ */
+static ParserState state = WAIT_START;
+
+/**
+ * @brief Number of payload bytes received and expected
+ */
+static uint8_t position, size;
+
+/**
+ * @brief Running Fletcher-16 sums
+ */
+static uint8_t sum1, sum2;
+
+/**
+ * @brief Set if the first checksum byte was wrong
+ */
+static bool corrupt;
+
+/**
+ * @brief Set while the program is running
+ */
+static bool running = false;
+
+/**
+ * @brief Statistics since streamInit()
+ */
+static volatile uint16_t received, dropped, errors;
+static uint16_t shown;
+
+/**
+ * @brief Adds a byte to the Fletcher-16 sums
+ */
+static void addToChecksum(uint8_t byte)
+{
+	uint16_t sum = (uint16_t)sum1 + byte;
+	if(sum >= 255)
+		sum -= 255;
+	sum1 = (uint8_t)sum;
+	sum = (uint16_t)sum2 + sum1;
+	if(sum >= 255)
+		sum -= 255;
+	sum2 = (uint8_t)sum;
+}
+
+/**
+ * @brief Parses the received bytes (receive handler)
+ * @param c The received byte. 
+ * @return Returns false for bytes outside of packets. 
+ */
+static bool receiveByte(char c)
+{
+	uint8_t byte = (uint8_t)c;
+	switch(state)
+	{
+		case WAIT_START:
+			if(byte != STREAM_START)
+				return false;
+			state = WAIT_TYPE;
+			break;
+		case WAIT_TYPE:
+			if(byte == STREAM_VALUES)
+				size = STREAM_VALUES_SIZE;
+			else if(byte == STREAM_PLANES)
+				size = LED_PLANES_SIZE;
+			else
+			{
+				errors++;
+				state = WAIT_START;
+				break;
+			}
+			types[receiving] = byte;
+			sum1 = 0;
+			sum2 = 0;
+			addToChecksum(byte);
+			position = 0;
+			state = PAYLOAD;
+			break;
+		case PAYLOAD:
+			packets[receiving][position++] = byte;
+			addToChecksum(byte);
+			if(position == size)
+				state = CHECKSUM1;
+			break;
+		case CHECKSUM1:
+			corrupt = byte != sum1;
+			state = CHECKSUM2;
+			break;
+		case CHECKSUM2:
+			state = WAIT_START;
+			if(corrupt || byte != sum2)
+			{
+				errors++;
+				break;
+			}
+			received++;
+			// Hand the packet over unless the last one is still waiting,
+			// receive the next one into the other buffer
+			if(ready != NO_PACKET)
+			{
+				dropped++;
+				break;
+			}
+			ready = receiving;
+			receiving ^= 1;
+			break;
+	}
+	return true;
+}
+
+void streamInit(void)
+{
+	ledSetAll(0);
+	received = 0;
+	dropped = 0;
+	errors = 0;
+	shown = 0;
+	state = WAIT_START;
+	ready = NO_PACKET;
+	running = true;
+	uartSetReceiveHandler(receiveByte);
+}
+
+void streamUpdate(uint16_t dt, InputRecord* input)
+{
+	uint8_t packet = ready;
+	if(packet == NO_PACKET || ledFramePending())
+		return;
+	if(types[packet] == STREAM_VALUES)
+		ledShowValues(packets[packet]);
+	else
+		ledShowPlanes(packets[packet]);
+	ready = NO_PACKET;
+	shown++;
+	
+	// Keep the device on while frames arrive
+	autoOffReset();
+}
+
+void streamStop(void)
+{
+	if(!running)
+		return;
+	uartSetReceiveHandler(NULL);
+	running = false;
+	logMessage(LOG_STREAM, shown, received, dropped, errors);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file stream.h
+ * @date 2026-10-18
+ * @brief Program that shows frames streamed over UART
+ * 
+ * For trying out animations on the device without reflashing it. Each frame
+ * is sent as a packet: 
+ * - STREAM_START
+ * - The type: STREAM_VALUES or STREAM_PLANES
+ * - The payload: 64 values, row by row (see ledShowValues()), or
+ *   LED_PLANES_SIZE bytes of pre-encoded bit planes (see ledShowPlanes())
+ * - The Fletcher-16 checksum of the type and the payload: first the sum of
+ *   the bytes, then the sum of the sums (both modulo 255)
+ * 
+ * The packets are parsed by the receive interrupt, so they can arrive back to
+ * back at the full baud rate (about 370 packets per second with planes). A
+ * complete packet is shown at the next tick and swapped in at the next frame
+ * boundary of the LED driver. The frame rate is thus limited by the scan (63Hz
+ * at the full colour depth) or the tick (100Hz). Packets that arrive while
+ * another one still waits to be shown are dropped. 
+ * 
+ * Bytes outside of packets are passed on to the command console, so the
+ * program can be left with "program <n>" in between frames. 
+ * Tools/streamsend.c is the sender for the PC. 
+ */
+
+#ifndef STREAM_H
+#define	STREAM_H
+
+#include<stdint.h>
+#include"input.h"
+
+/**
+ * @brief First byte of each packet
+ * @details Not a printable character, so it doesn't occur in commands. 
+ */
+#define STREAM_START 0xfe
+
+/**
+ * @brief Packet type of 64 values
+ */
+#define STREAM_VALUES 'V'
+
+/**
+ * @brief Packet type of pre-encoded bit planes
+ */
+#define STREAM_PLANES 'P'
+
+/**
+ * @brief Size of the payload of STREAM_VALUES packets
+ */
+#define STREAM_VALUES_SIZE 64
+
+/**
+ * @brief Starts receiving frames
+ * @details The initFunction of the program. 
+ */
+void streamInit(void);
+
+/**
+ * @brief Shows the last frame received
+ * @details The updateFunction of the program. 
+ * @param dt Time since the last call (in ms). 
+ * @param input The input event or NULL. 
+ */
+void streamUpdate(uint16_t dt, InputRecord* input);
+
+/**
+ * @brief Stops receiving frames
+ * @details Must be called when the program is left. Logs the number of
+ * frames received. Does nothing unless the program is running. 
+ */
+void streamStop(void);
+
+#endif // STREAM_H
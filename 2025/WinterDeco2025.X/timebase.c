@@ -0,0 +1,96 @@
+/**
+ * @file timebase.c
+ * @date 2026-10-18
+ * @brief Implements timebase.h
+ */
+
+#include<xc.h>
+#include"timebase.h"
+#include"perf.h"
+#include"trace.h"
+
+/**
+ * @brief Millisecond counter
+ * @details Incremented by the Timer 2 interrupt. 
+ */
+static volatile uint32_t millis = 0;
+
+/**
+ * @brief Tick flag
+ * @details Set by the Timer 2 interrupt every tick, cleared by
+ * timebaseWaitTick().
+ */
+static volatile bool tick = false;
+
+void timebaseInit(void)
+{
+	// Initialise Timer 2 (System clock)
+	T2CLKCONbits.CS = 0b0001;	// Clock source: F_OSC/4
+	T2CONbits.CKPS = 0b111;		// Prescaler 1:128
+	T2CONbits.OUTPS = 0b1001;	// Postscaler 1:10
+	T2PR = 125;					// Compare value (16MHz/128/10/125 = 100Hz)
+	PIE3bits.TMR2IE = 1;		// Enable interrupt on compare match
+	T2CONbits.ON = 1;			// Enable Timer 2
+}
+
+void timebaseStart(void)
+{
+	tick = false;
+	T2CONbits.ON = 1;
+}
+
+void timebaseStop(void)
+{
+	T2CONbits.ON = 0;
+}
+
+uint32_t timebaseNow(void)
+{
+	// The counter is updated by the ISR byte by byte, so read it until two
+	// consecutive copies agree instead of disabling interrupts
+	uint32_t now;
+	do
+		now = millis;
+	while(now != millis);
+	return now;
+}
+
+void timebaseWaitTick(void)
+{
+	while(!tick);
+	tick = false;
+}
+
+bool timebaseElapsed(uint16_t* elapsed, uint16_t dt, uint16_t period)
+{
+	if(dt >= period)
+	{
+		// A whole period (or more) has passed, drop any missed ones
+		*elapsed = 0;
+		return true;
+	}
+	if(*elapsed >= period - dt)
+	{
+		// Keep the remainder so the action stays in phase
+		*elapsed -= period - dt;
+		return true;
+	}
+	*elapsed += dt;
+	return false;
+}
+
+/**
+ * @brief Timer 2 interrupt service routine
+ */
+void __interrupt(irq(TMR2), low_priority) timer2Isr(void)
+{
+	PERF_BEGIN();
+	TRACE(TRACE_LOW, TRACE_TICK_ENTER, 0);
+	// Advance system time and set tick flag
+	millis += TIMEBASE_TICK;
+	tick = true;
+	// Reset interrupt flag
+	PIR3bits.TMR2IF = 0;
+	TRACE(TRACE_LOW, TRACE_TICK_EXIT, 0);
+	PERF_END(PERF_TICK);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file timebase.h
+ * @date 2026-10-18
+ * @brief Monotonic system time
+ * 
+ * Timer 2 generates a tick every 10ms. The ticks are accumulated into a 32-bit
+ * millisecond counter which only wraps after ~49 days. Time does not advance
+ * while the timebase is stopped (e.g. during sleep). 
+ */
+
+#ifndef TIMEBASE_H
+#define	TIMEBASE_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/**
+ * @brief Period of the system clock tick in milliseconds
+ */
+#define TIMEBASE_TICK 10
+
+/**
+ * @brief Initialises and starts the timebase
+ * @details Interrupts must be enabled globally separately. 
+ */
+void timebaseInit(void);
+
+/**
+ * @brief Starts (or resumes) the timebase
+ */
+void timebaseStart(void);
+
+/**
+ * @brief Stops the timebase
+ * @details The millisecond counter keeps its value and continues from there
+ * when timebaseStart() is called. 
+ */
+void timebaseStop(void);
+
+/**
+ * @brief Gets the current system time
+ * @details The value is read atomically, so it is safe to call this while the
+ * timer interrupt is active. 
+ * @return Milliseconds the timebase has been running for. 
+ */
+uint32_t timebaseNow(void);
+
+/**
+ * @brief Waits for the next system clock tick
+ * @details Returns immediately if a tick has occurred since the last call. 
+ */
+void timebaseWaitTick(void);
+
+/**
+ * @brief Checks whether a periodic action is due
+ * @details Accumulates elapsed time until a full period has passed. If the
+ * caller has fallen behind by more than one period, the missed periods are
+ * dropped rather than reported in a burst. 
+ * @param elapsed Accumulator for the time since the action was last due. 
+ * @param dt Time elapsed since the last call in milliseconds. 
+ * @param period Period of the action in milliseconds. 
+ * @return True if the action is due, false otherwise. 
+ */
+bool timebaseElapsed(uint16_t* elapsed, uint16_t dt, uint16_t period);
+
+#endif // TIMEBASE_H
@@ -0,0 +1,81 @@
+/**
+ * @file trace.c
+ * @date 2026-10-18
+ * @brief Implements trace.h
+ */
+
+#include<xc.h>
+#include"trace.h"
+#include"logger.h"
+
+#if TRACE_ENABLED
+
+volatile TraceRecord traceRecords[NUM_TRACE_RINGS][TRACE_SIZE];
+volatile uint8_t traceHeads[NUM_TRACE_RINGS];
+volatile bool traceFrozen = false;
+
+/**
+ * @brief Reverses the order of records in a ring
+ * @param records The ring.
+ * @param first The first record.
+ * @param last The record after the last one.
+ */
+static void reverseRecords(volatile TraceRecord* records, uint8_t first, uint8_t last)
+{
+	while(first + 1 < last)
+	{
+		TraceRecord record = records[first];
+		records[first++] = records[--last];
+		records[last] = record;
+	}
+}
+
+/**
+ * @brief Clears the records once they have been sent
+ * @details Called from the DMA interrupt (see uartSendBlock()). 
+ */
+static void traceDumped(void)
+{
+	for(uint8_t ring = 0; ring < NUM_TRACE_RINGS; ring++)
+	{
+		for(uint8_t i = 0; i < TRACE_SIZE; i++)
+			traceRecords[ring][i].event = TRACE_NONE;
+		traceHeads[ring] = 0;
+	}
+	traceFrozen = false;
+}
+
+void traceDump(void)
+{
+	// A dump is still being sent
+	if(traceFrozen)
+		return;
+	
+	// Once set, no record is taken: An interrupt that was taking one when
+	// this was called has finished by now
+	traceFrozen = true;
+	
+	uint32_t now;
+	PERF_NOW(now);
+	logMessage(LOG_TRACE_DUMP, now);
+	
+	// Rotate each ring so it starts with the oldest record, then send all of
+	// them in one block
+	for(uint8_t ring = 0; ring < NUM_TRACE_RINGS; ring++)
+	{
+		uint8_t head = traceHeads[ring];
+		reverseRecords(traceRecords[ring], 0, head);
+		reverseRecords(traceRecords[ring], head, TRACE_SIZE);
+		reverseRecords(traceRecords[ring], 0, TRACE_SIZE);
+	}
+	logBlock(LOG_TRACE_RECORDS, traceRecords, sizeof(traceRecords), traceDumped);
+}
+
+#else
+
+void traceDump(void)
+{
+	logMessage(LOG_TRACE_DISABLED);
+}
+
+#endif
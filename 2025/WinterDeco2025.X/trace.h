@@ -0,0 +1,157 @@
+/**
+ * @file trace.h
+ * @date 2026-10-18
+ * @brief Trace of events in RAM for finding timing problems
+ * 
+ * printf() takes too long to find problems like missed ticks, late LED scan
+ * interrupts or bouncing buttons, it changes the timing itself. Instead,
+ * TRACE() puts a compact record (event, argument, time in cycles of SMT1, see
+ * perf.h) into a ring buffer in RAM, which takes a few microseconds. The
+ * buffers are dumped over UART on request (command "trace" on the console)
+ * and before sleep. They are sent by DMA as they are (see logBlock()), so a
+ * dump doesn't hold up the main loop. Tools/traceview.c renders a dump (as
+ * decoded by Tools/logdecode.c) as a timeline. 
+ * 
+ * There is a ring buffer for each context (TraceRing): The LED scan
+ * interrupt, the other interrupts and the main loop. Interrupt priorities are
+ * not enabled, so all interrupts run at the same level and don't interrupt
+ * each other (the high_priority and low_priority of the handlers only select
+ * how the compiler saves the context). Each buffer is only written from its
+ * own context, so writing needs no locking. A frequent context also can't push
+ * the events of the others out. The newest TRACE_SIZE records of each context
+ * are kept. 
+ * 
+ * The timestamps wrap around after 2^24 cycles (about 1s). Gaps of more than
+ * that between the records of one context appear shorter on the timeline. 
+ */
+
+#ifndef TRACE_H
+#define	TRACE_H
+
+#include<stdbool.h>
+#include<stdint.h>
+#include"perf.h"
+
+/**
+ * @brief Compile the trace in (1) or out (0)
+ * @details Costs TRACE_SIZE * 15 bytes of RAM. 
+ */
+#define TRACE_ENABLED 0
+
+/**
+ * @brief Number of records per context (must be a power of 2)
+ */
+#define TRACE_SIZE 16
+
+/**
+ * @brief Cycles a scan interrupt may be late before it is traced
+ */
+#define TRACE_SCAN_LATE_CYCLES 32
+
+/**
+ * @brief Contexts with a ring buffer each
+ */
+typedef enum
+{
+	TRACE_HIGH,		// LED scan interrupt (declared high_priority)
+	TRACE_LOW,		// Other interrupts (declared low_priority)
+	TRACE_MAIN,		// Main loop
+	NUM_TRACE_RINGS
+} TraceRing;
+
+/**
+ * @brief List of events: TRACE_EVENT(id, name)
+ * @details The names are only used by Tools/traceview.c. New events must be
+ * added at the end. 
+ */
+#define TRACE_EVENTS \
+	TRACE_EVENT(TRACE_NONE, "") \
+	TRACE_EVENT(TRACE_SCAN_LATE, "scan late") /* Argument: Delay in us */ \
+	TRACE_EVENT(TRACE_TICK_ENTER, "tick >") \
+	TRACE_EVENT(TRACE_TICK_EXIT, "tick <") \
+	TRACE_EVENT(TRACE_EDGE, "edge") /* Argument: Pins that changed */ \
+	TRACE_EVENT(TRACE_DEBOUNCE_ENTER, "debounce >") \
+	TRACE_EVENT(TRACE_DEBOUNCE_EXIT, "debounce <") \
+	TRACE_EVENT(TRACE_TICK_MISSED, "missed ticks") /* Argument: Number of ticks */ \
+	TRACE_EVENT(TRACE_INPUT, "input") /* Argument: Button << 4 | event */ \
+	TRACE_EVENT(TRACE_PROGRAM, "program") /* Argument: Program */ \
+	TRACE_EVENT(TRACE_SLEEP, "sleep") \
+	TRACE_EVENT(TRACE_WAKE, "wake")
+
+/**
+ * @brief Events
+ */
+typedef enum
+{
+#define TRACE_EVENT(id, name) id,
+	TRACE_EVENTS
+#undef TRACE_EVENT
+	NUM_TRACE_EVENTS
+} TraceEvent;
+
+/**
+ * @brief Sends all records over UART and clears them
+ * @details Returns before the records have been sent. No records are taken
+ * until then and further dumps are ignored. 
+ */
+void traceDump(void);
+
+#if TRACE_ENABLED
+
+/**
+ * @brief A record
+ * @details Sent as it is (5 bytes, little endian), see Tools/traceview.c. 
+ */
+typedef struct
+{
+	uint8_t event;
+	uint8_t arg;
+	uint16_t time;		// Bits 0..15 of SMT1
+	uint8_t timeUpper;	// Bits 16..23 of SMT1
+} TraceRecord;
+
+/**
+ * @brief The ring buffers (only written by TRACE())
+ */
+extern volatile TraceRecord traceRecords[NUM_TRACE_RINGS][TRACE_SIZE];
+
+/**
+ * @brief Index of the next record of each ring buffer
+ */
+extern volatile uint8_t traceHeads[NUM_TRACE_RINGS];
+
+/**
+ * @brief Set while a dump is sent
+ */
+extern volatile bool traceFrozen;
+
+/**
+ * @brief Adds a record
+ * @details A macro rather than a function, so it can be used from both
+ * interrupt levels and the main loop alike. 
+ * @param ring The context it is used from (TraceRing). 
+ * @param type The event (TraceEvent). 
+ * @param argument The argument (0..255). 
+ */
+#define TRACE(ring, type, argument) do { \
+	if(!traceFrozen) \
+	{ \
+		uint32_t traceNow; \
+		PERF_NOW(traceNow); \
+		uint8_t traceHead = traceHeads[ring]; \
+		volatile TraceRecord* traceRecord = &traceRecords[ring][traceHead]; \
+		traceRecord->event = (type); \
+		traceRecord->arg = (uint8_t)(argument); \
+		traceRecord->time = (uint16_t)traceNow; \
+		traceRecord->timeUpper = (uint8_t)(traceNow >> 16); \
+		traceHeads[ring] = (traceHead + 1) & (TRACE_SIZE - 1); \
+	} \
+} while(0)
+
+#else
+
+#define TRACE(ring, type, argument) do {} while(0)
+
+#endif
+
+#endif // TRACE_H
@@ -5,9 +5,96 @@
  */
 
 #include<xc.h>
+#include<stdint.h>
 #include<stdio.h>
 #include"uart.h"
 
+/**
+ * @brief Transmit buffer
+ * @details Ring buffer written by uartSend() and read by the transmit
+ * interrupt. Each index is written by only one side. 
+ */
+static volatile char txBuffer[UART_TX_BUFFER_SIZE];
+
+/**
+ * @brief Index where uartSend() writes the next byte
+ */
+static volatile uint8_t txHead = 0;
+
+/**
+ * @brief Index of the next byte to be transmitted
+ */
+static volatile uint8_t txTail = 0;
+
+#if UART_TX_DMA
+/**
+ * @brief DMA start trigger: Interrupt vector number of U1TX
+ * @details See the interrupt vector priority table of the datasheet. 
+ */
+#define UART_TX_IRQ 0x21
+
+/**
+ * @brief States of the block transfer
+ */
+typedef enum
+{
+	BLOCK_IDLE,		// DMA channel free
+	BLOCK_QUEUED,	// Waiting for the bytes buffered before the block
+	BLOCK_SENDING	// The DMA sends the block, the buffer waits
+} BlockState;
+
+/**
+ * @brief State of the block transfer
+ * @details Only set to BLOCK_QUEUED by uartSendBlock(), everything else
+ * happens in the interrupts. 
+ */
+static volatile BlockState blockState = BLOCK_IDLE;
+
+/**
+ * @brief The block
+ */
+static const volatile void* blockData;
+
+/**
+ * @brief Length of the block
+ */
+static uint16_t blockLength;
+
+/**
+ * @brief Called when the block has been sent
+ */
+static UartBlockCallback blockCallback;
+
+/**
+ * @brief Index of the transmit buffer where the block goes
+ * @details The value of txHead when the block was queued: Once txTail gets
+ * there, the bytes buffered before the block have been sent. 
+ */
+static uint8_t blockPosition;
+#endif
+
+/**
+ * @brief Receive buffer
+ * @details Ring buffer written by the receive interrupt and read by
+ * uartReceive(). 
+ */
+static volatile char rxBuffer[UART_RX_BUFFER_SIZE];
+
+/**
+ * @brief Index where the receive interrupt writes the next byte
+ */
+static volatile uint8_t rxHead = 0;
+
+/**
+ * @brief Index of the next byte to be fetched
+ */
+static volatile uint8_t rxTail = 0;
+
+/**
+ * @brief The receive handler (or NULL)
+ */
+static volatile UartReceiveHandler receiveHandler = NULL;
+
 void uartInit(void)
 {
 	// Set up baud rate generator:
@@ -22,23 +109,191 @@ void uartInit(void)
 	// Configure Pin RA2 to output UART 1 TX
 	RA2PPS = 0x10;				// UART1_TX
 	TRISAbits.TRISA2 = 0;		// Direction: Output
+	
+	// Configure Pin RA1 as UART 1 RX input
+	ANSELAbits.ANSELA1 = 0;		// Digital input
+	TRISAbits.TRISA1 = 1;		// Direction: Input
+	WPUAbits.WPUA1 = 1;			// Keep the line idle (high) when nothing is connected
+	U1RXPPS = 0x01;				// RA1
+	U1CON0bits.RXEN = 1;		// Enable receiver
+	PIE4bits.U1RXIE = 1;		// Enable receive interrupt
+	
+#if UART_TX_DMA
+	// Set up DMA channel 1 to move a block to the UART, a byte per transmit
+	// request (see uartSendBlock())
+	DMASELECT = 0;				// Channel 1
+	DMAnCON1bits.DMODE = 0b00;	// Destination address unchanged
+	DMAnCON1bits.SMR = 0b00;	// Source in RAM
+	DMAnCON1bits.SMODE = 0b01;	// Source address incremented
+	DMAnCON1bits.SSTP = 1;		// Stop at the end of the source
+	DMAnDSA = (uint16_t)&U1TXB;
+	DMAnDSZ = 1;
+	DMAnSIRQ = UART_TX_IRQ;
+	DMAnCON0bits.EN = 1;
+	PIE2bits.DMA1SCNTIE = 1;	// Interrupt at the end of the block
+	
+	// The DMA only runs once the bus priorities are locked. It gets the
+	// highest one, as it only takes a cycle per byte. 
+	DMA1PR = 0;
+	ISRPR = 1;
+	MAINPR = 2;
+	PRLOCK = 0x55;
+	PRLOCK = 0xaa;
+	PRLOCKbits.PRLOCKED = 1;
+#endif
+}
+
+#if UART_TX_DMA
+/**
+ * @brief Starts sending the queued block by DMA
+ * @details The UART requests the first byte right away, as its transmit
+ * register is empty. 
+ */
+static void startBlock(void)
+{
+	DMASELECT = 0;				// Channel 1
+	DMAnSSA = (uint16_t)blockData;
+	DMAnSSZ = blockLength;
+	DMAnCON0bits.SIRQEN = 1;	// Cleared by the DMA at the end of the block
+	blockState = BLOCK_SENDING;
+}
+
+/**
+ * @brief Continues with the transmit buffer once the block has been sent
+ */
+static void finishBlock(void)
+{
+	UartBlockCallback callback = blockCallback;
+	blockState = BLOCK_IDLE;
+	PIE4bits.U1TXIE = 1;
+	if(callback)
+		callback();
+}
+#endif
+
+/**
+ * @brief Moves the next byte from the transmit buffer to the UART
+ * @details Must only be called when the UART can accept a byte (U1TXIF).
+ * Disables the transmit interrupt once the buffer is empty. 
+ */
+static void transmitNext(void)
+{
+	uint8_t tail = txTail;
+#if UART_TX_DMA
+	if(blockState == BLOCK_QUEUED && tail == blockPosition)
+		startBlock();
+	if(blockState == BLOCK_SENDING)
+	{
+		// The DMA takes the transmit requests until the end of the block
+		PIE4bits.U1TXIE = 0;
+		return;
+	}
+#endif
+	if(tail == txHead)
+	{
+		PIE4bits.U1TXIE = 0;
+		return;
+	}
+	U1TXB = txBuffer[tail];
+	txTail = (tail + 1) & (UART_TX_BUFFER_SIZE - 1);
+}
+
+/**
+ * @brief Transmits from the buffer by polling if interrupts are disabled
+ * @details Called while waiting for the buffer, so waiting with interrupts
+ * disabled doesn't deadlock. 
+ */
+static void transmitPolled(void)
+{
+	if(INTCON0bits.GIE)
+		return;
+#if UART_TX_DMA
+	if(PIR2bits.DMA1SCNTIF)
+	{
+		PIR2bits.DMA1SCNTIF = 0;
+		finishBlock();
+	}
+#endif
+	if(PIR4bits.U1TXIF)
+		transmitNext();
 }
 
 void uartSend(char c)
 {
-	// Wait for transmit buffer to become empty
-	while(PIR4bits.U1TXIF == 0);
-	// Copy c to transmit buffer
-	U1TXB = c;
+	uint8_t head = txHead;
+	uint8_t next = (head + 1) & (UART_TX_BUFFER_SIZE - 1);
+	while(next == txTail)
+	{
+		// Buffer is full
+#if UART_TX_BLOCK
+		transmitPolled();
+#else
+		return;
+#endif
+	}
+	txBuffer[head] = c;
+	txHead = next;
+	
+	// (Re-)enable the transmit interrupt, it is disabled once the buffer is
+	// empty
+	PIE4bits.U1TXIE = 1;
+}
+
+void uartSendBlock(const volatile void* data, uint16_t length, UartBlockCallback callback)
+{
+#if UART_TX_DMA
+	if(blockState == BLOCK_IDLE && length > 0 && length <= UART_BLOCK_MAX)
+	{
+		blockData = data;
+		blockLength = length;
+		blockCallback = callback;
+		blockPosition = txHead;
+		blockState = BLOCK_QUEUED;
+		
+		// The transmit interrupt starts the DMA once the buffer has got there
+		PIE4bits.U1TXIE = 1;
+		return;
+	}
+#endif
+	
+	// No DMA channel free: Send it through the buffer
+	const volatile char* bytes = data;
+	for(uint16_t i = 0; i < length; i++)
+		uartSend(bytes[i]);
+	if(callback)
+		callback();
 }
 
 void uartFlush(void)
 {
+	// Wait until the buffer (and the block) is empty
+#if UART_TX_DMA
+	while(txHead != txTail || blockState != BLOCK_IDLE)
+		transmitPolled();
+#else
+	while(txHead != txTail)
+		transmitPolled();
+#endif
 	// Wait until everything from the transmit buffer and the transmit shift
 	// register has been sent
 	while(U1ERRIRbits.TXMTIF == 0);
 }
 
+bool uartReceive(char* c)
+{
+	uint8_t tail = rxTail;
+	if(tail == rxHead)
+		return false;
+	*c = rxBuffer[tail];
+	rxTail = (tail + 1) & (UART_RX_BUFFER_SIZE - 1);
+	return true;
+}
+
+void uartSetReceiveHandler(UartReceiveHandler handler)
+{
+	receiveHandler = handler;
+}
+
 /**
  * @brief Redirect printf() output to UART
  * 
@@ -50,3 +305,46 @@ void putch(char c)
 {
 	uartSend(c);
 }
+
+/**
+ * @brief Interrupt handler for the UART transmitter
+ * @details Called while the UART can accept a byte and the transmit interrupt
+ * is enabled. 
+ */
+void __interrupt(irq(U1TX), low_priority) uartTxIsr(void)
+{
+	transmitNext();
+}
+
+#if UART_TX_DMA
+/**
+ * @brief Interrupt handler for the end of a block
+ * @details Called once the DMA has handed the last byte of the block to the
+ * UART. 
+ */
+void __interrupt(irq(DMA1SCNT), low_priority) uartDmaIsr(void)
+{
+	PIR2bits.DMA1SCNTIF = 0;
+	finishBlock();
+}
+#endif
+
+/**
+ * @brief Interrupt handler for the UART receiver
+ * @details Called for every received byte. Unless the receive handler takes
+ * the byte, it is buffered or dropped if the receive buffer is full. 
+ */
+void __interrupt(irq(U1RX), low_priority) uartRxIsr(void)
+{
+	char c = U1RXB;
+	UartReceiveHandler handler = receiveHandler;
+	if(handler && handler(c))
+		return;
+	uint8_t head = rxHead;
+	uint8_t next = (head + 1) & (UART_RX_BUFFER_SIZE - 1);
+	if(next != rxTail)
+	{
+		rxBuffer[head] = c;
+		rxHead = next;
+	}
+}
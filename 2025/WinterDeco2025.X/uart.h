@@ -1,15 +1,62 @@
 /**
  * @file uart.h
  * @date 2024-10-06
- * @brief Primitive serial driver (output only) for PIC18F14Q41
+ * @brief Primitive serial driver for PIC18F14Q41
  * 
  * Only implements 8-bit data mode @250kBaud
  * Has printf() functionality
+ * Transmits on RA2, receives on RA1 (ICSPCLK on the programming header)
+ * 
+ * Output is buffered and transmitted by the UART transmit interrupt, so
+ * printf() returns right away instead of waiting about 40us per byte. While
+ * interrupts are disabled, the buffer is emptied by polling instead. 
+ * 
+ * Bulk data like dumps can be sent with uartSendBlock() instead: DMA channel
+ * 1 moves the block to the UART, so the CPU isn't needed while it is sent. 
+ * 
+ * Received bytes are collected by the receive interrupt and fetched with
+ * uartReceive() without waiting. A receive handler can take bytes before
+ * they are buffered. 
  */
 
 #ifndef UART_H
 #define	UART_H
 
+#include<stdbool.h>
+#include<stdint.h>
+
+/**
+ * @brief Size of the transmit buffer in bytes
+ * @details Must be a power of 2 (at most 128). 
+ */
+#define UART_TX_BUFFER_SIZE 64
+
+/**
+ * @brief Behaviour when the transmit buffer is full
+ * @details If 1, uartSend() waits until there is room in the buffer. If 0,
+ * the byte is dropped, so output can never stall the caller. 
+ */
+#define UART_TX_BLOCK 1
+
+/**
+ * @brief Send blocks by DMA (1) or through the transmit buffer (0)
+ * @details DMA channel 1 is reserved for the UART if 1. 
+ */
+#define UART_TX_DMA 1
+
+/**
+ * @brief Maximum length of a block sent by DMA
+ * @details Longer blocks go through the transmit buffer. 
+ */
+#define UART_BLOCK_MAX 4095
+
+/**
+ * @brief Size of the receive buffer in bytes
+ * @details Must be a power of 2 (at most 128). Bytes received while the
+ * buffer is full are dropped. 
+ */
+#define UART_RX_BUFFER_SIZE 32
+
 /**
  * @brief Initialises the driver
  */
@@ -18,17 +65,63 @@ void uartInit(void);
 /**
  * @brief Transmit a byte over UART
  * 
- * While this function is non-blocking, it will still busy wait until the
- * transmit buffer is free. After writing the byte to the transmit buffer, it
- * will however not wait for it to be transmitted. 
+ * The byte is put into the transmit buffer and sent in the background. If the
+ * buffer is full, this waits or drops the byte (see UART_TX_BLOCK). 
  * @param c The byte to be transmitted
  */
 void uartSend(char c);
 
+/**
+ * @brief Function that is called when a block has been sent
+ * @details Called from the DMA interrupt, so it must be short. 
+ */
+typedef void (*UartBlockCallback)(void);
+
+/**
+ * @brief Transmit a block of bytes in the background
+ * 
+ * The block is sent after the bytes already in the transmit buffer. Bytes
+ * passed to uartSend() in the meantime are buffered and follow the block. 
+ * 
+ * The block is moved to the UART by DMA, so the data must stay unchanged
+ * until the callback. If the DMA channel is still busy with another block
+ * (or the block is longer than UART_BLOCK_MAX), it is put into the transmit
+ * buffer byte by byte like with uartSend() and the callback is called before
+ * this returns. 
+ * @param data The bytes, must be in RAM. 
+ * @param length Number of bytes. 
+ * @param callback Called once the last byte has been handed to the UART (or
+ * NULL). 
+ */
+void uartSendBlock(const volatile void* data, uint16_t length, UartBlockCallback callback);
+
 /**
  * @brief Wait until everything has been transmitted
+ * @details Call before going to sleep. 
  */
 void uartFlush(void);
 
-#endif	/* UART_H */
+/**
+ * @brief Fetch a received byte
+ * @details Doesn't wait if nothing has been received. 
+ * @param c Receives the byte. 
+ * @return Returns false if the receive buffer is empty. 
+ */
+bool uartReceive(char* c);
+
+/**
+ * @brief Function that gets to see each received byte first
+ * @details Called from the receive interrupt, so it must be short. Returns
+ * true if it has taken the byte, false to leave it to uartReceive(). 
+ */
+typedef bool (*UartReceiveHandler)(char c);
 
+/**
+ * @brief Installs a receive handler
+ * @details For data that arrives faster than the main loop could fetch it
+ * from the receive buffer. 
+ * @param handler The handler, NULL to buffer all received bytes again. 
+ */
+void uartSetReceiveHandler(UartReceiveHandler handler);
+
+#endif	/* UART_H */